@@ -27,11 +27,17 @@ public:
     // is provided, then it will default to the instrument's channel or CH1 if
     // no instrument was provided.
     //
-    void setInstrument(std::shared_ptr<Instrument> instrument, std::optional<ChType> ch = std::nullopt);
+    // The instrument is not owned by the preview, it must stay alive until
+    // another instrument is set (ie it belongs to a table that outlives the
+    // preview). No reference counting is done here, so this can be called
+    // from a realtime thread.
+    //
+    void setInstrument(Instrument const* instrument, std::optional<ChType> ch = std::nullopt);
 
     void play(uint8_t note);
 
-    void step(RuntimeContext const& rc);
+    template <class Apu>
+    void step(BasicRuntimeContext<Apu> const& rc);
 
 private:
 
@@ -42,7 +48,7 @@ private:
     NoiseFrequencyControl mNoiseFc;
     FrequencyControl *mFc;
 
-    std::shared_ptr<Instrument> mInstrument;
+    Instrument const* mInstrument;
     std::optional<InstrumentRuntime> mIr;
 
     bool mInit;
@@ -46,25 +46,33 @@ public:
     TrackRow& getTrackRow(ChType ch, int row);
     TrackRow const& getTrackRow(ChType ch, int row) const;
 
+    //
+    // Gets the track for the given channel. Tracks are copy-on-write, so a
+    // copy of the returned track is a cheap snapshot of its data.
+    //
+    Track& getTrack(ChType ch);
+    Track const& getTrack(ChType ch) const;
+
     //
     // Gets the pattern size, in rows.
     //
     int size() const;
 
     //
-    // Returns the count of rows that will be stepped by the MusicRuntime. Track::rowCount
-    // will be returned if there are no pattern skip effects in any of the track data
+    // Returns the count of rows that will be stepped by the MusicRuntime. The
+    // pattern size is returned if there are no pattern skip effects in any of
+    // the track data. Constant time, each track keeps the row of its first
+    // skip effect.
     //
-    int totalRows();
+    int totalRows() const;
 
 private:
+    Track* track(ChType ch) const noexcept;
+
     Track *mTrack1;
     Track *mTrack2;
     Track *mTrack3;
     Track *mTrack4;
-
-    // cache the calculated row count
-    int mRowCount;
 };
 
 
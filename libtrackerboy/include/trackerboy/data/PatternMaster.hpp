@@ -31,7 +31,8 @@
 
 #include <array>
 #include <cstdint>
-#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace trackerboy {
 
@@ -39,13 +40,21 @@ namespace trackerboy {
 //
 // Container class for all patterns for a song
 //
+// Tracks for each channel are kept densely in a vector of (id, track) pairs
+// with a 256 entry table mapping a track id to its slot in the vector. Lookups
+// are a table index and iterating a channel's tracks is a linear walk. The
+// vector's capacity is reserved for every possible id by the first call to
+// getTrack, so references it returns stay valid until the track is removed
+// (or the master is cleared). Copies are not reserved until then.
+//
 class PatternMaster {
 
 public:
 
-    using Data = std::unordered_map<uint8_t, Track>;
+    using Data = std::vector<std::pair<uint8_t, Track>>;
 
     static constexpr int MAX_ROWS = 256;
+    static constexpr int MAX_TRACKS = 256;
 
     PatternMaster(int rows);
 
@@ -79,19 +88,44 @@ public:
     //
     Track const* getTrack(ChType ch, uint8_t track) const;
 
-    // Removes a given track from the master
+    //
+    // Removes a given track from the master. The last track in the channel
+    // is moved into the removed track's slot, so references to it are
+    // invalidated.
+    //
     void remove(ChType ch, uint8_t track);
 
     void setRowSize(int newsize);
 
+    //
+    // Builds the operation stream of every track, so that a player stepping
+    // a copy of this master does not have to. Call this before handing a
+    // copy to the render thread.
+    //
+    void buildOperations() const;
+
 
 private:
 
+    static constexpr uint16_t NO_SLOT = 0xFFFF;
+
+    struct Channel {
+
+        Channel();
+
+        void clear();
+
+        // the tracks, in the order they were created
+        Data tracks;
+        // maps a track id -> index in tracks, NO_SLOT if the track does not exist
+        // (not named slots, which is a Qt keyword macro)
+        std::array<uint16_t, MAX_TRACKS> trackSlots;
+
+    };
+
     int mRows;
 
-    // maps a track id -> TrackData
-        
-    std::array<Data, 4> mMap;
+    std::array<Channel, 4> mChannels;
 
 
 };
@@ -69,6 +69,13 @@ public:
     TrackRow& getRow(ChType ch, int order, int row);
     TrackRow getRow(ChType ch, int order, int row) const;
 
+    //
+    // Replaces a row. Unlike writing through the reference from getRow, the
+    // track can keep its sparse storage and its row count and jump row are
+    // updated incrementally.
+    //
+    void setRow(ChType ch, int order, int row, TrackRow const& rowdata);
+
     void setRowsPerBeat(int rowsPerBeat);
 
     void setRowsPerMeasure(int rowsPerMeasure);
@@ -19,6 +19,18 @@ class BaseTable {
 public:
     static constexpr size_t MAX_SIZE = 64;
 
+    //
+    // Weak reference to an item in the table. The handle is only valid for
+    // the item that was in the table when the handle was made, if that item
+    // is removed (or replaced) the handle no longer resolves. Resolving a
+    // handle is an array lookup, no reference counting is done so the engine
+    // can hold onto items without touching atomics every frame.
+    //
+    struct Handle {
+        uint8_t id;
+        uint32_t generation; // 0 for a null handle
+    };
+
 
     virtual ~BaseTable() noexcept;
 
@@ -46,6 +58,19 @@ public:
 
     std::shared_ptr<DataItem> getShared(uint8_t id) const;
 
+    //
+    // Makes a handle for the item with the given id. A null handle is returned
+    // if there is no item with this id.
+    //
+    Handle handle(uint8_t id) const noexcept;
+
+    //
+    // Resolves the handle, nullptr is returned if the handle's item is no
+    // longer in the table. The pointer is invalidated when the item is
+    // removed.
+    //
+    DataItem const* get(Handle handle) const noexcept;
+
     void remove(uint8_t id);
 
 protected:
@@ -56,6 +81,16 @@ protected:
 
     virtual std::shared_ptr<DataItem> copyItem(DataItem const& item) = 0;
 
+    //
+    // Determines if the two items have the same data, ignoring names.
+    //
+    virtual bool hasSameData(DataItem const& lhs, DataItem const& rhs) const = 0;
+
+    //
+    // Copies this table into dest for a snapshot, see Table::snapshot
+    //
+    void snapshotInto(BaseTable &dest, BaseTable const* previous) const;
+
 private:
 
     using DataType = std::array<std::shared_ptr<DataItem>, TABLE_SIZE>;
@@ -68,6 +103,9 @@ private:
     void findNextId();
 
     DataType mData;
+    // generation of each item, incremented on every insert/duplicate
+    std::array<uint32_t, TABLE_SIZE> mGenerations;
+    uint32_t mGeneration;
     size_t mSize;
     uint8_t mNextId;
 };
@@ -108,12 +146,25 @@ public:
 
     std::shared_ptr<T> getShared(uint8_t id) const;
 
+    T const* get(Handle handle) const noexcept;
+
+    //
+    // Makes an immutable copy of this table that can be read on another
+    // thread while this table is edited. Items that are unchanged from the
+    // previous snapshot are shared with it instead of copied, so handles and
+    // pointers to them stay the same. Only item data is compared, a renamed
+    // item keeps its old name in the snapshot.
+    //
+    std::shared_ptr<Table const> snapshot(Table const* previous = nullptr) const;
+
 protected:
 
     virtual std::shared_ptr<DataItem> createItem() override;
 
     virtual std::shared_ptr<DataItem> copyItem(DataItem const& item) override;
 
+    virtual bool hasSameData(DataItem const& lhs, DataItem const& rhs) const override;
+
 };
 
 // we will only use these template instantiations
@@ -26,26 +26,224 @@
 
 #include "trackerboy/data/TrackRow.hpp"
 
+#include <cstddef>
+#include <iterator>
+#include <memory>
 #include <vector>
 
 namespace trackerboy {
 
+class OperationStream;
 
+//
 // container class for track data
-
+//
+// The track keeps a cached OperationStream of its data for the engine. Any
+// non-const access to the track invalidates this cache, so reads should be
+// done through a const Track when possible.
+//
+// Track data is copy-on-write: copies share their rows (and the cached
+// stream) until one of them is modified. A copy can be read on another thread
+// while the original is being edited, which is how immutable song snapshots
+// are made for the renderer.
+//
+// Rows are stored sparsely, as a sorted list of non-empty rows, until the
+// track fills past a threshold. Tracks edited through the setters (or
+// replace) stay sparse while mostly empty. Getting a mutable row reference
+// or iterator switches the track to dense storage, since the reference must
+// point into an array of every row.
+//
 class Track {
 
 public:
 
     using Data = std::vector<TrackRow>;
 
+    //
+    // A non-empty row and its index in the track
+    //
+    struct IndexedRow {
+        uint8_t row;
+        TrackRow data;
+    };
+
+    static constexpr TrackRow EMPTY_ROW = {};
+
+    //
+    // Iterates every row in the track, empty rows included.
+    //
+    class ConstIterator {
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = TrackRow;
+        using difference_type = std::ptrdiff_t;
+        using pointer = TrackRow const*;
+        using reference = TrackRow const&;
+
+        reference operator*() const noexcept {
+            if (mDense) {
+                return mDense[mRow];
+            }
+            return (mEntry != mEntryEnd && mEntry->row == mRow) ? mEntry->data : EMPTY_ROW;
+        }
+
+        pointer operator->() const noexcept {
+            return &**this;
+        }
+
+        ConstIterator& operator++() noexcept {
+            if (!mDense && mEntry != mEntryEnd && mEntry->row == mRow) {
+                ++mEntry;
+            }
+            ++mRow;
+            return *this;
+        }
+
+        ConstIterator operator++(int) noexcept {
+            auto copy = *this;
+            ++*this;
+            return copy;
+        }
+
+        bool operator==(ConstIterator const& rhs) const noexcept {
+            return mRow == rhs.mRow;
+        }
+
+        bool operator!=(ConstIterator const& rhs) const noexcept {
+            return mRow != rhs.mRow;
+        }
+
+        difference_type operator-(ConstIterator const& rhs) const noexcept {
+            return mRow - rhs.mRow;
+        }
+
+    private:
+        friend class Track;
+
+        ConstIterator(TrackRow const *dense, IndexedRow const *entry, IndexedRow const *entryEnd, int row) noexcept :
+            mDense(dense),
+            mEntry(entry),
+            mEntryEnd(entryEnd),
+            mRow(row)
+        {
+        }
+
+        // rows when dense, nullptr when sparse
+        TrackRow const *mDense;
+        // next sparse entry at or after mRow
+        IndexedRow const *mEntry;
+        IndexedRow const *mEntryEnd;
+        int mRow;
+    };
+
+    //
+    // Iterates only the non-empty rows of the track, in order.
+    //
+    class NonEmptyIterator {
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = IndexedRow;
+        using difference_type = std::ptrdiff_t;
+        using pointer = IndexedRow const*;
+        using reference = IndexedRow;
+
+        IndexedRow operator*() const noexcept {
+            if (mDense) {
+                return { (uint8_t)mRow, mDense[mRow] };
+            }
+            return *mEntry;
+        }
+
+        NonEmptyIterator& operator++() noexcept {
+            if (mDense) {
+                ++mRow;
+                skipEmpty();
+            } else {
+                ++mEntry;
+            }
+            return *this;
+        }
+
+        bool operator==(NonEmptyIterator const& rhs) const noexcept {
+            return mDense ? mRow == rhs.mRow : mEntry == rhs.mEntry;
+        }
+
+        bool operator!=(NonEmptyIterator const& rhs) const noexcept {
+            return !(*this == rhs);
+        }
+
+    private:
+        friend class Track;
+
+        NonEmptyIterator(TrackRow const *dense, int row, int size, IndexedRow const *entry) noexcept :
+            mDense(dense),
+            mRow(row),
+            mSize(size),
+            mEntry(entry)
+        {
+            if (mDense) {
+                skipEmpty();
+            }
+        }
+
+        void skipEmpty() noexcept {
+            while (mRow < mSize && mDense[mRow].isEmpty()) {
+                ++mRow;
+            }
+        }
+
+        TrackRow const *mDense;
+        int mRow;
+        int mSize;
+        IndexedRow const *mEntry;
+    };
+
+    //
+    // Range for NonEmptyIterator, for use in range based for loops
+    //
+    class NonEmptyRows {
+
+    public:
+        NonEmptyIterator begin() const noexcept {
+            return mBegin;
+        }
+
+        NonEmptyIterator end() const noexcept {
+            return mEnd;
+        }
+
+    private:
+        friend class Track;
+
+        NonEmptyRows(NonEmptyIterator begin, NonEmptyIterator end) noexcept :
+            mBegin(begin),
+            mEnd(end)
+        {
+        }
+
+        NonEmptyIterator mBegin;
+        NonEmptyIterator mEnd;
+    };
+
     Track(int rows);
+    // no move operations, a move is a shared copy so that a track always has
+    // storage
+    Track(Track const& track) = default;
+    Track& operator=(Track const& track) = default;
 
+    //
+    // Mutable access to a row. Switches the track to dense storage. The
+    // non-empty row count and jump row are recalculated on the next call to
+    // rowCount or firstJumpRow, since the row can be modified through the
+    // reference.
+    //
     TrackRow& operator[](int row);
     TrackRow const& operator[](int row) const;
 
     Data::iterator begin();
-    Data::const_iterator begin() const;
+    ConstIterator begin() const;
 
     void clear(int rowStart, int rowEnd);
 
@@ -56,7 +254,7 @@ public:
     void clearNote(int row);
 
     Data::iterator end();
-    Data::const_iterator end() const;
+    ConstIterator end() const;
 
     void setEffect(int row, int effectNo, EffectType effect, uint8_t param = 0);
 
@@ -64,17 +262,74 @@ public:
 
     void setNote(int row, uint8_t note);
 
-    void replace(int rowno, TrackRow &row);
+    void replace(int rowno, TrackRow const& row);
 
     void resize(int newSize);
 
+    //
+    // Number of non-empty rows in the track. Kept up to date as the track is
+    // modified, so this is constant time unless rows were modified through a
+    // mutable reference.
+    //
     int rowCount() const;
 
     int size() const;
 
+    //
+    // Index of the first row with an effect that ends the pattern early
+    // (Bxx, C00 or D00), or -1 if there is none. Kept up to date as the track
+    // is modified, like rowCount.
+    //
+    int firstJumpRow() const;
+
+    //
+    // Gets the non-empty rows in the track, skipping empty ones. The range is
+    // valid until the track is modified.
+    //
+    NonEmptyRows nonEmptyRows() const;
+
+    //
+    // Determines if the track is currently using sparse storage
+    //
+    bool isSparse() const noexcept;
+
+    //
+    // Gets the operation stream for this track, the stream is built if the
+    // track was modified since the last call. The returned reference is valid
+    // until the track is modified. Safe to call from multiple threads as long
+    // as the track is not being modified. Copies of the track share the same
+    // stream.
+    //
+    OperationStream const& operations() const;
+
+    //
+    // Determines if the operation stream is already built, ie operations()
+    // will not allocate
+    //
+    bool hasOperations() const noexcept;
+
+    //
+    // Determines if this track shares its data with a copy
+    //
+    bool isShared() const noexcept;
+
 private:
 
-    Data mData;
+    struct Storage;
+
+    //
+    // Gets the storage for writing. The storage is copied first if it is
+    // shared with another track, otherwise the cached stream is invalidated.
+    //
+    Storage& detach();
+
+    //
+    // Same as detach, but also switches to dense storage and gets the rows
+    // for writing through a reference.
+    //
+    Data& detachDense();
+
+    std::shared_ptr<Storage> mStorage;
 
 };
 
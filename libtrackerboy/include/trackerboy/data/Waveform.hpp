@@ -44,10 +44,22 @@ public:
 
     Waveform(std::string const& hexstring);
 
+    //
+    // Gets the wave data for writing, the content generation is advanced so
+    // do not hold onto the reference past the edit.
+    //
     Data& data() noexcept;
 
     Data const& data() const noexcept;
 
+    //
+    // Content generation of the waveform. A new generation is assigned every
+    // time the data is accessed for writing. Generations are unique among all
+    // waveforms, so an id and generation pair identifies the wave data being
+    // used. Copies keep the generation of the original.
+    //
+    uint32_t generation() const noexcept;
+
     // convenience method, sets the waveform data from a string of hex nibbles
     void fromString(std::string const& hexstring);
 
@@ -55,8 +67,11 @@ public:
 
     uint8_t& operator[](int index);
 
+    uint8_t operator[](int index) const;
+
 private:
     Data mData;
+    uint32_t mGeneration;
 };
 
 }
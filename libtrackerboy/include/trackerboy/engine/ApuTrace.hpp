@@ -0,0 +1,51 @@
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace trackerboy {
+
+//
+// Register write trace format
+//
+// A trace is a recording of every register write made to the apu, so that a
+// song can be played back without the Engine. The format is a stream of
+// commands so that it can be written as the song is rendered and read
+// sequentially (ie from a memory-mapped file).
+//
+// Header (12 bytes):
+//  0: signature, "TBTRACE" (7 bytes)
+//  7: version, 1 byte
+//  8: framerate, 32-bit float little endian
+//
+// Commands follow the header, each starts with a 1 byte opcode:
+//  0x00          end of trace
+//  0x01          end of frame
+//  0x02 n        end of frame, repeated n + 2 times (empty frames)
+//  0x10-0x3F v   write v to register opcode
+//
+// Writes are timestamped implicitly, the frame of a write is the number of
+// end of frame commands before it. Within a frame, writes are spaced by the
+// apu's default write step, the same as GbApu.
+//
+namespace trace {
+
+constexpr char SIGNATURE[] = { 'T', 'B', 'T', 'R', 'A', 'C', 'E' };
+constexpr uint8_t VERSION = 1;
+constexpr size_t HEADER_SIZE = sizeof(SIGNATURE) + 1 + 4;
+
+constexpr uint8_t CMD_END = 0x00;
+constexpr uint8_t CMD_FRAME = 0x01;
+constexpr uint8_t CMD_FRAMES = 0x02;
+
+// register writes use the register address as the opcode
+constexpr uint8_t CMD_WRITE_FIRST = 0x10;
+constexpr uint8_t CMD_WRITE_LAST = 0x3F;
+
+// maximum number of frames a CMD_FRAMES command can hold
+constexpr unsigned MAX_FRAME_RUN = 255 + 2;
+
+}
+
+}
@@ -0,0 +1,76 @@
+
+#pragma once
+
+#include "trackerboy/engine/IApu.hpp"
+#include "trackerboy/trackerboy.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace trackerboy {
+
+//
+// IApu decorator that keeps a shadow copy of the sound registers. Writes are
+// stored in the shadow and marked dirty, reads are served from the shadow so
+// the wrapped apu is never read. Call flush() once per frame to send all
+// pending changes to the wrapped apu in a single writeRegisters call.
+//
+// Registers whose value did not change since the last flush are not written,
+// with the exception of the trigger bit in NRx4, which is always written. If
+// waveram was modified, CH3's DAC is turned off for the upload and then
+// restored.
+//
+// All writers to the wrapped apu (engine, previewers) should share the same
+// BufferedApu, otherwise the shadow will not reflect the apu's state.
+//
+class BufferedApu final : public IApu {
+
+public:
+
+    BufferedApu(IApu &apu);
+    ~BufferedApu();
+
+    virtual uint8_t readRegister(uint8_t reg) override;
+
+    virtual void writeRegister(uint8_t reg, uint8_t value) override;
+
+    //
+    // Writes all pending register changes to the wrapped apu.
+    //
+    void flush();
+
+    //
+    // Resets the shadow registers to 0, the power-on state. Call this after
+    // the wrapped apu has been reset. Every register will be written on the
+    // next flush that modifies it, regardless of its value.
+    //
+    void reset() noexcept;
+
+    //
+    // Total number of register writes sent to the wrapped apu.
+    //
+    size_t writeCount() const noexcept;
+
+private:
+
+    // registers NR10 to the end of waveram
+    static constexpr size_t REGISTER_COUNT = 0x40 - 0x10;
+
+    IApu &mApu;
+
+    // values written by the caller
+    std::array<uint8_t, REGISTER_COUNT> mRegisters;
+    // values last written to the wrapped apu
+    std::array<uint8_t, REGISTER_COUNT> mCommitted;
+
+    // bit n corresponds to register NR10 + n
+    uint64_t mDirty;        // written since the last flush
+    uint64_t mValid;        // mCommitted[n] matches the apu
+    uint64_t mTriggers;     // trigger bit was set in NRx4 since the last flush
+
+    size_t mWriteCount;
+
+};
+
+}
@@ -0,0 +1,101 @@
+
+#pragma once
+
+#include "trackerboy/data/Module.hpp"
+#include "trackerboy/engine/IApu.hpp"
+#include "trackerboy/engine/MusicRuntime.hpp"
+
+#include <optional>
+#include <vector>
+
+namespace trackerboy {
+
+//
+// Cache of MusicRuntime snapshots, or checkpoints, used for starting playback
+// in the middle of a song with the correct state. The song is played from the
+// start with a NullApu, and a copy of the runtime is saved every interval
+// rows. Seeking to a row restores the nearest checkpoint before it and then
+// fast-forwards the remaining rows.
+//
+// Checkpoints are built lazily, only as far as the furthest row seeked. The
+// cache must be invalidated whenever the song or module is modified.
+//
+class CheckpointCache {
+
+public:
+
+    static constexpr int DEFAULT_INTERVAL = 16;
+
+    explicit CheckpointCache(int interval = DEFAULT_INTERVAL);
+
+    //
+    // Number of rows between checkpoints
+    //
+    int interval() const noexcept;
+
+    //
+    // Number of checkpoints currently in the cache
+    //
+    size_t size() const noexcept;
+
+    //
+    // Removes all checkpoints, they will get rebuilt on the next seek.
+    //
+    void invalidate() noexcept;
+
+    //
+    // Gets a runtime that will start the given row on its next step, with the
+    // state it would have had if the song was played from the beginning. If
+    // the row is never reached when playing from the beginning (ie it is
+    // skipped by a pattern jump or the song halts before it), std::nullopt is
+    // returned.
+    //
+    std::optional<MusicRuntime> seek(Module const& mod, Song const& song, int orderNo, int patternRow);
+
+    //
+    // Same as above, but uses the given tables instead of the module's (ie
+    // the tables of a snapshot).
+    //
+    std::optional<MusicRuntime> seek(
+        InstrumentTable const& instrumentTable,
+        WaveformTable const& waveTable,
+        Song const& song,
+        int orderNo,
+        int patternRow
+    );
+
+private:
+
+    //
+    // Steps the runtime until the start of the next row, the number of the
+    // row started is written to the frame. false is returned if the runtime
+    // halted.
+    //
+    static bool stepRow(BasicRuntimeContext<NullApu> const& rc, MusicRuntime &runtime, Frame &frame);
+
+    //
+    // Advances the builder runtime by one row, saving a checkpoint when
+    // needed. Returns false if there are no more rows to visit.
+    //
+    bool advance(BasicRuntimeContext<NullApu> const& rc);
+
+    int const mInterval;
+
+    NullApu mApu;
+
+    Song const* mSong;
+
+    // index of the first visit for each row in the song (order * rowSize + row)
+    // -1 if the row has not been visited
+    std::vector<int> mVisits;
+    std::vector<MusicRuntime> mCheckpoints;
+
+    // runtime used for building checkpoints, always at the start of a row
+    std::optional<MusicRuntime> mBuilder;
+    int mRowsVisited;
+    bool mComplete;
+
+};
+
+
+}
@@ -25,6 +25,7 @@
 #pragma once
 
 #include "trackerboy/data/Module.hpp"
+#include "trackerboy/engine/CheckpointCache.hpp"
 #include "trackerboy/engine/Frame.hpp"
 #include "trackerboy/engine/IApu.hpp"
 #include "trackerboy/engine/MusicRuntime.hpp"
@@ -36,11 +37,18 @@
 namespace trackerboy {
 
 
-class Engine {
+//
+// Plays music from a module by writing to an APU each frame. The engine is
+// templated on the APU type, so that register writes can be inlined when the
+// type is known. Engine is the type-erased version, which can use any IApu
+// implementation. See BasicRuntimeContext for the supported APU types.
+//
+template <class Apu>
+class BasicEngine {
 
 public:
 
-    Engine(IApu &apu, Module const* mod = nullptr);
+    BasicEngine(Apu &apu, Module const* mod = nullptr);
 
     Module const* getModule() const;
 
@@ -55,15 +63,43 @@ public:
     // managed by the caller. The engine expects that the lifetime of the
     // song will be the same as the engine's or until reset() is called.
     //
+    // If music is playing, the music runtime continues with the new song from
+    // the same position. This is used to swap in an edited copy of the song.
+    //
     void setSong(Song const* song);
 
+    //
+    // Use these tables instead of the module's when playing. The tables must
+    // outlive the engine, or until setModule or setTables is called again.
+    // Instruments that are playing are restarted when their data changes, so
+    // the previous tables must still be alive when calling this.
+    //
+    void setTables(InstrumentTable const& instrumentTable, WaveformTable const& waveTable);
+
     void reset();
 
     //
-    // begin playing music from a starting order and row
+    // begin playing music from a starting order and row. The music state
+    // (speed, instruments, envelopes, etc) is restored from the checkpoint
+    // cache so that it is the same as if the song was played from the
+    // beginning.
     //
     void play(int orderNo, int patternRow = 0);
 
+    //
+    // Begin playing music from a runtime that was prepared elsewhere, ie
+    // seeked with a CheckpointCache owned by another thread so that the
+    // seek is not done here. The runtime must be playing the engine's
+    // current song. Its state is written to the apu before the first step.
+    //
+    void play(MusicRuntime const& runtime);
+
+    //
+    // Clears the checkpoint cache. Must be called whenever the song or
+    // module is modified.
+    //
+    void invalidateCheckpoints();
+
     //
     // Stops music playback if playing music.
     //
@@ -83,7 +119,8 @@ public:
     void unlock(ChType ch);
 
     //
-    // Writes the current music state to all locked channels.
+    // Writes the current music state to all locked channels. The waveform
+    // for CH3 is always uploaded again, so this can be used after an APU reset.
     //
     void reload();
 
@@ -101,11 +138,12 @@ public:
 private:
     void clearChannel(ChType ch);
 
-    IApu &mApu;
+    Apu &mApu;
     Module const* mModule;
-    std::optional<RuntimeContext> mRc;
+    std::optional<BasicRuntimeContext<Apu>> mRc;
     std::optional<MusicRuntime> mMusicContext;
     Song const* mSong;
+    CheckpointCache mCheckpoints;
 
     //TODO: sfx runtime
     int mTime;
@@ -114,5 +152,7 @@ private:
 
 };
 
+using Engine = BasicEngine<IApu>;
+
 
 }
@@ -3,10 +3,18 @@
 
 #include "gbapu.hpp"
 
+#include <cstddef>
 #include <cstdint>
 
 namespace trackerboy {
 
+//
+// A single register write, used for batched writes via IApu::writeRegisters
+//
+struct RegisterWrite {
+    uint8_t reg;
+    uint8_t value;
+};
 
 //
 // Apu interface
@@ -21,6 +29,13 @@ public:
 
     virtual void writeRegister(uint8_t reg, uint8_t value) = 0;
 
+    //
+    // Write count registers in the order given. The default implementation
+    // calls writeRegister for each write, implementations should override
+    // this if there is a faster way.
+    //
+    virtual void writeRegisters(RegisterWrite const* writes, size_t count);
+
 };
 
 //
@@ -36,6 +51,8 @@ public:
 
     virtual void writeRegister(uint8_t reg, uint8_t value) override;
 
+    virtual void writeRegisters(RegisterWrite const* writes, size_t count) override;
+
 };
 
 //
@@ -51,6 +68,8 @@ public:
 
     virtual void writeRegister(uint8_t reg, uint8_t value) override;
 
+    virtual void writeRegisters(RegisterWrite const* writes, size_t count) override;
+
 private:
     gbapu::Apu &mApu;
 };
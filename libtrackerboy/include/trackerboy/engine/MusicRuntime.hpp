@@ -6,6 +6,7 @@
 #include "trackerboy/engine/FrequencyControl.hpp"
 #include "trackerboy/engine/GlobalState.hpp"
 #include "trackerboy/engine/InstrumentRuntime.hpp"
+#include "trackerboy/engine/RuntimeContext.hpp"
 #include "trackerboy/engine/Timer.hpp"
 #include "trackerboy/engine/TrackControl.hpp"
 
@@ -23,34 +24,72 @@ namespace trackerboy {
 // plays indefinitely unless it is halted (pattern effect B00). A MusicRuntime can only play
 // one song for its entire lifetime.
 //
+// Methods that write to the APU are templated on the APU type, see
+// BasicRuntimeContext for the supported types.
+//
 class MusicRuntime {
 
 public:
     MusicRuntime(Song const& song, int orderNo, int patternRow, bool patternRepeat = false);
 
-    void halt(RuntimeContext const& rc);
+    template <class Apu>
+    void halt(BasicRuntimeContext<Apu> const& rc);
 
-    void lock(RuntimeContext const& rc, ChType ch);
+    template <class Apu>
+    void lock(BasicRuntimeContext<Apu> const& rc, ChType ch);
 
-    void reloadAll(RuntimeContext const& rc);
+    template <class Apu>
+    void reloadAll(BasicRuntimeContext<Apu> const& rc);
 
-    void reload(RuntimeContext const& rc, ChType ch);
+    template <class Apu>
+    void reload(BasicRuntimeContext<Apu> const& rc, ChType ch);
 
-    void unlock(RuntimeContext const& rc, ChType ch);
+    template <class Apu>
+    void unlock(BasicRuntimeContext<Apu> const& rc, ChType ch);
 
     void jump(int pattern);
 
-    bool step(RuntimeContext const& rc, Frame &frame);
+    //
+    // Rebinds the runtime to another version of its song, ie an edited copy.
+    // The current position is kept, clamped to the new song's bounds.
+    //
+    void setSong(Song const& song);
+
+    //
+    // Rebinds the instruments in use to the ones in the given table, see
+    // TrackControl::rebind
+    //
+    void rebindInstruments(InstrumentTable const& instrumentTable);
+
+    template <class Apu>
+    bool step(BasicRuntimeContext<Apu> const& rc, Frame &frame);
+
+    //
+    // Determines if the next call to step will start a new row. Always false
+    // when halted.
+    //
+    bool atRowStart() const noexcept;
+
+    //
+    // The timer that paces the rows, ie for comparing the runtime's state at
+    // the start of a row.
+    //
+    Timer const& timer() const noexcept;
 
     void repeatPattern(bool repeat);
 
 private:
 
-    template <ChType ch = ChType::ch1>
-    void update(RuntimeContext const& rc);
+    //
+    // Sets the current row's operations to each track control
+    //
+    void setRows();
+
+    template <ChType ch = ChType::ch1, class Apu>
+    void update(BasicRuntimeContext<Apu> const& rc);
 
-    template <ChType ch = ChType::ch1>
-    void haltChannels(RuntimeContext const& rc);
+    template <ChType ch = ChType::ch1, class Apu>
+    void haltChannels(BasicRuntimeContext<Apu> const& rc);
 
     static constexpr size_t FLAG_LOCK1 = 0;
     static constexpr size_t FLAG_LOCK2 = 1;
@@ -61,7 +100,7 @@ private:
 
     static constexpr size_t DEFAULT_FLAGS = 1 << FLAG_INIT;
 
-    Song const& mSong;
+    Song const* mSong;
 
     int mOrderCounter;
     int mRowCounter;
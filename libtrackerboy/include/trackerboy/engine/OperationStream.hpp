@@ -0,0 +1,45 @@
+
+#pragma once
+
+#include "trackerboy/engine/Operation.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace trackerboy {
+
+class Track;
+
+//
+// Precompiled operations for a Track. Only non-empty rows are stored, already
+// converted to an Operation so that the MusicRuntime does not have to decode
+// a row every time it is played. Streams are immutable, they get rebuilt by
+// the Track after it is modified (see Track::operations).
+//
+class OperationStream {
+
+public:
+
+    explicit OperationStream(Track const& track);
+
+    //
+    // Gets the operation for the given row, or nullptr if the row is empty.
+    //
+    Operation const* find(int row) const noexcept;
+
+    //
+    // Number of operations in the stream (number of non-empty rows)
+    //
+    size_t size() const noexcept;
+
+private:
+
+    // row index for each operation, sorted
+    std::vector<uint8_t> mRows;
+    std::vector<Operation> mOperations;
+
+};
+
+
+}
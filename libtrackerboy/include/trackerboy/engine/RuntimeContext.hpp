@@ -27,22 +27,74 @@
 #include "trackerboy/data/Table.hpp"
 #include "trackerboy/engine/IApu.hpp"
 
+#include <cstdint>
+
 namespace trackerboy {
 
+//
+// Remembers which waveform is loaded in CH3's wave RAM so that ChannelControl
+// can skip uploading a waveform that is already resident. A waveform is
+// identified by its id and content generation, so an edited waveform no longer
+// matches and gets uploaded again.
+//
+// The cache only knows about uploads made through it. It must be invalidated
+// whenever something else may have written to CH3 (ie the channel was handed
+// to a preview, or the APU was reset).
+//
+struct WaveramCache {
+
+    static constexpr int NONE = -1;
+
+    bool isResident(Waveform const& waveform) const noexcept {
+        return id == waveform.id() && generation == waveform.generation();
+    }
+
+    void setResident(Waveform const& waveform) noexcept {
+        id = waveform.id();
+        generation = waveform.generation();
+    }
+
+    void invalidate() noexcept {
+        id = NONE;
+    }
+
+    int id = NONE;
+    uint32_t generation = 0;
+
+};
+
 //
 // The RuntimeContext struct is a utility struct that contains references for
 // the APU and data tables.
 //
-struct RuntimeContext {
+// The context is templated on the APU type so that register writes made by
+// the engine can be resolved at compile time. The engine is instantiated for
+// the following APU types:
+//  - IApu (type-erased, any implementation)
+//  - NullApu
+//  - BufferedApu
+//  - gbapu::Apu
+//
+template <class Apu>
+struct BasicRuntimeContext {
 
-    RuntimeContext(IApu &apu, InstrumentTable const& instrumentTable, WaveformTable const& waveTable);
+    BasicRuntimeContext(Apu &apu, InstrumentTable const& instrumentTable, WaveformTable const& waveTable) :
+        apu(apu),
+        instrumentTable(instrumentTable),
+        waveTable(waveTable)
+    {
+    }
 
-    IApu &apu;
+    Apu &apu;
     InstrumentTable const& instrumentTable;
     WaveformTable const& waveTable;
-
+    // wave RAM contents are state of the APU, not of the context, so the
+    // cache can be updated through a const context
+    mutable WaveramCache waveram;
 
 };
 
+using RuntimeContext = BasicRuntimeContext<IApu>;
+
 
 }
@@ -40,6 +40,11 @@ public:
 
     Speed period() const noexcept;
 
+    //
+    // Current value of the counter, in the same units as the period
+    //
+    Speed counter() const noexcept;
+
     void reset() noexcept;
 
     void setPeriod(Speed period) noexcept;
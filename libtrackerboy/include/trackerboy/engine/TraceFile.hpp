@@ -0,0 +1,66 @@
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace trackerboy {
+
+//
+// Read-only memory mapping of a trace file. The OS pages the trace in as it
+// is played, so a multi-minute trace never needs to be read into memory.
+// Use with TracePlayer:
+//
+//     TraceFile file("song.tbt");
+//     TracePlayer player(file.data(), file.size());
+//
+class TraceFile {
+
+public:
+
+    TraceFile() noexcept;
+
+    //
+    // Maps the file at the given path, std::runtime_error is thrown if the
+    // file could not be opened or mapped.
+    //
+    explicit TraceFile(std::string const& path);
+
+    TraceFile(TraceFile &&file) noexcept;
+    TraceFile& operator=(TraceFile &&file) noexcept;
+
+    TraceFile(TraceFile const&) = delete;
+    TraceFile& operator=(TraceFile const&) = delete;
+
+    ~TraceFile();
+
+    void open(std::string const& path);
+
+    //
+    // Unmaps the file, any TracePlayer using this file must not be used
+    // afterwards.
+    //
+    void close() noexcept;
+
+    bool isOpen() const noexcept;
+
+    uint8_t const* data() const noexcept;
+
+    size_t size() const noexcept;
+
+private:
+
+    uint8_t const* mData;
+    size_t mSize;
+
+#ifdef _WIN32
+    void *mFile;
+    void *mMapping;
+#else
+    int mFd;
+#endif
+
+};
+
+}
@@ -0,0 +1,118 @@
+
+#pragma once
+
+#include "trackerboy/engine/ApuTrace.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace trackerboy {
+
+//
+// Plays back a register write trace (see ApuTrace.hpp) without the Engine.
+// The player reads the trace directly from memory and does not copy it, so
+// large traces can be played from a memory-mapped file (TraceFile).
+//
+// Each call to step writes one frame's worth of register writes to the given
+// apu, which can be a gbapu::Apu or any IApu.
+//
+class TracePlayer {
+
+public:
+
+    //
+    // Constructs a player for the given trace data, which must outlive the
+    // player. std::invalid_argument is thrown if the data is not a trace
+    // or is an unsupported version.
+    //
+    TracePlayer(uint8_t const* data, size_t size);
+
+    float framerate() const noexcept;
+
+    //
+    // Number of frames played since construction or the last rewind
+    //
+    int frame() const noexcept;
+
+    //
+    // Determines if the end of the trace was reached.
+    //
+    bool isFinished() const noexcept;
+
+    //
+    // Restart playback from the beginning of the trace
+    //
+    void rewind() noexcept;
+
+    //
+    // Write the register writes for the next frame to the apu. Returns false
+    // if there are no more frames. std::runtime_error is thrown if the trace
+    // is malformed.
+    //
+    template <class Apu>
+    bool step(Apu &apu);
+
+private:
+
+    [[noreturn]] static void malformed();
+
+    uint8_t const* const mData;
+    size_t const mSize;
+    float mFramerate;
+
+    // read position in mData
+    size_t mPosition;
+    // empty frames left from a CMD_FRAMES command
+    unsigned mEmptyFrames;
+    int mFrame;
+    bool mFinished;
+
+};
+
+template <class Apu>
+bool TracePlayer::step(Apu &apu) {
+    if (mFinished) {
+        return false;
+    }
+
+    if (mEmptyFrames) {
+        --mEmptyFrames;
+        ++mFrame;
+        return true;
+    }
+
+    for (;;) {
+        if (mPosition >= mSize) {
+            malformed();
+        }
+
+        auto const cmd = mData[mPosition++];
+        if (cmd >= trace::CMD_WRITE_FIRST && cmd <= trace::CMD_WRITE_LAST) {
+            if (mPosition >= mSize) {
+                malformed();
+            }
+            apu.writeRegister(cmd, mData[mPosition++]);
+        } else {
+            switch (cmd) {
+                case trace::CMD_END:
+                    mFinished = true;
+                    return false;
+                case trace::CMD_FRAME:
+                    ++mFrame;
+                    return true;
+                case trace::CMD_FRAMES:
+                    if (mPosition >= mSize) {
+                        malformed();
+                    }
+                    // this frame, plus n + 1 more
+                    mEmptyFrames = mData[mPosition++] + 1u;
+                    ++mFrame;
+                    return true;
+                default:
+                    malformed();
+            }
+        }
+    }
+}
+
+}
@@ -0,0 +1,79 @@
+
+#pragma once
+
+#include "trackerboy/engine/ApuTrace.hpp"
+#include "trackerboy/engine/IApu.hpp"
+
+#include <ostream>
+#include <vector>
+
+namespace trackerboy {
+
+//
+// Apu decorator that records all register writes to a trace (see ApuTrace.hpp)
+// while forwarding them to the wrapped apu. Writes are buffered for the
+// current frame and written to the stream when the frame ends, so traces of
+// any length can be recorded without keeping them in memory.
+//
+// Place the recorder after a BufferedApu to record only the writes that
+// change the apu's state.
+//
+class TraceRecorder final : public IApu {
+
+public:
+
+    //
+    // Begins a trace by writing the header to the stream. Both the apu and
+    // stream must outlive the recorder.
+    //
+    TraceRecorder(IApu &apu, std::ostream &stream, float framerate);
+    ~TraceRecorder();
+
+    virtual uint8_t readRegister(uint8_t reg) override;
+
+    virtual void writeRegister(uint8_t reg, uint8_t value) override;
+
+    virtual void writeRegisters(RegisterWrite const* writes, size_t count) override;
+
+    //
+    // Ends the current frame, call this once per step of the engine.
+    //
+    void endFrame();
+
+    //
+    // Ends the trace. The current frame is ended if it has writes. No writes
+    // can be recorded afterwards. std::runtime_error is thrown if writing to
+    // the stream failed at any point.
+    //
+    void finish();
+
+    //
+    // Number of frames recorded
+    //
+    int frames() const noexcept;
+
+    //
+    // Number of register writes recorded
+    //
+    size_t writeCount() const noexcept;
+
+private:
+
+    void record(uint8_t reg, uint8_t value);
+
+    void writeFrames();
+
+    IApu &mApu;
+    std::ostream &mStream;
+
+    // commands for the current frame
+    std::vector<char> mBuffer;
+    // number of ended frames not yet written
+    unsigned mPendingFrames;
+    int mFrames;
+    size_t mWriteCount;
+    bool mFinished;
+
+};
+
+}
@@ -2,13 +2,13 @@
 #pragma once
 
 #include "trackerboy/trackerboy.hpp"
+#include "trackerboy/data/Table.hpp"
 #include "trackerboy/data/TrackRow.hpp"
 #include "trackerboy/engine/Operation.hpp"
 #include "trackerboy/engine/ChannelState.hpp"
 #include "trackerboy/engine/FrequencyControl.hpp"
 #include "trackerboy/engine/GlobalState.hpp"
 #include "trackerboy/engine/InstrumentRuntime.hpp"
-#include "trackerboy/engine/RuntimeContext.hpp"
 
 
 namespace trackerboy {
@@ -20,15 +20,43 @@ public:
 
     void setRow(TrackRow const& row);
 
-    void step(RuntimeContext const& rc, ChannelState &state, GlobalState &global);
+    //
+    // Same as setRow, but uses a precompiled operation. nullptr is an empty
+    // row.
+    //
+    void setOperation(Operation const* op);
+
+    void step(InstrumentTable const& instrumentTable, ChannelState &state, GlobalState &global);
+
+    //
+    // Resolves the instrument in use from another table, ie a snapshot of an
+    // edited module. The instrument is restarted if its data changed or
+    // stopped if it was removed. Must be called while the previous table is
+    // still alive.
+    //
+    void rebind(InstrumentTable const& instrumentTable);
+
+protected:
+
+    //
+    // Points this control to the subclass's frequency control. Subclasses
+    // call this in their copy constructor, since the copied pointer refers
+    // to the other object's frequency control.
+    //
+    void setFrequencyControl(FrequencyControl &fc) noexcept;
 
 private:
 
 
     Operation mOp;
 
-    std::shared_ptr<Instrument> mInstrument;
-    FrequencyControl &mFc;
+    // handle to the instrument in use, resolved every step since the
+    // instrument may be removed from the table during playback
+    InstrumentTable::Handle mInstrument;
+    // the instrument mIr was started with
+    Instrument const* mInstrumentData;
+    // the subclass's mFc
+    FrequencyControl *mFc;
     std::optional<InstrumentRuntime> mIr;
 
     std::optional<uint8_t> mDelayCounter;
@@ -47,6 +75,9 @@ class ToneTrackControl : public TrackControl {
 
 public:
     ToneTrackControl(ChType ch);
+    ToneTrackControl(ToneTrackControl const& ctrl);
+
+    ToneTrackControl& operator=(ToneTrackControl const& ctrl) = delete;
 
 private:
     ToneFrequencyControl mFc;
@@ -58,6 +89,9 @@ class NoiseTrackControl : public TrackControl {
 
 public:
     NoiseTrackControl();
+    NoiseTrackControl(NoiseTrackControl const& ctrl);
+
+    NoiseTrackControl& operator=(NoiseTrackControl const& ctrl) = delete;
 
 private:
     NoiseFrequencyControl mFc;
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "trackerboy/data/Module.hpp"
+#include "trackerboy/engine/BufferedApu.hpp"
+#include "trackerboy/engine/Engine.hpp"
+#include "trackerboy/export/Player.hpp"
+#include "trackerboy/Synth.hpp"
+
+#include <bitset>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace trackerboy {
+
+//
+// Renders a song to 16-bit stereo PCM as fast as possible. The renderer owns
+// its own Engine and Synth so it does not need a sound device or any UI.
+// Samples can be rendered into a caller supplied buffer, or sent to a sink
+// callback in blocks.
+//
+// The module must not be modified while rendering. Since each renderer has its
+// own engine and synth, multiple renderers can render the same module
+// concurrently on separate threads (ie stem export).
+//
+class OfflineRenderer {
+
+public:
+
+    using Clock = std::chrono::steady_clock;
+
+    //
+    // Sink callback, receives count interleaved stereo samples
+    //
+    using Sink = std::function<void(int16_t const* samples, size_t count)>;
+
+    static constexpr size_t DEFAULT_BLOCKSIZE = 8192;
+
+    OfflineRenderer(Module const& mod, int samplerate);
+
+    //
+    // Begin rendering the song at the given index in the module's song list.
+    // std::invalid_argument is thrown if the index is out of bounds. Returns
+    // true if there is something to render.
+    //
+    bool start(int songIndex, Player::Duration duration);
+
+    //
+    // Same as above, but uses the given song instead. The song's lifetime
+    // must be at least until rendering has finished.
+    //
+    bool start(Song const& song, Player::Duration duration);
+
+    //
+    // Enables or disables a channel for the next render. Disabled channels are
+    // unlocked from the engine when the render starts, so they remain silent
+    // for the entire render. All channels are enabled by default.
+    //
+    void setChannelEnabled(ChType ch, bool enabled);
+
+    bool isChannelEnabled(ChType ch) const;
+
+    //
+    // Determines if all samples have been rendered
+    //
+    bool isFinished();
+
+    //
+    // Progress of the render, see Player::progress
+    //
+    int progress() const;
+    int progressMax() const;
+
+    //
+    // Renders up to count samples into the given buffer (count * 2 int16_t's).
+    // The number of samples rendered is returned, which is less than count
+    // only when the render has finished.
+    //
+    size_t render(int16_t *buffer, size_t count);
+
+    //
+    // Renders the rest of the song, sending each block of samples to the sink.
+    //
+    void render(Sink const& sink, size_t blocksize = DEFAULT_BLOCKSIZE);
+
+    int samplerate() const noexcept;
+
+    //
+    // Number of frames stepped since start was called
+    //
+    int framesRendered() const noexcept;
+
+    //
+    // Time spent in render since start was called
+    //
+    Clock::duration elapsed() const noexcept;
+
+    //
+    // Render throughput, in frames rendered per second of elapsed time.
+    // For comparison, realtime playback is Module::framerate() frames per
+    // second.
+    //
+    double framesPerSecond() const noexcept;
+
+private:
+
+    //
+    // Steps the player and synthesizes one frame. Returns false when there
+    // are no more frames to render.
+    //
+    bool stepFrame();
+
+    Module const& mModule;
+    Synth mSynth;
+    GbApu mSynthApu;
+    BufferedApu mApu;
+    BasicEngine<BufferedApu> mEngine;
+    BasicPlayer<BufferedApu> mPlayer;
+
+    std::bitset<4> mEnabledChannels;
+    int mFrames;
+    Clock::duration mElapsed;
+
+};
+
+}
@@ -11,13 +11,15 @@ namespace trackerboy {
 //
 // Player class for exporting music. Steps the engine so that the song is
 // looped a specified number of times or plays for a specified duration.
+// Templated on the engine's APU type, see BasicEngine.
 //
-class Player {
+template <class Apu>
+class BasicPlayer {
 
 public:
     using Duration = std::variant<int, std::chrono::seconds>;
 
-    Player(Engine &engine);
+    BasicPlayer(BasicEngine<Apu> &engine);
 
     void start(Duration duration);
 
@@ -58,7 +60,7 @@ private:
     using ContextVariant = std::variant<std::monostate, LoopContext, DurationContext>;
 
 
-    Engine &mEngine;
+    BasicEngine<Apu> &mEngine;
     Frame mLastFrame;
     bool mPlaying;
     ContextVariant mContext;
@@ -66,4 +68,6 @@ private:
 
 };
 
+using Player = BasicPlayer<IApu>;
+
 }
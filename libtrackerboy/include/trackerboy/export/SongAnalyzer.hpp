@@ -0,0 +1,108 @@
+
+#pragma once
+
+#include "trackerboy/data/Module.hpp"
+#include "trackerboy/data/Song.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace trackerboy {
+
+//
+// Determines the timeline of a song without synthesizing it. The song is
+// played by a MusicRuntime with a NullApu, so the timeline follows the same
+// pattern effect (Bxx, C00, D00, Fxx, Gxx) logic as playback. The result is
+// every row that is played, in order, with the frame it starts on, as well as
+// where the song loops or if it halts.
+//
+// Analysis stops when the song halts or when a row is started again with
+// the same speed and timer state, which is where the song loops. Delayed
+// (Gxx) pattern effects that are still pending when a row starts are not
+// considered part of this state.
+//
+class SongAnalyzer {
+
+public:
+
+    //
+    // A row in the timeline
+    //
+    struct Row {
+        uint8_t order;
+        uint8_t row;
+        // frame the row starts on, relative to the start of the song
+        int frame;
+    };
+
+    SongAnalyzer();
+
+    //
+    // Analyzes the given song. Any previous results are replaced.
+    //
+    void analyze(Module const& mod, Song const& song);
+
+    //
+    // Every row played from the start of the song, until it halts or loops
+    //
+    std::vector<Row> const& timeline() const noexcept;
+
+    //
+    // true if the song stops playing via C00
+    //
+    bool halts() const noexcept;
+
+    //
+    // Index in the timeline that playback returns to after reaching the
+    // end of the timeline. -1 if the song halts.
+    //
+    int loopIndex() const noexcept;
+
+    //
+    // Frame the loop starts on, or -1 if the song halts.
+    //
+    int loopFrame() const noexcept;
+
+    //
+    // Number of frames in a single playthrough of the timeline. If the song
+    // halts, this is the total length of the song.
+    //
+    int totalFrames() const noexcept;
+
+    //
+    // Number of frames needed to play the song the given number of times.
+    // The intro (the part before the loop point) is only played once.
+    //
+    int framesForLoops(int loops) const noexcept;
+
+    //
+    // Gets the frame the given row first starts on, or -1 if the row is
+    // never played.
+    //
+    int frameOf(int orderNo, int patternRow) const;
+
+    //
+    // Converts a frame to its sample position in a render at the given
+    // samplerate. The result may differ from an actual render by one
+    // sample due to rounding.
+    //
+    uint64_t sampleOf(int frame, int samplerate) const noexcept;
+
+private:
+
+    float mFramerate;
+    int mRowSize;
+
+    std::vector<Row> mTimeline;
+    // index in the timeline of the first visit of each row
+    // (order * rowSize + row), -1 if never visited
+    std::vector<int> mFirstVisits;
+
+    bool mHalts;
+    int mLoopIndex;
+    int mTotalFrames;
+
+};
+
+
+}
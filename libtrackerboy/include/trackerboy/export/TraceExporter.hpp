@@ -0,0 +1,22 @@
+
+#pragma once
+
+#include "trackerboy/data/Module.hpp"
+#include "trackerboy/export/Player.hpp"
+
+#include <ostream>
+
+namespace trackerboy {
+
+//
+// Records the register writes of a song to a trace (see ApuTrace.hpp). Only
+// the engine is run, no audio is synthesized. The trace is written to the
+// stream as it is recorded. Returns the number of frames recorded,
+// std::runtime_error is thrown if the stream could not be written to.
+//
+// The trace can be played back with a TracePlayer into a Synth's apu, the
+// synth must be reset beforehand as that turns on the apu.
+//
+int exportTrace(Module const& mod, Song const& song, Player::Duration duration, std::ostream &stream);
+
+}
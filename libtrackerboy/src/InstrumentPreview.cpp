@@ -1,6 +1,7 @@
 
 #include "trackerboy/InstrumentPreview.hpp"
 
+#include "trackerboy/engine/BufferedApu.hpp"
 #include "trackerboy/engine/ChannelControl.hpp"
 
 namespace trackerboy {
@@ -11,7 +12,7 @@ InstrumentPreview::InstrumentPreview() :
     mToneFc(),
     mNoiseFc(),
     mFc(&mToneFc),
-    mInstrument(),
+    mInstrument(nullptr),
     mIr(),
     mInit(false),
     mRetrigger(false),
@@ -19,10 +20,8 @@ InstrumentPreview::InstrumentPreview() :
 {
 }
 
-void InstrumentPreview::setInstrument(std::shared_ptr<Instrument> instrument, std::optional<ChType> ch) {
-    // ensure that the previous instrument is no longer used anywhere else after
-    // hitting this assignment.
-    mInstrument = std::move(instrument);
+void InstrumentPreview::setInstrument(Instrument const* instrument, std::optional<ChType> ch) {
+    mInstrument = instrument;
     if (mInstrument) {
         mCh = ch.value_or(mInstrument->channel());
     } else {
@@ -48,24 +47,28 @@ void InstrumentPreview::play(uint8_t note) {
     restart();
 }
 
-void InstrumentPreview::step(RuntimeContext const& rc) {
+template <class Apu>
+void InstrumentPreview::step(BasicRuntimeContext<Apu> const& rc) {
 
     ChannelState state;
     
     if (mInit) {
         mLastState = ChannelState(mCh);
+        // the channel was taken from whoever was using it, wave RAM may have
+        // been written without our cache knowing
+        rc.waveram.invalidate();
         switch (mCh) {
             case ChType::ch1:
-                ChannelControl<ChType::ch1>::init(rc.apu, rc.waveTable, mLastState);
+                ChannelControl<ChType::ch1>::init(rc.apu, rc.waveTable, rc.waveram, mLastState);
                 break;
             case ChType::ch2:
-                ChannelControl<ChType::ch2>::init(rc.apu, rc.waveTable, mLastState);
+                ChannelControl<ChType::ch2>::init(rc.apu, rc.waveTable, rc.waveram, mLastState);
                 break;
             case ChType::ch3:
-                ChannelControl<ChType::ch3>::init(rc.apu, rc.waveTable, mLastState);
+                ChannelControl<ChType::ch3>::init(rc.apu, rc.waveTable, rc.waveram, mLastState);
                 break;
             case ChType::ch4:
-                ChannelControl<ChType::ch4>::init(rc.apu, rc.waveTable, mLastState);
+                ChannelControl<ChType::ch4>::init(rc.apu, rc.waveTable, rc.waveram, mLastState);
                 break;
         }
         state = mLastState;
@@ -90,16 +93,16 @@ void InstrumentPreview::step(RuntimeContext const& rc) {
 
     switch (mCh) {
         case ChType::ch1:
-            ChannelControl<ChType::ch1>::update(rc.apu, rc.waveTable, mLastState, state);
+            ChannelControl<ChType::ch1>::update(rc.apu, rc.waveTable, rc.waveram, mLastState, state);
             break;
         case ChType::ch2:
-            ChannelControl<ChType::ch2>::update(rc.apu, rc.waveTable, mLastState, state);
+            ChannelControl<ChType::ch2>::update(rc.apu, rc.waveTable, rc.waveram, mLastState, state);
             break;
         case ChType::ch3:
-            ChannelControl<ChType::ch3>::update(rc.apu, rc.waveTable, mLastState, state);
+            ChannelControl<ChType::ch3>::update(rc.apu, rc.waveTable, rc.waveram, mLastState, state);
             break;
         case ChType::ch4:
-            ChannelControl<ChType::ch4>::update(rc.apu, rc.waveTable, mLastState, state);
+            ChannelControl<ChType::ch4>::update(rc.apu, rc.waveTable, rc.waveram, mLastState, state);
             break;
     }
 
@@ -113,7 +116,12 @@ void InstrumentPreview::restart() {
     if (mInstrument) {
         mIr.emplace(*mInstrument);
     }
-    mFc->useInstrument(mInstrument.get());
+    mFc->useInstrument(mInstrument);
 }
 
+template void InstrumentPreview::step<IApu>(BasicRuntimeContext<IApu> const&);
+template void InstrumentPreview::step<NullApu>(BasicRuntimeContext<NullApu> const&);
+template void InstrumentPreview::step<BufferedApu>(BasicRuntimeContext<BufferedApu> const&);
+template void InstrumentPreview::step<gbapu::Apu>(BasicRuntimeContext<gbapu::Apu> const&);
+
 }
@@ -1,6 +1,10 @@
 
 #include "trackerboy/data/Pattern.hpp"
 
+#include <algorithm>
+#include <initializer_list>
+#include <utility>
+
 
 namespace trackerboy {
 
@@ -9,8 +13,7 @@ Pattern::Pattern(Track &track1, Track &track2, Track &track3, Track &track4) :
     mTrack1(&track1),
     mTrack2(&track2),
     mTrack3(&track3),
-    mTrack4(&track4),
-    mRowCount(0)
+    mTrack4(&track4)
 {
 }
 
@@ -21,67 +24,49 @@ PatternRow Pattern::operator[](int row) {
 }
 
 TrackRow& Pattern::getTrackRow(ChType ch, int row) {
-    Track *track;
-    switch (ch) {
-        case ChType::ch1:
-            track = mTrack1;
-            break;
-        case ChType::ch2:
-            track = mTrack2;
-            break;
-        case ChType::ch3:
-            track = mTrack3;
-            break;
-        default:
-            // default is used because gcc complains that track may be uninitialized
-            track = mTrack4;
-            break;
-    }
-    return track->operator[](row);
+    return (*track(ch))[row];
 }
 
 TrackRow const& Pattern::getTrackRow(ChType ch, int row) const {
-    return const_cast<TrackRow const&>(
-        const_cast<Pattern*>(this)->getTrackRow(ch, row)
-        );
+    // read through a const track, so that its operation stream is kept
+    return std::as_const(*track(ch))[row];
 }
 
-int Pattern::size() const {
-    return mTrack1->size();
+Track& Pattern::getTrack(ChType ch) {
+    return *track(ch);
 }
 
-int Pattern::totalRows() {
-    if (mRowCount == 0) {
-
-        std::array iters = { mTrack1->begin(), mTrack2->begin(), mTrack3->begin(), mTrack4->begin() };
-        auto end = mTrack1->end();
-
-        do {
-            ++mRowCount;
-
-            for (auto &iter : iters) {
-
-                // check for effects Bxx, C00 or D00
-                for (int i = 0; i != TrackRow::MAX_EFFECTS; ++i) {
-                    auto effect = iter->effects[i];
-                    if (effect.type == EffectType::patternGoto || 
-                        effect.type == EffectType::patternHalt || 
-                        effect.type == EffectType::patternSkip) {
-                        // these effects stop this pattern short, return the count here
-                        return mRowCount;
-                    }
-                }
-
-                ++iter;
-            }
+Track const& Pattern::getTrack(ChType ch) const {
+    return *track(ch);
+}
 
-            
+int Pattern::size() const {
+    return mTrack1->size();
+}
 
-        } while (iters[0] != end);
-        
+Track* Pattern::track(ChType ch) const noexcept {
+    switch (ch) {
+        case ChType::ch1:
+            return mTrack1;
+        case ChType::ch2:
+            return mTrack2;
+        case ChType::ch3:
+            return mTrack3;
+        default:
+            return mTrack4;
     }
+}
 
-    return mRowCount;
+int Pattern::totalRows() const {
+    // the pattern ends on the first row with a Bxx, C00 or D00 effect
+    int rows = size();
+    for (auto track : { mTrack1, mTrack2, mTrack3, mTrack4 }) {
+        auto const jumpRow = track->firstJumpRow();
+        if (jumpRow != -1) {
+            rows = std::min(rows, jumpRow + 1);
+        }
+    }
+    return rows;
 }
 
 
@@ -8,8 +8,22 @@
 namespace trackerboy {
 
 
+PatternMaster::Channel::Channel() :
+    tracks(),
+    trackSlots()
+{
+    trackSlots.fill(NO_SLOT);
+}
+
+void PatternMaster::Channel::clear() {
+    tracks.clear();
+    trackSlots.fill(NO_SLOT);
+}
+
+
 PatternMaster::PatternMaster(int rows) :
-    mRows(rows)
+    mRows(rows),
+    mChannels()
 {
     if (rows <= 0 || rows > MAX_ROWS) {
         throw std::invalid_argument("invalid row count");
@@ -18,18 +32,13 @@ PatternMaster::PatternMaster(int rows) :
 
 PatternMaster::PatternMaster(const PatternMaster &master) :
     mRows(master.mRows),
-    mMap{
-        Data(master.mMap[0]),
-        Data(master.mMap[1]),
-        Data(master.mMap[2]),
-        Data(master.mMap[3])
-    }
+    mChannels(master.mChannels)
 {
 }
 
 void PatternMaster::clear() {
-    for (auto &trackMap : mMap) {
-        trackMap.clear();
+    for (auto &channel : mChannels) {
+        channel.clear();
     }
 }
 
@@ -48,36 +57,50 @@ Pattern PatternMaster::getPattern(uint8_t track1, uint8_t track2, uint8_t track3
 }
 
 Track& PatternMaster::getTrack(ChType ch, uint8_t track) {
-    auto &chMap = mMap[static_cast<size_t>(ch)];
-    auto iter = chMap.find(track);
+    auto &channel = mChannels[static_cast<size_t>(ch)];
+    auto &slot = channel.trackSlots[track];
+
+    if (channel.tracks.capacity() < MAX_TRACKS) {
+        // reserve for every id so that adding never moves existing tracks.
+        // Copies only have the capacity they need until this is called.
+        channel.tracks.reserve(MAX_TRACKS);
+    }
 
-    if (iter == chMap.end()) {
+    if (slot == NO_SLOT) {
         // track does not exist, add it
-        //TrackData data(mRows);
-        
-        chMap.emplace(track, mRows);
-        iter = chMap.find(track);
+        slot = (uint16_t)channel.tracks.size();
+        channel.tracks.emplace_back(track, Track(mRows));
     }
 
-    return iter->second;
-    //return Track(iter->second.begin(), iter->second.end());
+    return channel.tracks[slot].second;
 }
 
 Track const* PatternMaster::getTrack(ChType ch, uint8_t track) const {
-    auto &chMap = mMap[static_cast<size_t>(ch)];
-    auto iter = chMap.find(track);
+    auto &channel = mChannels[static_cast<size_t>(ch)];
+    auto const slot = channel.trackSlots[track];
 
-    if (iter == chMap.end()) {
+    if (slot == NO_SLOT) {
         return nullptr;
     } else {
-        return &iter->second;
+        return &channel.tracks[slot].second;
     }
 }
 
 void PatternMaster::remove(ChType ch, uint8_t track) {
-    //uint16_t trackIndex = trackId(ch, track);
-    auto &chMap = mMap[static_cast<size_t>(ch)];
-    chMap.erase(track);
+    auto &channel = mChannels[static_cast<size_t>(ch)];
+    auto const slot = channel.trackSlots[track];
+    if (slot == NO_SLOT) {
+        return;
+    }
+
+    // move the last track into the removed one's slot
+    auto &last = channel.tracks.back();
+    if (last.first != track) {
+        channel.trackSlots[last.first] = slot;
+        channel.tracks[slot] = std::move(last);
+    }
+    channel.tracks.pop_back();
+    channel.trackSlots[track] = NO_SLOT;
 }
 
 void PatternMaster::setRowSize(int newsize) {
@@ -86,17 +109,25 @@ void PatternMaster::setRowSize(int newsize) {
     }
     mRows = newsize;
 
-    for (auto &chMap : mMap) {
-        for (auto &iter : chMap) {
-            iter.second.resize(mRows);
+    for (auto &channel : mChannels) {
+        for (auto &pair : channel.tracks) {
+            pair.second.resize(mRows);
+        }
+    }
+}
+
+void PatternMaster::buildOperations() const {
+    for (auto &channel : mChannels) {
+        for (auto &pair : channel.tracks) {
+            (void)pair.second.operations();
         }
     }
 }
 
 size_t PatternMaster::tracks(ChType ch) const noexcept {
     size_t count = 0;
-    for (auto track : mMap[static_cast<size_t>(ch)]) {
-        if (track.second.rowCount() != 0) {
+    for (auto const& pair : mChannels[static_cast<size_t>(ch)].tracks) {
+        if (pair.second.rowCount() != 0) {
             ++count;
         }
     }
@@ -105,26 +136,22 @@ size_t PatternMaster::tracks(ChType ch) const noexcept {
 
 size_t PatternMaster::tracks() const noexcept {
     return tracks(ChType::ch1) + tracks(ChType::ch2) + tracks(ChType::ch3) + tracks(ChType::ch4);
-    //return mMap[+ChType::ch1].size() +
-    //       mMap[+ChType::ch2].size() +
-    //       mMap[+ChType::ch3].size() +
-    //       mMap[+ChType::ch4].size();
 }
 
 PatternMaster::Data::iterator PatternMaster::tracksBegin(ChType ch) {
-    return mMap[static_cast<size_t>(ch)].begin();
+    return mChannels[static_cast<size_t>(ch)].tracks.begin();
 }
 
 PatternMaster::Data::const_iterator PatternMaster::tracksBegin(ChType ch) const {
-    return mMap[static_cast<size_t>(ch)].begin();
+    return mChannels[static_cast<size_t>(ch)].tracks.begin();
 }
 
 PatternMaster::Data::iterator PatternMaster::tracksEnd(ChType ch) {
-    return mMap[static_cast<size_t>(ch)].end();
+    return mChannels[static_cast<size_t>(ch)].tracks.end();
 }
 
 PatternMaster::Data::const_iterator PatternMaster::tracksEnd(ChType ch) const {
-    return mMap[static_cast<size_t>(ch)].end();
+    return mChannels[static_cast<size_t>(ch)].tracks.end();
 }
 
 
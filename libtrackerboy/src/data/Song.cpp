@@ -111,6 +111,11 @@ TrackRow Song::getRow(ChType ch, int order, int row) const {
     }
 }
 
+void Song::setRow(ChType ch, int order, int row, TrackRow const& rowdata) {
+    auto &track = mMaster.getTrack(ch, mOrder[order][static_cast<int>(ch)]);
+    track.replace(row, rowdata);
+}
+
 void Song::setRowsPerBeat(int rowsPerBeat) {
     if (rowsPerBeat <= 0 || rowsPerBeat >= 256) {
         throw std::invalid_argument("invalid rows per beat argument");
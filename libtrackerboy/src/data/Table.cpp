@@ -14,6 +14,13 @@ namespace trackerboy {
 // table. The shared_ptrs are stored in a fixed size array, mData. This way lookup is
 // done by accessing the array by the item's id.
 //
+// Handles pair an id with the generation of the item at the time the handle
+// was made, so a handle to a removed item will not resolve to a new item that
+// took its id.
+//
+// Snapshots copy the array, sharing any item that has the same generation and
+// data as the previous snapshot.
+//
 // The thin-template idiom is used, BaseTable does most of the work. The Table<T> class
 // simply downcasts the result from BaseTable to the templated type.
 */
@@ -22,6 +29,8 @@ namespace trackerboy {
 
 BaseTable::BaseTable() noexcept :
     mData(),
+    mGenerations(),
+    mGeneration(0u),
     mSize(0u),
     mNextId(0u)
 {
@@ -33,6 +42,7 @@ BaseTable::~BaseTable() noexcept {
 
 void BaseTable::clear() noexcept {
     mData.fill(nullptr);
+    mGenerations.fill(0u);
     mSize = 0u;
     mNextId = 0u;
 }
@@ -62,6 +72,7 @@ DataItem& BaseTable::insert(uint8_t id) {
     auto item = createItem();
     item->setId(id);
     cell = std::move(item);
+    mGenerations[id] = ++mGeneration;
     ++mSize;
     if (mNextId == id) {
         findNextId();
@@ -81,6 +92,7 @@ DataItem& BaseTable::duplicate(uint8_t id) {
         auto &result = *item.get();
         item->setId(mNextId);
         mData[mNextId] = std::move(item);
+        mGenerations[mNextId] = ++mGeneration;
         ++mSize;
         findNextId();
         return result;
@@ -100,6 +112,7 @@ void BaseTable::remove(uint8_t id) {
         if (cell) {
             --mSize;
             cell.reset();
+            mGenerations[id] = 0u;
             if (mNextId > id) {
                 mNextId = id;
             }
@@ -132,6 +145,42 @@ std::shared_ptr<DataItem> BaseTable::getShared(uint8_t id) const {
     }
 }
 
+BaseTable::Handle BaseTable::handle(uint8_t id) const noexcept {
+    if (id >= mData.size()) {
+        return { id, 0u };
+    } else {
+        return { id, mGenerations[id] };
+    }
+}
+
+DataItem const* BaseTable::get(Handle handle) const noexcept {
+    if (handle.generation == 0u || handle.id >= mData.size() || mGenerations[handle.id] != handle.generation) {
+        return nullptr;
+    } else {
+        return mData[handle.id].get();
+    }
+}
+
+void BaseTable::snapshotInto(BaseTable &dest, BaseTable const* previous) const {
+    dest.mGenerations = mGenerations;
+    dest.mGeneration = mGeneration;
+    dest.mSize = mSize;
+    dest.mNextId = mNextId;
+
+    for (size_t id = 0; id != mData.size(); ++id) {
+        auto const& item = mData[id];
+        if (item) {
+            if (previous != nullptr &&
+                previous->mGenerations[id] == mGenerations[id] &&
+                hasSameData(*previous->mData[id], *item)) {
+                dest.mData[id] = previous->mData[id];
+            } else {
+                dest.mData[id] = dest.copyItem(*item);
+            }
+        }
+    }
+}
+
 void BaseTable::findNextId() {
     if (size() < MAX_SIZE) {
         // find the next available id
@@ -141,6 +190,31 @@ void BaseTable::findNextId() {
     }
 }
 
+namespace {
+
+bool sameData(Instrument const& lhs, Instrument const& rhs) {
+    if (lhs.channel() != rhs.channel() ||
+        lhs.hasEnvelope() != rhs.hasEnvelope() ||
+        lhs.envelope() != rhs.envelope()) {
+        return false;
+    }
+
+    for (size_t i = 0; i != Instrument::SEQUENCE_COUNT; ++i) {
+        auto const& lseq = lhs.sequence(i);
+        auto const& rseq = rhs.sequence(i);
+        if (lseq.data() != rseq.data() || lseq.loop() != rseq.loop()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool sameData(Waveform const& lhs, Waveform const& rhs) {
+    return lhs.data() == rhs.data();
+}
+
+}
+
 template <class T>
 Table<T>::Table() :
     BaseTable()
@@ -191,6 +265,11 @@ std::shared_ptr<T> Table<T>::getShared(uint8_t id) const {
     return std::static_pointer_cast<T>(BaseTable::getShared(id));
 }
 
+template <class T>
+T const* Table<T>::get(Handle handle) const noexcept {
+    return static_cast<T const*>(BaseTable::get(handle));
+}
+
 template <class T>
 std::shared_ptr<DataItem> Table<T>::createItem() {
     return std::make_shared<T>();
@@ -201,6 +280,18 @@ std::shared_ptr<DataItem> Table<T>::copyItem(DataItem const& item) {
     return std::make_shared<T>(static_cast<T const&>(item));
 }
 
+template <class T>
+std::shared_ptr<Table<T> const> Table<T>::snapshot(Table const* previous) const {
+    auto table = std::make_shared<Table>();
+    snapshotInto(*table, previous);
+    return table;
+}
+
+template <class T>
+bool Table<T>::hasSameData(DataItem const& lhs, DataItem const& rhs) const {
+    return sameData(static_cast<T const&>(lhs), static_cast<T const&>(rhs));
+}
+
 template class Table<Instrument>;
 template class Table<Waveform>;
 
@@ -1,7 +1,9 @@
 
 #include "trackerboy/data/Track.hpp"
+#include "trackerboy/engine/OperationStream.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 
 #ifdef _MSC_VER
@@ -16,66 +18,342 @@ namespace trackerboy {
 
 namespace {
 
-constexpr TrackRow NULL_ROW = { 0 };
 constexpr Effect NULL_EFFECT = { EffectType::noEffect, 0 };
 
+// a sparse track switches to dense storage when more than 1 / DENSE_THRESHOLD
+// of its rows are non-empty. An IndexedRow is about the size of a TrackRow, so
+// at this point the sparse list would be a quarter of the dense array.
+constexpr int DENSE_THRESHOLD = 4;
+
+// count or jump row value for when it needs to be recalculated
+constexpr int STALE = -2;
+
+// jump row value for when the track has no pattern jump effects
+constexpr int NO_JUMP = -1;
+
+bool isSparseEnough(int count, int size) {
+    return count * DENSE_THRESHOLD <= size;
 }
 
+//
+// Determines if the row has an effect that ends the pattern early (Bxx, C00
+// or D00)
+//
+bool hasJump(TrackRow const& row) {
+    for (auto const& effect : row.effects) {
+        if (effect.type == EffectType::patternGoto ||
+            effect.type == EffectType::patternHalt ||
+            effect.type == EffectType::patternSkip) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+struct Track::Storage {
+
+    explicit Storage(int size) :
+        size(size),
+        sparse(true),
+        rows(),
+        entries(),
+        count(0),
+        jumpRow(NO_JUMP),
+        operations(nullptr)
+    {
+    }
+
+    //
+    // Copies the rows of another storage (but not its stream). A dense track
+    // that is mostly empty is copied as sparse.
+    //
+    Storage(Storage const& storage) :
+        size(storage.size),
+        sparse(storage.sparse),
+        rows(),
+        entries(),
+        count(0),
+        jumpRow(storage.jumpRow.load(std::memory_order_relaxed)),
+        operations(nullptr)
+    {
+        if (storage.sparse) {
+            entries = storage.entries;
+        } else {
+            count = storage.rowCount();
+            if (isSparseEnough(count, size)) {
+                sparse = true;
+                entries.reserve(count);
+                for (int i = 0; i < size; ++i) {
+                    if (!storage.rows[i].isEmpty()) {
+                        entries.push_back({ (uint8_t)i, storage.rows[i] });
+                    }
+                }
+            } else {
+                rows = storage.rows;
+            }
+        }
+    }
+
+    ~Storage() {
+        delete operations.load(std::memory_order_acquire);
+    }
+
+    void invalidate() noexcept {
+        if (operations.load(std::memory_order_relaxed) != nullptr) {
+            delete operations.exchange(nullptr);
+        }
+    }
+
+    std::vector<IndexedRow>::iterator find(int row) {
+        return std::lower_bound(entries.begin(), entries.end(), row,
+            [](IndexedRow const& entry, int row) {
+                return entry.row < row;
+            });
+    }
+
+    std::vector<IndexedRow>::const_iterator find(int row) const {
+        return const_cast<Storage*>(this)->find(row);
+    }
+
+    TrackRow const& get(int row) const {
+        if (sparse) {
+            auto iter = find(row);
+            if (iter != entries.end() && iter->row == row) {
+                return iter->data;
+            }
+            return EMPTY_ROW;
+        }
+        return rows[row];
+    }
+
+    int rowCount() const {
+        if (sparse) {
+            return (int)entries.size();
+        }
+        auto result = count.load(std::memory_order_relaxed);
+        if (result == STALE) {
+            result = (int)std::count_if(rows.begin(), rows.end(),
+                [](TrackRow const& row) {
+                    return !row.isEmpty();
+                });
+            count.store(result, std::memory_order_relaxed);
+        }
+        return result;
+    }
+
+    int firstJumpRow() const {
+        auto result = jumpRow.load(std::memory_order_relaxed);
+        if (result == STALE) {
+            result = NO_JUMP;
+            if (sparse) {
+                for (auto const& entry : entries) {
+                    if (hasJump(entry.data)) {
+                        result = entry.row;
+                        break;
+                    }
+                }
+            } else {
+                for (int i = 0; i < size; ++i) {
+                    if (hasJump(rows[i])) {
+                        result = i;
+                        break;
+                    }
+                }
+            }
+            jumpRow.store(result, std::memory_order_relaxed);
+        }
+        return result;
+    }
+
+    //
+    // Updates the jump row after the given row was modified
+    //
+    void updateJumpRow(int row, TrackRow const& data) {
+        auto const current = jumpRow.load(std::memory_order_relaxed);
+        if (current == STALE) {
+            return;
+        }
+        if (hasJump(data)) {
+            if (current == NO_JUMP || row < current) {
+                jumpRow.store(row, std::memory_order_relaxed);
+            }
+        } else if (row == current) {
+            // the first jump was removed, find the next one when needed
+            jumpRow.store(STALE, std::memory_order_relaxed);
+        }
+    }
+
+    //
+    // Modifies a single row with the given function, keeping the count and
+    // jump row.
+    //
+    template <class Fn>
+    void modify(int row, Fn fn) {
+        assert(row >= 0 && row < size);
+
+        if (sparse) {
+            auto iter = find(row);
+            bool const found = iter != entries.end() && iter->row == row;
+            TrackRow data = found ? iter->data : EMPTY_ROW;
+            fn(data);
+            updateJumpRow(row, data);
+            if (data.isEmpty()) {
+                if (found) {
+                    entries.erase(iter);
+                }
+            } else if (found) {
+                iter->data = data;
+            } else {
+                entries.insert(iter, { (uint8_t)row, data });
+                if (!isSparseEnough((int)entries.size(), size)) {
+                    makeDense();
+                }
+            }
+        } else {
+            auto &data = rows[row];
+            bool const wasEmpty = data.isEmpty();
+            fn(data);
+            updateJumpRow(row, data);
+            bool const isEmpty = data.isEmpty();
+            auto const current = count.load(std::memory_order_relaxed);
+            if (current != STALE && wasEmpty != isEmpty) {
+                count.store(current + (wasEmpty ? 1 : -1), std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void clear(int rowStart, int rowEnd) {
+        if (rowStart >= rowEnd) {
+            return;
+        }
+
+        if (sparse) {
+            entries.erase(find(rowStart), find(rowEnd));
+        } else {
+            std::fill(rows.begin() + rowStart, rows.begin() + rowEnd, EMPTY_ROW);
+            count.store(STALE, std::memory_order_relaxed);
+        }
+
+        auto const jump = jumpRow.load(std::memory_order_relaxed);
+        if (jump >= rowStart && jump < rowEnd) {
+            jumpRow.store(STALE, std::memory_order_relaxed);
+        }
+    }
+
+    void resize(int newSize) {
+        if (sparse) {
+            entries.erase(find(newSize), entries.end());
+        } else {
+            rows.resize(newSize);
+            if (newSize < size) {
+                count.store(STALE, std::memory_order_relaxed);
+            }
+        }
+        if (jumpRow.load(std::memory_order_relaxed) >= newSize) {
+            // every jump was at or past the new size
+            jumpRow.store(NO_JUMP, std::memory_order_relaxed);
+        }
+        size = newSize;
+    }
+
+    void makeDense() {
+        if (sparse) {
+            rows.assign(size, EMPTY_ROW);
+            for (auto const& entry : entries) {
+                rows[entry.row] = entry.data;
+            }
+            count.store((int)entries.size(), std::memory_order_relaxed);
+            entries.clear();
+            entries.shrink_to_fit();
+            sparse = false;
+        }
+    }
+
+    int size;
+    bool sparse;
+
+    // all rows, used when dense
+    Data rows;
+    // non-empty rows sorted by row index, used when sparse
+    std::vector<IndexedRow> entries;
+    // number of non-empty rows when dense, or STALE. Atomic since a shared
+    // (const) track may recount on multiple threads
+    mutable std::atomic_int count;
+    // index of the first row with a pattern jump effect, NO_JUMP or STALE
+    mutable std::atomic_int jumpRow;
+
+    // owned, nullptr when the stream needs to be built. Once built, getting
+    // the stream is just an atomic load (no refcounting)
+    std::atomic<OperationStream const*> operations;
+
+};
+
 Track::Track(int rows) :
-    mData(rows)
+    mStorage(std::make_shared<Storage>(rows))
 {
 }
 
 TrackRow& Track::operator[](int row) {
-    return mData[row];
+    return detachDense()[row];
 }
 
 TrackRow const& Track::operator[](int row) const {
-    return mData[row];
+    return mStorage->get(row);
 }
 
 Track::Data::iterator Track::begin() {
-    return mData.begin();
+    return detachDense().begin();
 }
 
-Track::Data::const_iterator Track::begin() const {
-    return mData.begin();
+Track::ConstIterator Track::begin() const {
+    auto const& storage = *mStorage;
+    if (storage.sparse) {
+        auto entries = storage.entries.data();
+        return { nullptr, entries, entries + storage.entries.size(), 0 };
+    } else {
+        return { storage.rows.data(), nullptr, nullptr, 0 };
+    }
 }
 
 void Track::clear(int rowStart, int rowEnd) {
-
-    int size = std::min(static_cast<int>(mData.size()), rowEnd);
-    auto iter = mData.begin() + rowStart;
-    for (int i = rowStart; i < size; ++i) {
-        *iter++ = NULL_ROW;
-    }
+    auto &storage = detach();
+    storage.clear(rowStart, std::min(storage.size, rowEnd));
 }
 
 void Track::clearEffect(int rowNo, int effectNo) {
     assert(effectNo < TrackRow::MAX_EFFECTS);
 
-    auto &row = mData[rowNo];
-    row.effects[effectNo] = NULL_EFFECT;
-
+    detach().modify(rowNo, [effectNo](TrackRow &row) {
+        row.effects[effectNo] = NULL_EFFECT;
+    });
 }
 
 void Track::clearInstrument(int rowNo) {
-    auto &row = mData[rowNo];
-    row.setInstrument({});
-
+    detach().modify(rowNo, [](TrackRow &row) {
+        row.setInstrument({});
+    });
 }
 
 void Track::clearNote(int rowNo) {
-    auto &row = mData[rowNo];
-    row.setNote({});
+    detach().modify(rowNo, [](TrackRow &row) {
+        row.setNote({});
+    });
 }
 
 Track::Data::iterator Track::end() {
-    return mData.end();
+    return detachDense().end();
 }
 
-Track::Data::const_iterator Track::end() const {
-    return mData.end();
+Track::ConstIterator Track::end() const {
+    auto const& storage = *mStorage;
+    if (storage.sparse) {
+        auto entriesEnd = storage.entries.data() + storage.entries.size();
+        return { nullptr, entriesEnd, entriesEnd, storage.size };
+    } else {
+        return { storage.rows.data(), nullptr, nullptr, storage.size };
+    }
 }
 
 void Track::setEffect(int rowNo, int effectNo, EffectType effect, uint8_t param) {
@@ -86,43 +364,112 @@ void Track::setEffect(int rowNo, int effectNo, EffectType effect, uint8_t param)
         return;
     }
 
-    auto &row = mData[rowNo];
-    auto &effectSt = row.effects[effectNo];
-    effectSt.type = effect;
-    effectSt.param = param;
+    detach().modify(rowNo, [=](TrackRow &row) {
+        auto &effectSt = row.effects[effectNo];
+        effectSt.type = effect;
+        effectSt.param = param;
+    });
 }
 
 void Track::setInstrument(int rowNo, uint8_t instrumentId) {
-    auto &row = mData[rowNo];
-    row.setInstrument(instrumentId);
+    detach().modify(rowNo, [instrumentId](TrackRow &row) {
+        row.setInstrument(instrumentId);
+    });
 }
 
 void Track::setNote(int rowNo, uint8_t note) {
-    auto &row = mData[rowNo];
-    row.setNote(note);
+    detach().modify(rowNo, [note](TrackRow &row) {
+        row.setNote(note);
+    });
 }
 
-void Track::replace(int rowNo, TrackRow &row) {
-    // TODO: this function is now useless, remove it
-    mData[rowNo] = row;
+void Track::replace(int rowNo, TrackRow const& row) {
+    detach().modify(rowNo, [&row](TrackRow &dest) {
+        dest = row;
+    });
 }
 
 void Track::resize(int newSize) {
-    mData.resize(newSize);
+    detach().resize(newSize);
 }
 
 int Track::rowCount() const {
-    int count = 0;
-    for (auto &row : mData) {
-        if (!row.isEmpty()) {
-            ++count;
+    return mStorage->rowCount();
+}
+
+int Track::size() const {
+    return mStorage->size;
+}
+
+Track::NonEmptyRows Track::nonEmptyRows() const {
+    auto const& storage = *mStorage;
+    if (storage.sparse) {
+        auto entries = storage.entries.data();
+        return {
+            { nullptr, 0, storage.size, entries },
+            { nullptr, 0, storage.size, entries + storage.entries.size() }
+        };
+    } else {
+        auto rows = storage.rows.data();
+        return {
+            { rows, 0, storage.size, nullptr },
+            { rows, storage.size, storage.size, nullptr }
+        };
+    }
+}
+
+int Track::firstJumpRow() const {
+    return mStorage->firstJumpRow();
+}
+
+bool Track::isSparse() const noexcept {
+    return mStorage->sparse;
+}
+
+OperationStream const& Track::operations() const {
+    auto &cache = mStorage->operations;
+    auto operations = cache.load(std::memory_order_acquire);
+    if (operations == nullptr) {
+        // build the stream, if multiple threads get here at the same time
+        // only the first one to finish keeps its stream
+        auto built = new OperationStream(*this);
+        if (cache.compare_exchange_strong(operations, built, std::memory_order_acq_rel)) {
+            operations = built;
+        } else {
+            delete built;
         }
     }
-    return count;
+    return *operations;
 }
 
-int Track::size() const {
-    return (int)mData.size();
+bool Track::hasOperations() const noexcept {
+    return mStorage->operations.load(std::memory_order_acquire) != nullptr;
+}
+
+bool Track::isShared() const noexcept {
+    return mStorage.use_count() > 1;
+}
+
+Track::Storage& Track::detach() {
+    if (isShared()) {
+        // copy on write, the other owners keep the old rows and stream
+        mStorage = std::make_shared<Storage>(*mStorage);
+    } else {
+        // sole owner, but the last reader may have released its copy on
+        // another thread (after building the stream)
+        std::atomic_thread_fence(std::memory_order_acquire);
+        mStorage->invalidate();
+    }
+    return *mStorage;
+}
+
+Track::Data& Track::detachDense() {
+    auto &storage = detach();
+    storage.makeDense();
+    // the caller can modify rows through the reference, recount later
+    storage.count.store(STALE, std::memory_order_relaxed);
+    storage.jumpRow.store(STALE, std::memory_order_relaxed);
+    return storage.rows;
 }
 
 
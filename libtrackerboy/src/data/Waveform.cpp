@@ -1,33 +1,48 @@
 
 #include "trackerboy/data/Waveform.hpp"
 
+#include <atomic>
 #include <sstream>
 #include <iomanip>
 
 namespace trackerboy {
 
+namespace {
+
+std::atomic_uint32_t nextGeneration(0);
+
+uint32_t newGeneration() noexcept {
+    return nextGeneration.fetch_add(1, std::memory_order_relaxed);
+}
+
+}
+
 
 Waveform::Waveform() noexcept :
     DataItem(),
-    mData{0}
+    mData{0},
+    mGeneration(newGeneration())
 {       
 }
 
 Waveform::Waveform(std::string const& hexstr) :
-    mData{ 0 }
+    mData{ 0 },
+    mGeneration(0)
 {
     fromString(hexstr);
 }
 
 Waveform::Waveform(const Waveform &wave) :
     DataItem(wave),
-    mData{ 0 }
+    mData{ 0 },
+    mGeneration(wave.mGeneration)
 {
     std::copy(wave.mData.begin(), wave.mData.end(), mData.begin());
 }
 
 
 Waveform::Data& Waveform::data() noexcept {
+    mGeneration = newGeneration();
     return mData;
 }
 
@@ -35,7 +50,12 @@ Waveform::Data const& Waveform::data() const noexcept {
     return mData;
 }
 
+uint32_t Waveform::generation() const noexcept {
+    return mGeneration;
+}
+
 void Waveform::fromString(std::string const& hexstring) {
+    mGeneration = newGeneration();
     for (size_t pos = 0, i = 0; pos < hexstring.size() && i != mData.size(); pos += 2, ++i) {
         std::string sub = hexstring.substr(pos, 2);
         uint8_t byte = (uint8_t)std::stoul(sub, nullptr, 16);
@@ -60,6 +80,11 @@ std::string Waveform::toString() const {
 }
 
 uint8_t& Waveform::operator[](int index) {
+    mGeneration = newGeneration();
+    return mData[index];
+}
+
+uint8_t Waveform::operator[](int index) const {
     return mData[index];
 }
 
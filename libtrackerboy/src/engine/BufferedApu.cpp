@@ -0,0 +1,149 @@
+
+#include "trackerboy/engine/BufferedApu.hpp"
+
+namespace trackerboy {
+
+namespace {
+
+constexpr uint8_t REG_BASE = gbapu::Apu::REG_NR10;
+
+constexpr uint64_t regbit(uint8_t reg) {
+    return (uint64_t)1 << (reg - REG_BASE);
+}
+
+constexpr uint64_t TRIGGER_MASK =
+    regbit(gbapu::Apu::REG_NR14) |
+    regbit(gbapu::Apu::REG_NR24) |
+    regbit(gbapu::Apu::REG_NR34) |
+    regbit(gbapu::Apu::REG_NR44);
+
+constexpr uint64_t WAVERAM_MASK = (uint64_t)0xFFFF << (gbapu::Apu::REG_WAVERAM - REG_BASE);
+
+constexpr unsigned NR30_INDEX = gbapu::Apu::REG_NR30 - REG_BASE;
+
+}
+
+BufferedApu::BufferedApu(IApu &apu) :
+    IApu(),
+    mApu(apu),
+    mRegisters(),
+    mCommitted(),
+    mDirty(0),
+    mValid(0),
+    mTriggers(0),
+    mWriteCount(0)
+{
+}
+
+BufferedApu::~BufferedApu() {
+
+}
+
+uint8_t BufferedApu::readRegister(uint8_t reg) {
+    unsigned index = (uint8_t)(reg - REG_BASE);
+    if (index < REGISTER_COUNT) {
+        return mRegisters[index];
+    } else {
+        return (uint8_t)0;
+    }
+}
+
+void BufferedApu::writeRegister(uint8_t reg, uint8_t value) {
+    unsigned index = (uint8_t)(reg - REG_BASE);
+    if (index >= REGISTER_COUNT) {
+        // not a sound register, ignore
+        return;
+    }
+
+    uint64_t const bit = (uint64_t)1 << index;
+    if ((bit & TRIGGER_MASK) && (value & 0x80)) {
+        // the trigger bit is a strobe, keep track of it separately so that
+        // it doesn't get mistaken for a redundant write
+        mTriggers |= bit;
+        value &= 0x7F;
+    }
+
+    mRegisters[index] = value;
+    mDirty |= bit;
+}
+
+void BufferedApu::flush() {
+
+    if (!mDirty) {
+        return;
+    }
+
+    // enough room for every register, plus turning the DAC off for a waveram upload
+    std::array<RegisterWrite, REGISTER_COUNT + 1> writes;
+    size_t count = 0;
+
+    // remove writes that would not change the apu's state
+    uint64_t pending = mDirty;
+    for (unsigned i = 0; i != REGISTER_COUNT; ++i) {
+        uint64_t const bit = (uint64_t)1 << i;
+        if ((pending & bit) && (mValid & bit) && !(mTriggers & bit) && mRegisters[i] == mCommitted[i]) {
+            pending &= ~bit;
+        }
+    }
+
+    if (pending & WAVERAM_MASK) {
+        // waveram can only be written with CH3's DAC off
+        uint64_t const nr30 = (uint64_t)1 << NR30_INDEX;
+        if (!(mValid & nr30) || mCommitted[NR30_INDEX] != 0) {
+            writes[count++] = { gbapu::Apu::REG_NR30, 0x00 };
+            mCommitted[NR30_INDEX] = 0;
+            mValid |= nr30;
+            // the DAC setting gets restored below
+            if (mRegisters[NR30_INDEX] != 0) {
+                pending |= nr30;
+            }
+        }
+
+        // the write order is by address, so waveram must be done before NR30
+        for (unsigned i = gbapu::Apu::REG_WAVERAM - REG_BASE; i != REGISTER_COUNT; ++i) {
+            if (pending & ((uint64_t)1 << i)) {
+                writes[count++] = { (uint8_t)(REG_BASE + i), mRegisters[i] };
+                mCommitted[i] = mRegisters[i];
+            }
+        }
+        mValid |= pending & WAVERAM_MASK;
+        pending &= ~WAVERAM_MASK;
+    }
+
+    // channel registers are written in address order, so NRx4 (retrigger) is
+    // always written after the channel's other registers
+    for (unsigned i = 0; pending; ++i) {
+        uint64_t const bit = (uint64_t)1 << i;
+        if (pending & bit) {
+            uint8_t value = mRegisters[i];
+            mCommitted[i] = value;
+            if (mTriggers & bit) {
+                value |= 0x80;
+            }
+            writes[count++] = { (uint8_t)(REG_BASE + i), value };
+            pending &= ~bit;
+        }
+    }
+    mValid |= mDirty;
+    mDirty = 0;
+    mTriggers = 0;
+
+    if (count) {
+        mApu.writeRegisters(writes.data(), count);
+        mWriteCount += count;
+    }
+}
+
+void BufferedApu::reset() noexcept {
+    mRegisters.fill(0);
+    mCommitted.fill(0);
+    mDirty = 0;
+    mValid = 0;
+    mTriggers = 0;
+}
+
+size_t BufferedApu::writeCount() const noexcept {
+    return mWriteCount;
+}
+
+}
@@ -0,0 +1,125 @@
+
+#include "trackerboy/engine/CheckpointCache.hpp"
+
+#include <stdexcept>
+
+namespace trackerboy {
+
+CheckpointCache::CheckpointCache(int interval) :
+    mInterval(interval),
+    mApu(),
+    mSong(nullptr),
+    mVisits(),
+    mCheckpoints(),
+    mBuilder(),
+    mRowsVisited(0),
+    mComplete(false)
+{
+    if (interval <= 0) {
+        throw std::invalid_argument("checkpoint interval must be greater than 0");
+    }
+}
+
+int CheckpointCache::interval() const noexcept {
+    return mInterval;
+}
+
+size_t CheckpointCache::size() const noexcept {
+    return mCheckpoints.size();
+}
+
+void CheckpointCache::invalidate() noexcept {
+    mSong = nullptr;
+    mVisits.clear();
+    mCheckpoints.clear();
+    mBuilder.reset();
+    mRowsVisited = 0;
+    mComplete = false;
+}
+
+std::optional<MusicRuntime> CheckpointCache::seek(Module const& mod, Song const& song, int orderNo, int patternRow) {
+    return seek(mod.instrumentTable(), mod.waveformTable(), song, orderNo, patternRow);
+}
+
+std::optional<MusicRuntime> CheckpointCache::seek(
+    InstrumentTable const& instrumentTable,
+    WaveformTable const& waveTable,
+    Song const& song,
+    int orderNo,
+    int patternRow
+) {
+    if (mSong != &song) {
+        invalidate();
+        mSong = &song;
+    }
+
+    auto const rowSize = song.patterns().rowSize();
+    if (!mBuilder) {
+        mVisits.assign((size_t)song.order().size() * rowSize, -1);
+        mBuilder.emplace(song, 0, 0);
+    }
+
+    BasicRuntimeContext<NullApu> rc(mApu, instrumentTable, waveTable);
+
+    auto const key = (size_t)orderNo * rowSize + patternRow;
+    while (mVisits[key] == -1 && advance(rc)) {
+        // keep building checkpoints until we find the row
+    }
+
+    auto const visit = mVisits[key];
+    if (visit == -1) {
+        return std::nullopt;
+    }
+
+    std::optional<MusicRuntime> runtime;
+    runtime.emplace(mCheckpoints[visit / mInterval]);
+    Frame frame;
+    for (int rows = visit % mInterval; rows; --rows) {
+        stepRow(rc, *runtime, frame);
+    }
+    return runtime;
+}
+
+bool CheckpointCache::stepRow(BasicRuntimeContext<NullApu> const& rc, MusicRuntime &runtime, Frame &frame) {
+    do {
+        if (runtime.step(rc, frame)) {
+            return false;
+        }
+    } while (!runtime.atRowStart());
+    return true;
+}
+
+bool CheckpointCache::advance(BasicRuntimeContext<NullApu> const& rc) {
+    if (mComplete) {
+        return false;
+    }
+
+    std::optional<MusicRuntime> checkpoint;
+    if (mRowsVisited % mInterval == 0) {
+        checkpoint.emplace(*mBuilder);
+    }
+
+    Frame frame;
+    if (!stepRow(rc, *mBuilder, frame)) {
+        // song halted
+        mComplete = true;
+        return false;
+    }
+
+    auto &visit = mVisits[(size_t)frame.order * mSong->patterns().rowSize() + frame.row];
+    if (visit != -1) {
+        // the song has looped, every reachable row has been visited
+        mComplete = true;
+        return false;
+    }
+
+    visit = mRowsVisited;
+    if (checkpoint) {
+        mCheckpoints.push_back(std::move(*checkpoint));
+    }
+    ++mRowsVisited;
+    return true;
+}
+
+
+}
@@ -1,5 +1,6 @@
 
 #include "trackerboy/engine/Engine.hpp"
+#include "trackerboy/engine/BufferedApu.hpp"
 #include "trackerboy/engine/ChannelControl.hpp"
 
 #include <stdexcept>
@@ -7,12 +8,14 @@
 namespace trackerboy {
 
 
-Engine::Engine(IApu &apu, Module const* mod) :
+template <class Apu>
+BasicEngine<Apu>::BasicEngine(Apu &apu, Module const* mod) :
     mApu(apu),
     mModule(mod),
     mRc(),
     mMusicContext(),
     mSong(nullptr),
+    mCheckpoints(),
     mTime(0),
     mPatternRepeat(false)
 {
@@ -21,14 +24,17 @@ Engine::Engine(IApu &apu, Module const* mod) :
     }
 }
 
-Module const* Engine::getModule() const {
+template <class Apu>
+Module const* BasicEngine<Apu>::getModule() const {
     return mModule;
 }
 
-void Engine::setModule(Module const* mod) {
+template <class Apu>
+void BasicEngine<Apu>::setModule(Module const* mod) {
     if (mModule != mod) {
         mModule = mod;
         mMusicContext.reset();
+        mCheckpoints.invalidate();
         if (mod == nullptr) {
             mRc.reset();
         } else {
@@ -37,23 +43,50 @@ void Engine::setModule(Module const* mod) {
     }
 }
 
-Song const* Engine::getSong() const {
+template <class Apu>
+Song const* BasicEngine<Apu>::getSong() const {
     return mSong;
 }
 
-void Engine::setSong(Song const* song) {
-    mSong = song;
+template <class Apu>
+void BasicEngine<Apu>::setSong(Song const* song) {
+    if (mSong != song) {
+        mSong = song;
+        mCheckpoints.invalidate();
+        if (mMusicContext) {
+            if (song == nullptr) {
+                mMusicContext.reset();
+            } else {
+                mMusicContext->setSong(*song);
+            }
+        }
+    }
 }
 
-bool Engine::canPlay() const {
+template <class Apu>
+void BasicEngine<Apu>::setTables(InstrumentTable const& instrumentTable, WaveformTable const& waveTable) {
+    // wave RAM is unaffected by the table change, keep what is resident
+    auto const waveram = mRc ? mRc->waveram : WaveramCache();
+    mRc.emplace(mApu, instrumentTable, waveTable);
+    mRc->waveram = waveram;
+    if (mMusicContext) {
+        mMusicContext->rebindInstruments(instrumentTable);
+    }
+}
+
+template <class Apu>
+bool BasicEngine<Apu>::canPlay() const {
     return mRc.has_value() && mSong;
 }
 
-void Engine::reset() {
+template <class Apu>
+void BasicEngine<Apu>::reset() {
     mMusicContext.reset();
+    mCheckpoints.invalidate();
 }
 
-void Engine::play(int orderNo, int patternRow) {
+template <class Apu>
+void BasicEngine<Apu>::play(int orderNo, int patternRow) {
     if (canPlay()) {
         auto const& song = *mSong;
         if (orderNo < 0 || orderNo >= song.order().size()) {
@@ -63,24 +96,55 @@ void Engine::play(int orderNo, int patternRow) {
             throw std::invalid_argument("cannot start at given row, exceeds pattern size");
         }
 
-        mMusicContext.emplace(song, orderNo, patternRow, mPatternRepeat);
+        if (orderNo == 0 && patternRow == 0) {
+            // nothing to restore when starting from the beginning
+            mMusicContext.reset();
+            mMusicContext.emplace(song, orderNo, patternRow, mPatternRepeat);
+            mTime = 0;
+        } else if (auto runtime = mCheckpoints.seek(mRc->instrumentTable, mRc->waveTable, song, orderNo, patternRow)) {
+            play(*runtime);
+        } else {
+            // row is unreachable from the beginning of the song, start fresh
+            mMusicContext.reset();
+            mMusicContext.emplace(song, orderNo, patternRow, mPatternRepeat);
+            mTime = 0;
+        }
+    }
+}
+
+template <class Apu>
+void BasicEngine<Apu>::play(MusicRuntime const& runtime) {
+    if (canPlay()) {
+        mMusicContext.reset();
+        mMusicContext.emplace(runtime);
+        mMusicContext->repeatPattern(mPatternRepeat);
+        // write the restored state to the apu
+        mMusicContext->reloadAll(*mRc);
         mTime = 0;
     }
 }
 
-void Engine::halt() {
+template <class Apu>
+void BasicEngine<Apu>::invalidateCheckpoints() {
+    mCheckpoints.invalidate();
+}
+
+template <class Apu>
+void BasicEngine<Apu>::halt() {
     if (mMusicContext) {
         mMusicContext->halt(*mRc);
     }
 }
 
-void Engine::jump(int pattern) {
+template <class Apu>
+void BasicEngine<Apu>::jump(int pattern) {
     if (mMusicContext) {
         mMusicContext->jump(pattern);
     }
 }
 
-void Engine::lock(ChType ch) {
+template <class Apu>
+void BasicEngine<Apu>::lock(ChType ch) {
     if (mMusicContext) {
         mMusicContext->lock(*mRc, ch);
     } else {
@@ -88,27 +152,35 @@ void Engine::lock(ChType ch) {
     }
 }
 
-void Engine::reload() {
+template <class Apu>
+void BasicEngine<Apu>::reload() {
+    if (mRc) {
+        // registers are reloaded when the APU was reset, wave RAM is unknown
+        mRc->waveram.invalidate();
+    }
     if (mMusicContext) {
         mMusicContext->reloadAll(*mRc);
     }
 }
 
-void Engine::unlock(ChType ch) {
+template <class Apu>
+void BasicEngine<Apu>::unlock(ChType ch) {
     clearChannel(ch);
     if (mMusicContext) {
         mMusicContext->unlock(*mRc, ch);
     }
 }
 
-void Engine::repeatPattern(bool repeat) {
+template <class Apu>
+void BasicEngine<Apu>::repeatPattern(bool repeat) {
     if (mMusicContext) {
         mMusicContext->repeatPattern(repeat);
     }
     mPatternRepeat = repeat;
 }
 
-void Engine::step(Frame &frame) {
+template <class Apu>
+void BasicEngine<Apu>::step(Frame &frame) {
 
     if (mMusicContext) {
         frame.time = mTime;
@@ -126,7 +198,8 @@ void Engine::step(Frame &frame) {
     
 }
 
-void Engine::clearChannel(ChType ch) {
+template <class Apu>
+void BasicEngine<Apu>::clearChannel(ChType ch) {
     // clear the channel (all registers + panning get zero'd)
 
     switch (ch) {
@@ -138,6 +211,11 @@ void Engine::clearChannel(ChType ch) {
             break;
         case ChType::ch3:
             ChannelControl<ChType::ch3>::clear(mApu);
+            if (mRc) {
+                // the channel may be used by something else until it is
+                // locked again
+                mRc->waveram.invalidate();
+            }
             break;
         case ChType::ch4:
             ChannelControl<ChType::ch4>::clear(mApu);
@@ -146,5 +224,10 @@ void Engine::clearChannel(ChType ch) {
     
 }
 
+template class BasicEngine<IApu>;
+template class BasicEngine<NullApu>;
+template class BasicEngine<BufferedApu>;
+template class BasicEngine<gbapu::Apu>;
+
 
 }
@@ -9,6 +9,12 @@ IApu::~IApu() {
 
 }
 
+void IApu::writeRegisters(RegisterWrite const* writes, size_t count) {
+    for (size_t i = 0; i != count; ++i) {
+        writeRegister(writes[i].reg, writes[i].value);
+    }
+}
+
 
 NullApu::NullApu() :
     IApu()
@@ -30,6 +36,12 @@ void NullApu::writeRegister(uint8_t reg, uint8_t value) {
     // do nothing
 }
 
+void NullApu::writeRegisters(RegisterWrite const* writes, size_t count) {
+    (void)writes;
+    (void)count;
+    // do nothing
+}
+
 GbApu::GbApu(gbapu::Apu &apu) :
     IApu(),
     mApu(apu)
@@ -48,4 +60,10 @@ void GbApu::writeRegister(uint8_t reg, uint8_t value) {
     mApu.writeRegister(reg, value);
 }
 
+void GbApu::writeRegisters(RegisterWrite const* writes, size_t count) {
+    for (size_t i = 0; i != count; ++i) {
+        mApu.writeRegister(writes[i].reg, writes[i].value);
+    }
+}
+
 }
@@ -1,13 +1,15 @@
 
 #include "trackerboy/engine/MusicRuntime.hpp"
+#include "trackerboy/engine/BufferedApu.hpp"
 #include "trackerboy/engine/ChannelControl.hpp"
+#include "trackerboy/engine/OperationStream.hpp"
 
 #include "internal/enumutils.hpp"
 
 namespace trackerboy {
 
 MusicRuntime::MusicRuntime(Song const& song, int orderNo, int patternRow, bool patternRepeat) :
-    mSong(song),
+    mSong(&song),
     mOrderCounter(orderNo),
     mRowCounter(patternRow),
     mPatternRepeat(patternRepeat),
@@ -28,17 +30,38 @@ MusicRuntime::MusicRuntime(Song const& song, int orderNo, int patternRow, bool p
     mTimer.setPeriod(song.speed());
 }
 
-void MusicRuntime::halt(RuntimeContext const &rc) {
+template <class Apu>
+void MusicRuntime::halt(BasicRuntimeContext<Apu> const& rc) {
     mFlags.set(FLAG_HALT);
     haltChannels(rc);
 }
 
+void MusicRuntime::setSong(Song const& song) {
+    mSong = &song;
+    auto const orders = (int)song.order().size();
+    if (mOrderCounter >= orders) {
+        mOrderCounter = orders - 1;
+    }
+    auto const rows = song.patterns().rowSize();
+    if (mRowCounter >= rows) {
+        mRowCounter = rows - 1;
+    }
+}
+
+void MusicRuntime::rebindInstruments(InstrumentTable const& instrumentTable) {
+    mTc1.rebind(instrumentTable);
+    mTc2.rebind(instrumentTable);
+    mTc3.rebind(instrumentTable);
+    mTc4.rebind(instrumentTable);
+}
+
 void MusicRuntime::jump(int pattern) {
     mOrderCounter = pattern;
     mRowCounter = 0;
 }
 
-void MusicRuntime::lock(RuntimeContext const& rc, ChType ch) {
+template <class Apu>
+void MusicRuntime::lock(BasicRuntimeContext<Apu> const& rc, ChType ch) {
     // do nothing if channel is already locked
     if (mFlags.test(+ch)) {
         reload(rc, ch);
@@ -47,7 +70,8 @@ void MusicRuntime::lock(RuntimeContext const& rc, ChType ch) {
     }
 }
 
-void MusicRuntime::reloadAll(RuntimeContext const& rc) {
+template <class Apu>
+void MusicRuntime::reloadAll(BasicRuntimeContext<Apu> const& rc) {
     for (int i = +ChType::ch1; i <= +ChType::ch4; ++i) {
         if (!mFlags.test(i)) {
             reload(rc, static_cast<ChType>(i));
@@ -55,26 +79,28 @@ void MusicRuntime::reloadAll(RuntimeContext const& rc) {
     }
 }
 
-void MusicRuntime::reload(RuntimeContext const& rc, ChType ch) {
+template <class Apu>
+void MusicRuntime::reload(BasicRuntimeContext<Apu> const& rc, ChType ch) {
     // reload current channel state
     switch (ch) {
         case ChType::ch1:
-            ChannelControl<ChType::ch1>::init(rc.apu, rc.waveTable, mStates[0]);
+            ChannelControl<ChType::ch1>::init(rc.apu, rc.waveTable, rc.waveram, mStates[0]);
             break;
         case ChType::ch2:
-            ChannelControl<ChType::ch2>::init(rc.apu, rc.waveTable, mStates[1]);
+            ChannelControl<ChType::ch2>::init(rc.apu, rc.waveTable, rc.waveram, mStates[1]);
             break;
         case ChType::ch3:
-            ChannelControl<ChType::ch3>::init(rc.apu, rc.waveTable, mStates[2]);
+            ChannelControl<ChType::ch3>::init(rc.apu, rc.waveTable, rc.waveram, mStates[2]);
             break;
         case ChType::ch4:
-            ChannelControl<ChType::ch4>::init(rc.apu, rc.waveTable, mStates[3]);
+            ChannelControl<ChType::ch4>::init(rc.apu, rc.waveTable, rc.waveram, mStates[3]);
             break;
     }
     
 }
 
-void MusicRuntime::unlock(RuntimeContext const& rc, ChType ch) {
+template <class Apu>
+void MusicRuntime::unlock(BasicRuntimeContext<Apu> const& rc, ChType ch) {
     (void)rc;
     mFlags.set(+ch);
 }
@@ -83,17 +109,18 @@ void MusicRuntime::repeatPattern(bool repeat) {
     mPatternRepeat = repeat;
 }
 
-bool MusicRuntime::step(RuntimeContext const& rc, Frame &frame) {
+template <class Apu>
+bool MusicRuntime::step(BasicRuntimeContext<Apu> const& rc, Frame &frame) {
     if (mFlags.test(FLAG_HALT)) {
         // runtime is halted, do nothing
         return true;
     }
     
     if (mFlags.test(FLAG_INIT)) {
-        ChannelControl<ChType::ch1>::init(rc.apu, rc.waveTable, mStates[0]);
-        ChannelControl<ChType::ch2>::init(rc.apu, rc.waveTable, mStates[1]);
-        ChannelControl<ChType::ch3>::init(rc.apu, rc.waveTable, mStates[2]);
-        ChannelControl<ChType::ch4>::init(rc.apu, rc.waveTable, mStates[3]);
+        ChannelControl<ChType::ch1>::init(rc.apu, rc.waveTable, rc.waveram, mStates[0]);
+        ChannelControl<ChType::ch2>::init(rc.apu, rc.waveTable, rc.waveram, mStates[1]);
+        ChannelControl<ChType::ch3>::init(rc.apu, rc.waveTable, rc.waveram, mStates[2]);
+        ChannelControl<ChType::ch4>::init(rc.apu, rc.waveTable, rc.waveram, mStates[3]);
 
         mFlags.reset(FLAG_INIT);
     }
@@ -115,7 +142,7 @@ bool MusicRuntime::step(RuntimeContext const& rc, Frame &frame) {
                 case Operation::PatternCommand::none:
                     break;
                 case Operation::PatternCommand::next:
-                    if (++mOrderCounter >= mSong.order().size()) {
+                    if (++mOrderCounter >= mSong->order().size()) {
                         // loop back to the first pattern
                         mOrderCounter = 0;
                     }
@@ -126,7 +153,7 @@ bool MusicRuntime::step(RuntimeContext const& rc, Frame &frame) {
                 case Operation::PatternCommand::jump:
                     mRowCounter = 0;
                     // if the parameter goes past the last one, use the last one
-                    mOrderCounter = std::min(mGlobal.patternCommandParam, (uint8_t)(mSong.order().size() - 1));
+                    mOrderCounter = std::min(mGlobal.patternCommandParam, (uint8_t)(mSong->order().size() - 1));
                     mGlobal.patternCommand = Operation::PatternCommand::none;
                     frame.startedNewPattern = true;
                     break;
@@ -134,10 +161,7 @@ bool MusicRuntime::step(RuntimeContext const& rc, Frame &frame) {
         }
         
         // set row data to our track controls
-        mTc1.setRow(mSong.getRow(ChType::ch1, mOrderCounter, mRowCounter));
-        mTc2.setRow(mSong.getRow(ChType::ch2, mOrderCounter, mRowCounter));
-        mTc3.setRow(mSong.getRow(ChType::ch3, mOrderCounter, mRowCounter));
-        mTc4.setRow(mSong.getRow(ChType::ch4, mOrderCounter, mRowCounter));
+        setRows();
         
         if (mGlobal.halt) {
             halt(rc);
@@ -162,7 +186,7 @@ bool MusicRuntime::step(RuntimeContext const& rc, Frame &frame) {
 
     if (mTimer.step()) {
         // timer overflow, advance row counter
-        if (++mRowCounter >= mSong.patterns().rowSize()) {
+        if (++mRowCounter >= mSong->patterns().rowSize()) {
             // end of pattern
             if (mGlobal.patternCommand == Operation::PatternCommand::none) {
                 // load the next one if no command was set
@@ -178,30 +202,50 @@ bool MusicRuntime::step(RuntimeContext const& rc, Frame &frame) {
 
 }
 
-template <ChType ch>
-void MusicRuntime::update(RuntimeContext const& rc) {
+Timer const& MusicRuntime::timer() const noexcept {
+    return mTimer;
+}
+
+bool MusicRuntime::atRowStart() const noexcept {
+    return !mFlags.test(FLAG_HALT) && mTimer.active();
+}
+
+void MusicRuntime::setRows() {
+    auto const& order = mSong->order()[mOrderCounter];
+    auto const& patterns = mSong->patterns();
+    std::array<TrackControl*, 4> controls = { &mTc1, &mTc2, &mTc3, &mTc4 };
+    for (int i = 0; i != 4; ++i) {
+        auto track = patterns.getTrack(static_cast<ChType>(i), order[i]);
+        if (track) {
+            controls[i]->setOperation(track->operations().find(mRowCounter));
+        }
+    }
+}
+
+template <ChType ch, class Apu>
+void MusicRuntime::update(BasicRuntimeContext<Apu> const& rc) {
 
     // initial current state with the previous state
     ChannelState state = mStates[+ch];
 
     switch (ch) {
         case ChType::ch1:
-            mTc1.step(rc, state, mGlobal);
+            mTc1.step(rc.instrumentTable, state, mGlobal);
             break;
         case ChType::ch2:
-            mTc2.step(rc, state, mGlobal);
+            mTc2.step(rc.instrumentTable, state, mGlobal);
             break;
         case ChType::ch3:
-            mTc3.step(rc, state, mGlobal);
+            mTc3.step(rc.instrumentTable, state, mGlobal);
             break;
         case ChType::ch4:
-            mTc4.step(rc, state, mGlobal);
+            mTc4.step(rc.instrumentTable, state, mGlobal);
             break;
     }
     if (!mFlags.test(+ch)) {
         // only write to registers if the channel is locked
         // unlocked channels have sfx playing on them or are being used for something else
-        ChannelControl<ch>::update(rc.apu, rc.waveTable, mStates[+ch], state);
+        ChannelControl<ch>::update(rc.apu, rc.waveTable, rc.waveram, mStates[+ch], state);
     }
     state.retrigger = false;
     // save the current state
@@ -213,14 +257,14 @@ void MusicRuntime::update(RuntimeContext const& rc) {
     }
 }
 
-template <ChType ch>
-void MusicRuntime::haltChannels(RuntimeContext const& rc) {
+template <ChType ch, class Apu>
+void MusicRuntime::haltChannels(BasicRuntimeContext<Apu> const& rc) {
     // zero out the channel
     ChannelState state;
 
     // only write if the channel is locked
     if (!mFlags.test(+ch)) {
-        ChannelControl<ch>::update(rc.apu, rc.waveTable, mStates[+ch], state);
+        ChannelControl<ch>::update(rc.apu, rc.waveTable, rc.waveram, mStates[+ch], state);
     }
     // save the state
     mStates[+ch] = state;
@@ -231,5 +275,22 @@ void MusicRuntime::haltChannels(RuntimeContext const& rc) {
 }
 
 
+// explicit instantiations for each supported apu type
+
+#define INSTANTIATE_RUNTIME(Apu) \
+    template void MusicRuntime::halt<Apu>(BasicRuntimeContext<Apu> const&); \
+    template void MusicRuntime::lock<Apu>(BasicRuntimeContext<Apu> const&, ChType); \
+    template void MusicRuntime::reloadAll<Apu>(BasicRuntimeContext<Apu> const&); \
+    template void MusicRuntime::reload<Apu>(BasicRuntimeContext<Apu> const&, ChType); \
+    template void MusicRuntime::unlock<Apu>(BasicRuntimeContext<Apu> const&, ChType); \
+    template bool MusicRuntime::step<Apu>(BasicRuntimeContext<Apu> const&, Frame&)
+
+INSTANTIATE_RUNTIME(IApu);
+INSTANTIATE_RUNTIME(NullApu);
+INSTANTIATE_RUNTIME(BufferedApu);
+INSTANTIATE_RUNTIME(gbapu::Apu);
+
+#undef INSTANTIATE_RUNTIME
+
 
 }
@@ -0,0 +1,35 @@
+
+#include "trackerboy/engine/OperationStream.hpp"
+#include "trackerboy/data/Track.hpp"
+
+#include <algorithm>
+
+namespace trackerboy {
+
+OperationStream::OperationStream(Track const& track) :
+    mRows(),
+    mOperations()
+{
+    auto const count = (size_t)track.rowCount();
+    mRows.reserve(count);
+    mOperations.reserve(count);
+    for (auto entry : track.nonEmptyRows()) {
+        mRows.push_back(entry.row);
+        mOperations.emplace_back(entry.data);
+    }
+}
+
+Operation const* OperationStream::find(int row) const noexcept {
+    auto iter = std::lower_bound(mRows.begin(), mRows.end(), row);
+    if (iter == mRows.end() || *iter != row) {
+        return nullptr;
+    }
+    return &mOperations[iter - mRows.begin()];
+}
+
+size_t OperationStream::size() const noexcept {
+    return mOperations.size();
+}
+
+
+}
@@ -1,15 +1,13 @@
-
 #include "trackerboy/engine/RuntimeContext.hpp"
+#include "trackerboy/engine/BufferedApu.hpp"
 
 namespace trackerboy {
 
 
-RuntimeContext::RuntimeContext(IApu &apu, InstrumentTable const& instrumentTable, WaveformTable const& waveTable) :
-    apu(apu),
-    instrumentTable(instrumentTable),
-    waveTable(waveTable)
-{
-}
+template struct BasicRuntimeContext<IApu>;
+template struct BasicRuntimeContext<NullApu>;
+template struct BasicRuntimeContext<BufferedApu>;
+template struct BasicRuntimeContext<gbapu::Apu>;
 
 
 }
@@ -37,6 +37,10 @@ Speed Timer::period() const noexcept {
     return mPeriod;
 }
 
+Speed Timer::counter() const noexcept {
+    return mCounter;
+}
+
 void Timer::reset() noexcept {
     mCounter = 0;
 }
@@ -0,0 +1,172 @@
+
+#include "trackerboy/engine/TraceFile.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace trackerboy {
+
+TraceFile::TraceFile() noexcept :
+    mData(nullptr),
+    mSize(0),
+#ifdef _WIN32
+    mFile(INVALID_HANDLE_VALUE),
+    mMapping(nullptr)
+#else
+    mFd(-1)
+#endif
+{
+}
+
+TraceFile::TraceFile(std::string const& path) :
+    TraceFile()
+{
+    open(path);
+}
+
+TraceFile::TraceFile(TraceFile &&file) noexcept :
+    TraceFile()
+{
+    *this = std::move(file);
+}
+
+TraceFile& TraceFile::operator=(TraceFile &&file) noexcept {
+    if (this != &file) {
+        close();
+        std::swap(mData, file.mData);
+        std::swap(mSize, file.mSize);
+#ifdef _WIN32
+        std::swap(mFile, file.mFile);
+        std::swap(mMapping, file.mMapping);
+#else
+        std::swap(mFd, file.mFd);
+#endif
+    }
+    return *this;
+}
+
+TraceFile::~TraceFile() {
+    close();
+}
+
+#ifdef _WIN32
+
+void TraceFile::open(std::string const& path) {
+    close();
+
+    mFile = CreateFileA(
+        path.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_FLAG_SEQUENTIAL_SCAN,
+        nullptr
+    );
+    if (mFile == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("could not open trace file");
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(mFile, &size) || size.QuadPart == 0) {
+        close();
+        throw std::runtime_error("could not map trace file");
+    }
+
+    mMapping = CreateFileMappingA(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mMapping == nullptr) {
+        close();
+        throw std::runtime_error("could not map trace file");
+    }
+
+    auto view = MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        close();
+        throw std::runtime_error("could not map trace file");
+    }
+    mData = static_cast<uint8_t const*>(view);
+    mSize = static_cast<size_t>(size.QuadPart);
+}
+
+void TraceFile::close() noexcept {
+    if (mData) {
+        UnmapViewOfFile(mData);
+        mData = nullptr;
+    }
+    if (mMapping) {
+        CloseHandle(mMapping);
+        mMapping = nullptr;
+    }
+    if (mFile != INVALID_HANDLE_VALUE) {
+        CloseHandle(mFile);
+        mFile = INVALID_HANDLE_VALUE;
+    }
+    mSize = 0;
+}
+
+#else
+
+void TraceFile::open(std::string const& path) {
+    close();
+
+    mFd = ::open(path.c_str(), O_RDONLY);
+    if (mFd == -1) {
+        throw std::runtime_error("could not open trace file");
+    }
+
+    struct stat st;
+    if (fstat(mFd, &st) == -1 || st.st_size == 0) {
+        close();
+        throw std::runtime_error("could not map trace file");
+    }
+
+    auto size = static_cast<size_t>(st.st_size);
+    auto addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, mFd, 0);
+    if (addr == MAP_FAILED) {
+        close();
+        throw std::runtime_error("could not map trace file");
+    }
+    // traces are played from start to end
+    madvise(addr, size, MADV_SEQUENTIAL);
+
+    mData = static_cast<uint8_t const*>(addr);
+    mSize = size;
+}
+
+void TraceFile::close() noexcept {
+    if (mData) {
+        munmap(const_cast<uint8_t*>(mData), mSize);
+        mData = nullptr;
+    }
+    if (mFd != -1) {
+        ::close(mFd);
+        mFd = -1;
+    }
+    mSize = 0;
+}
+
+#endif
+
+bool TraceFile::isOpen() const noexcept {
+    return mData != nullptr;
+}
+
+uint8_t const* TraceFile::data() const noexcept {
+    return mData;
+}
+
+size_t TraceFile::size() const noexcept {
+    return mSize;
+}
+
+}
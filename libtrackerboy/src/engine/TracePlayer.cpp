@@ -0,0 +1,58 @@
+
+#include "trackerboy/engine/TracePlayer.hpp"
+
+#include "internal/endian.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace trackerboy {
+
+TracePlayer::TracePlayer(uint8_t const* data, size_t size) :
+    mData(data),
+    mSize(size),
+    mFramerate(0.0f),
+    mPosition(trace::HEADER_SIZE),
+    mEmptyFrames(0),
+    mFrame(0),
+    mFinished(false)
+{
+    if (data == nullptr || size < trace::HEADER_SIZE) {
+        throw std::invalid_argument("not a trace");
+    }
+    if (std::memcmp(data, trace::SIGNATURE, sizeof(trace::SIGNATURE)) != 0) {
+        throw std::invalid_argument("not a trace");
+    }
+    if (data[sizeof(trace::SIGNATURE)] != trace::VERSION) {
+        throw std::invalid_argument("unsupported trace version");
+    }
+
+    float framerate;
+    std::memcpy(&framerate, data + sizeof(trace::SIGNATURE) + 1, sizeof(framerate));
+    mFramerate = correctEndian(framerate);
+}
+
+float TracePlayer::framerate() const noexcept {
+    return mFramerate;
+}
+
+int TracePlayer::frame() const noexcept {
+    return mFrame;
+}
+
+bool TracePlayer::isFinished() const noexcept {
+    return mFinished;
+}
+
+void TracePlayer::rewind() noexcept {
+    mPosition = trace::HEADER_SIZE;
+    mEmptyFrames = 0;
+    mFrame = 0;
+    mFinished = false;
+}
+
+void TracePlayer::malformed() {
+    throw std::runtime_error("malformed trace");
+}
+
+}
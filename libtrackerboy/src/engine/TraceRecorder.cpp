@@ -0,0 +1,120 @@
+
+#include "trackerboy/engine/TraceRecorder.hpp"
+
+#include "internal/endian.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace trackerboy {
+
+TraceRecorder::TraceRecorder(IApu &apu, std::ostream &stream, float framerate) :
+    IApu(),
+    mApu(apu),
+    mStream(stream),
+    mBuffer(),
+    mPendingFrames(0),
+    mFrames(0),
+    mWriteCount(0),
+    mFinished(false)
+{
+    char header[trace::HEADER_SIZE];
+    std::memcpy(header, trace::SIGNATURE, sizeof(trace::SIGNATURE));
+    header[sizeof(trace::SIGNATURE)] = (char)trace::VERSION;
+    float const framerateLe = correctEndian(framerate);
+    std::memcpy(header + sizeof(trace::SIGNATURE) + 1, &framerateLe, sizeof(framerateLe));
+    mStream.write(header, sizeof(header));
+
+    // a frame's worth of writes is usually small
+    mBuffer.reserve(256);
+}
+
+TraceRecorder::~TraceRecorder() {
+
+}
+
+uint8_t TraceRecorder::readRegister(uint8_t reg) {
+    return mApu.readRegister(reg);
+}
+
+void TraceRecorder::writeRegister(uint8_t reg, uint8_t value) {
+    record(reg, value);
+    mApu.writeRegister(reg, value);
+}
+
+void TraceRecorder::writeRegisters(RegisterWrite const* writes, size_t count) {
+    for (size_t i = 0; i != count; ++i) {
+        record(writes[i].reg, writes[i].value);
+    }
+    mApu.writeRegisters(writes, count);
+}
+
+void TraceRecorder::endFrame() {
+    if (mFinished) {
+        return;
+    }
+
+    if (!mBuffer.empty()) {
+        // frame ends before these writes must be written first
+        writeFrames();
+        mStream.write(mBuffer.data(), mBuffer.size());
+        mBuffer.clear();
+    }
+    ++mPendingFrames;
+    ++mFrames;
+}
+
+void TraceRecorder::finish() {
+    if (mFinished) {
+        return;
+    }
+
+    if (!mBuffer.empty()) {
+        endFrame();
+    }
+    writeFrames();
+    mStream.put((char)trace::CMD_END);
+    mStream.flush();
+    mFinished = true;
+
+    if (!mStream.good()) {
+        throw std::runtime_error("could not write trace");
+    }
+}
+
+int TraceRecorder::frames() const noexcept {
+    return mFrames;
+}
+
+size_t TraceRecorder::writeCount() const noexcept {
+    return mWriteCount;
+}
+
+void TraceRecorder::record(uint8_t reg, uint8_t value) {
+    if (mFinished || reg < trace::CMD_WRITE_FIRST || reg > trace::CMD_WRITE_LAST) {
+        // not a sound register, the apu ignores these anyways
+        return;
+    }
+
+    mBuffer.push_back((char)reg);
+    mBuffer.push_back((char)value);
+    ++mWriteCount;
+}
+
+void TraceRecorder::writeFrames() {
+    // consecutive empty frames are run-length encoded
+    while (mPendingFrames) {
+        if (mPendingFrames == 1) {
+            mStream.put((char)trace::CMD_FRAME);
+            mPendingFrames = 0;
+        } else {
+            auto run = std::min(mPendingFrames, trace::MAX_FRAME_RUN);
+            mStream.put((char)trace::CMD_FRAMES);
+            mStream.put((char)(run - 2));
+            mPendingFrames -= run;
+        }
+    }
+}
+
+}
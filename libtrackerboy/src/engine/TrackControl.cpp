@@ -13,8 +13,9 @@ namespace trackerboy {
 
 TrackControl::TrackControl(ChType ch, FrequencyControl &fc) :
     mOp(),
-    mInstrument(),
-    mFc(fc),
+    mInstrument{ 0, 0 },
+    mInstrumentData(nullptr),
+    mFc(&fc),
     mIr(),
     mDelayCounter(),
     mCutCounter(),
@@ -37,7 +38,17 @@ void TrackControl::setRow(TrackRow const& row) {
     mDelayCounter = mOp.delay;
 }
 
-void TrackControl::step(RuntimeContext const &rc, ChannelState &state, GlobalState &global) {
+void TrackControl::setOperation(Operation const* op) {
+    if (op == nullptr) {
+        // empty row, do nothing
+        return;
+    }
+
+    mOp = *op;
+    mDelayCounter = mOp.delay;
+}
+
+void TrackControl::step(InstrumentTable const& instrumentTable, ChannelState &state, GlobalState &global) {
 
     if (mDelayCounter) {
         if (*mDelayCounter == 0) {
@@ -60,9 +71,9 @@ void TrackControl::step(RuntimeContext const &rc, ChannelState &state, GlobalSta
             bool restartIr = false;
 
             if (mOp.instrument) {
-                auto inst = rc.instrumentTable.getShared(*mOp.instrument);
-                if (inst) {
-                    mInstrument = std::move(inst);
+                auto handle = instrumentTable.handle(*mOp.instrument);
+                if (handle.generation) {
+                    mInstrument = handle;
                     restartIr = true;
                 }
             }
@@ -92,13 +103,17 @@ void TrackControl::step(RuntimeContext const &rc, ChannelState &state, GlobalSta
 
             mCutCounter = mOp.duration;
 
-            if (restartIr && mInstrument) {
-                // restart the instrument runtime
-                mIr.emplace(*mInstrument);
-                mFc.useInstrument(mInstrument.get());
+            if (restartIr) {
+                auto instrument = instrumentTable.get(mInstrument);
+                if (instrument) {
+                    // restart the instrument runtime
+                    mIr.emplace(*instrument);
+                    mFc->useInstrument(instrument);
+                    mInstrumentData = instrument;
+                }
             }
 
-            mFc.apply(mOp);
+            mFc->apply(mOp);
 
             mDelayCounter.reset();
         } else {
@@ -118,17 +133,47 @@ void TrackControl::step(RuntimeContext const &rc, ChannelState &state, GlobalSta
         }
 
         if (mIr) {
-            mIr->step(state);
+            if (instrumentTable.get(mInstrument)) {
+                mIr->step(state);
+            } else {
+                // the instrument was removed, stop using it
+                mIr.reset();
+                mFc->useInstrument(nullptr);
+                mInstrumentData = nullptr;
+            }
         }
 
-        mFc.step();
-        state.frequency = mFc.frequency();
+        mFc->step();
+        state.frequency = mFc->frequency();
 
     }
     
     state.playing = mPlaying;
 }
 
+void TrackControl::rebind(InstrumentTable const& instrumentTable) {
+    if (!mIr) {
+        return;
+    }
+
+    // the previous table is still alive, so a different object will always
+    // have a different address
+    auto instrument = instrumentTable.get(mInstrument);
+    if (instrument != mInstrumentData) {
+        if (instrument) {
+            mIr.emplace(*instrument);
+        } else {
+            mIr.reset();
+        }
+        mFc->useInstrument(instrument);
+        mInstrumentData = instrument;
+    }
+}
+
+void TrackControl::setFrequencyControl(FrequencyControl &fc) noexcept {
+    mFc = &fc;
+}
+
 
 
 // ---------------------------------------------------
@@ -139,10 +184,24 @@ ToneTrackControl::ToneTrackControl(ChType ch) :
 {
 }
 
+ToneTrackControl::ToneTrackControl(ToneTrackControl const& ctrl) :
+    TrackControl(ctrl),
+    mFc(ctrl.mFc)
+{
+    setFrequencyControl(mFc);
+}
+
 NoiseTrackControl::NoiseTrackControl() :
     TrackControl(ChType::ch4, mFc),
     mFc()
 {
 }
 
+NoiseTrackControl::NoiseTrackControl(NoiseTrackControl const& ctrl) :
+    TrackControl(ctrl),
+    mFc(ctrl.mFc)
+{
+    setFrequencyControl(mFc);
+}
+
 }
@@ -0,0 +1,135 @@
+
+#include "trackerboy/export/OfflineRenderer.hpp"
+
+#include "internal/enumutils.hpp"
+
+#include <vector>
+
+namespace trackerboy {
+
+OfflineRenderer::OfflineRenderer(Module const& mod, int samplerate) :
+    mModule(mod),
+    mSynth(samplerate, mod.framerate()),
+    mSynthApu(mSynth.apu()),
+    mApu(mSynthApu),
+    mEngine(mApu, &mod),
+    mPlayer(mEngine),
+    mEnabledChannels(),
+    mFrames(0),
+    mElapsed(0)
+{
+    mEnabledChannels.set();
+}
+
+bool OfflineRenderer::start(int songIndex, Player::Duration duration) {
+    return start(*mModule.songs().get(songIndex), duration);
+}
+
+bool OfflineRenderer::start(Song const& song, Player::Duration duration) {
+    mSynth.reset();
+    mApu.reset();
+    mEngine.reset();
+    mEngine.setSong(&song);
+
+    mFrames = 0;
+    mElapsed = Clock::duration(0);
+
+    mPlayer.start(duration);
+
+    // the player has started the engine, unlock any disabled channels so that
+    // the music runtime never writes to them
+    for (int i = +ChType::ch1; i <= +ChType::ch4; ++i) {
+        if (!mEnabledChannels.test(i)) {
+            mEngine.unlock(static_cast<ChType>(i));
+        }
+    }
+
+    return mPlayer.isPlaying();
+}
+
+void OfflineRenderer::setChannelEnabled(ChType ch, bool enabled) {
+    mEnabledChannels.set(+ch, enabled);
+}
+
+bool OfflineRenderer::isChannelEnabled(ChType ch) const {
+    return mEnabledChannels.test(+ch);
+}
+
+bool OfflineRenderer::isFinished() {
+    return !mPlayer.isPlaying() && mSynth.apu().availableSamples() == 0;
+}
+
+int OfflineRenderer::progress() const {
+    return mPlayer.progress();
+}
+
+int OfflineRenderer::progressMax() const {
+    return mPlayer.progressMax();
+}
+
+size_t OfflineRenderer::render(int16_t *buffer, size_t count) {
+    auto const startTime = Clock::now();
+
+    auto &apu = mSynth.apu();
+    size_t rendered = 0;
+    while (rendered != count) {
+        if (apu.availableSamples() == 0 && !stepFrame()) {
+            break;
+        }
+        rendered += apu.readSamples(buffer + (rendered * 2), count - rendered);
+    }
+
+    mElapsed += Clock::now() - startTime;
+    return rendered;
+}
+
+void OfflineRenderer::render(Sink const& sink, size_t blocksize) {
+    std::vector<int16_t> block(blocksize * 2);
+    for (;;) {
+        auto rendered = render(block.data(), blocksize);
+        if (rendered) {
+            sink(block.data(), rendered);
+        }
+        if (rendered != blocksize) {
+            break;
+        }
+    }
+}
+
+int OfflineRenderer::samplerate() const noexcept {
+    return mSynth.samplerate();
+}
+
+int OfflineRenderer::framesRendered() const noexcept {
+    return mFrames;
+}
+
+OfflineRenderer::Clock::duration OfflineRenderer::elapsed() const noexcept {
+    return mElapsed;
+}
+
+double OfflineRenderer::framesPerSecond() const noexcept {
+    auto secs = std::chrono::duration<double>(mElapsed).count();
+    if (secs <= 0.0) {
+        return 0.0;
+    }
+    return mFrames / secs;
+}
+
+bool OfflineRenderer::stepFrame() {
+    if (!mPlayer.isPlaying()) {
+        return false;
+    }
+
+    mPlayer.step();
+    if (!mPlayer.isPlaying()) {
+        return false;
+    }
+
+    mApu.flush();
+    mSynth.run();
+    ++mFrames;
+    return true;
+}
+
+}
@@ -1,30 +1,35 @@
 
 #include "trackerboy/export/Player.hpp"
+#include "trackerboy/engine/BufferedApu.hpp"
 
 namespace trackerboy {
 
-Player::LoopContext::LoopContext(int loopAmount) :
+template <class Apu>
+BasicPlayer<Apu>::LoopContext::LoopContext(int loopAmount) :
     currentPattern(0),
     visits(),
     loopAmount(loopAmount)
 {
 }
 
-Player::DurationContext::DurationContext(int framesToPlay) :
+template <class Apu>
+BasicPlayer<Apu>::DurationContext::DurationContext(int framesToPlay) :
     frameCounter(0),
     framesToPlay(framesToPlay)
 {
 }
 
 
-Player::Player(Engine &engine) :
+template <class Apu>
+BasicPlayer<Apu>::BasicPlayer(BasicEngine<Apu> &engine) :
     mEngine(engine),
     mPlaying(false),
     mContext()
 {
 }
 
-void Player::start(Duration duration) {
+template <class Apu>
+void BasicPlayer<Apu>::start(Duration duration) {
     bool init = false;
     if (std::holds_alternative<int>(duration)) {
         auto loopCount = std::get<int>(duration);
@@ -36,7 +41,7 @@ void Player::start(Duration duration) {
             mContext = {};
         } else {
             if (mEngine.canPlay()) {
-                mContext.emplace<LoopContext>(loopCount);
+                mContext.template emplace<LoopContext>(loopCount);
                 auto &ctx = std::get<LoopContext>(mContext);
                 ctx.visits.resize(mEngine.getSong()->order().size());
                 ctx.visits[0] = 1; // visit the first pattern
@@ -53,7 +58,7 @@ void Player::start(Duration duration) {
             auto mod = mEngine.getModule();
             if (mod) {
                 auto frames = mod->framerate() * secs.count();
-                mContext.emplace<DurationContext>((unsigned)frames);
+                mContext.template emplace<DurationContext>((unsigned)frames);
                 init = true;
             }
         }
@@ -68,11 +73,13 @@ void Player::start(Duration duration) {
 
 }
 
-bool Player::isPlaying() const {
+template <class Apu>
+bool BasicPlayer<Apu>::isPlaying() const {
     return mPlaying;
 }
 
-int Player::progress() const {
+template <class Apu>
+int BasicPlayer<Apu>::progress() const {
     return std::visit([](auto&& ctx) {
         using T = std::decay_t<decltype(ctx)>;
 
@@ -86,7 +93,8 @@ int Player::progress() const {
     }, mContext);
 }
 
-int Player::progressMax() const {
+template <class Apu>
+int BasicPlayer<Apu>::progressMax() const {
     return std::visit([](auto&& ctx) {
         using T = std::decay_t<decltype(ctx)>;
 
@@ -100,7 +108,8 @@ int Player::progressMax() const {
     }, mContext);
 }
 
-void Player::step() {
+template <class Apu>
+void BasicPlayer<Apu>::step() {
     if (mPlaying) {
         Frame frame;
         mEngine.step(frame);
@@ -138,4 +147,9 @@ void Player::step() {
 }
 
 
+template class BasicPlayer<IApu>;
+template class BasicPlayer<NullApu>;
+template class BasicPlayer<BufferedApu>;
+template class BasicPlayer<gbapu::Apu>;
+
 }
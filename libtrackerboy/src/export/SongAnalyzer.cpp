@@ -0,0 +1,125 @@
+
+#include "trackerboy/export/SongAnalyzer.hpp"
+#include "trackerboy/engine/IApu.hpp"
+#include "trackerboy/engine/MusicRuntime.hpp"
+#include "trackerboy/engine/RuntimeContext.hpp"
+
+#include <stdexcept>
+#include <unordered_map>
+
+namespace trackerboy {
+
+SongAnalyzer::SongAnalyzer() :
+    mFramerate(GB_FRAMERATE_DMG),
+    mRowSize(0),
+    mTimeline(),
+    mFirstVisits(),
+    mHalts(false),
+    mLoopIndex(-1),
+    mTotalFrames(0)
+{
+}
+
+void SongAnalyzer::analyze(Module const& mod, Song const& song) {
+    mFramerate = mod.framerate();
+    mRowSize = song.patterns().rowSize();
+    mTimeline.clear();
+    mFirstVisits.assign((size_t)song.order().size() * mRowSize, -1);
+    mHalts = false;
+    mLoopIndex = -1;
+    mTotalFrames = 0;
+
+    // the song loops when a row starts with the same timer state as before
+    // key: order, row, timer period, timer counter
+    std::unordered_map<uint32_t, int> rowStates;
+
+    NullApu apu;
+    BasicRuntimeContext<NullApu> rc(apu, mod.instrumentTable(), mod.waveformTable());
+    MusicRuntime runtime(song, 0, 0);
+
+    for (int frameNo = 0;; ++frameNo) {
+        // timer state before the row's speed effect is applied
+        auto const period = runtime.timer().period();
+        auto const counter = runtime.timer().counter();
+
+        Frame frame;
+        if (runtime.step(rc, frame)) {
+            mHalts = true;
+            mTotalFrames = frameNo;
+            break;
+        }
+
+        if (frame.startedNewRow) {
+            uint32_t const key = (uint32_t)frame.order << 24 |
+                                 (uint32_t)frame.row << 16 |
+                                 (uint32_t)period << 8 |
+                                 (uint32_t)counter;
+            auto [iter, inserted] = rowStates.try_emplace(key, (int)mTimeline.size());
+            if (!inserted) {
+                // this row was already started in the same state, the song loops here
+                mLoopIndex = iter->second;
+                mTotalFrames = frameNo;
+                break;
+            }
+
+            auto &firstVisit = mFirstVisits[(size_t)frame.order * mRowSize + frame.row];
+            if (firstVisit == -1) {
+                firstVisit = (int)mTimeline.size();
+            }
+            mTimeline.push_back({ (uint8_t)frame.order, (uint8_t)frame.row, frameNo });
+        }
+    }
+}
+
+std::vector<SongAnalyzer::Row> const& SongAnalyzer::timeline() const noexcept {
+    return mTimeline;
+}
+
+bool SongAnalyzer::halts() const noexcept {
+    return mHalts;
+}
+
+int SongAnalyzer::loopIndex() const noexcept {
+    return mLoopIndex;
+}
+
+int SongAnalyzer::loopFrame() const noexcept {
+    if (mLoopIndex == -1) {
+        return -1;
+    }
+    return mTimeline[mLoopIndex].frame;
+}
+
+int SongAnalyzer::totalFrames() const noexcept {
+    return mTotalFrames;
+}
+
+int SongAnalyzer::framesForLoops(int loops) const noexcept {
+    if (loops <= 0) {
+        return 0;
+    }
+    if (mHalts) {
+        // the song cannot be played more than once
+        return mTotalFrames;
+    }
+    auto const intro = loopFrame();
+    return intro + (mTotalFrames - intro) * loops;
+}
+
+int SongAnalyzer::frameOf(int orderNo, int patternRow) const {
+    if (patternRow < 0 || patternRow >= mRowSize || orderNo < 0 || (size_t)orderNo * mRowSize >= mFirstVisits.size()) {
+        throw std::invalid_argument("row does not exist");
+    }
+    auto const visit = mFirstVisits[(size_t)orderNo * mRowSize + patternRow];
+    if (visit == -1) {
+        return -1;
+    }
+    return mTimeline[visit].frame;
+}
+
+uint64_t SongAnalyzer::sampleOf(int frame, int samplerate) const noexcept {
+    return (uint64_t)((double)frame * samplerate / mFramerate);
+}
+
+
+}
@@ -0,0 +1,33 @@
+
+#include "trackerboy/export/TraceExporter.hpp"
+
+#include "trackerboy/engine/BufferedApu.hpp"
+#include "trackerboy/engine/Engine.hpp"
+#include "trackerboy/engine/TraceRecorder.hpp"
+
+namespace trackerboy {
+
+int exportTrace(Module const& mod, Song const& song, Player::Duration duration, std::ostream &stream) {
+    NullApu nullApu;
+    TraceRecorder recorder(nullApu, stream, mod.framerate());
+    // record only the writes that change the apu's state
+    BufferedApu apu(recorder);
+    BasicEngine<BufferedApu> engine(apu, &mod);
+    engine.setSong(&song);
+
+    BasicPlayer<BufferedApu> player(engine);
+    player.start(duration);
+    while (player.isPlaying()) {
+        player.step();
+        if (!player.isPlaying()) {
+            break;
+        }
+        apu.flush();
+        recorder.endFrame();
+    }
+
+    recorder.finish();
+    return recorder.frames();
+}
+
+}
@@ -178,17 +178,12 @@ void SongHandler::processOut(Module const& mod, OutputBlock &block, size_t index
                 trackFormat.rows = bias(pair->second.rowCount());
                 block.write(trackFormat);
 
-                // iterate all rows in this track
-                uint8_t rowno = 0;
-                for (auto &row : pair->second) {
-                    if (!row.isEmpty()) {
-                        TU::RowFormat rowFormat;
-                        rowFormat.rowno = rowno;
-                        rowFormat.rowdata = row;
-                        block.write(rowFormat);
-                    }
-
-                    ++rowno;
+                // iterate all non-empty rows in this track
+                for (auto entry : pair->second.nonEmptyRows()) {
+                    TU::RowFormat rowFormat;
+                    rowFormat.rowno = entry.row;
+                    rowFormat.rowdata = entry.data;
+                    block.write(rowFormat);
                 }
             }
         }
@@ -0,0 +1,142 @@
+
+//
+// Benchmark for PatternMaster track lookup and iteration. Compares against
+// an unordered_map of tracks per channel, which is how PatternMaster stored
+// tracks before.
+//
+
+#include "trackerboy/data/PatternMaster.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <unordered_map>
+
+using namespace trackerboy;
+
+namespace {
+
+constexpr int ROWS = 64;
+constexpr int TRACKS = 128;
+constexpr int LOOKUP_ITERATIONS = 20000;
+constexpr int ITERATE_ITERATIONS = 2000;
+
+using Clock = std::chrono::steady_clock;
+
+//
+// The old storage, same lookup/iteration interface
+//
+class MapMaster {
+
+public:
+    Track& getTrack(ChType ch, uint8_t track) {
+        auto &chMap = mMap[static_cast<size_t>(ch)];
+        auto iter = chMap.find(track);
+        if (iter == chMap.end()) {
+            iter = chMap.emplace(track, ROWS).first;
+        }
+        return iter->second;
+    }
+
+    std::unordered_map<uint8_t, Track> const& channel(ChType ch) const {
+        return mMap[static_cast<size_t>(ch)];
+    }
+
+private:
+    std::array<std::unordered_map<uint8_t, Track>, 4> mMap;
+};
+
+//
+// Adapts PatternMaster to the same interface
+//
+class DenseMaster {
+
+public:
+    DenseMaster() :
+        mMaster(ROWS)
+    {
+    }
+
+    Track& getTrack(ChType ch, uint8_t track) {
+        return mMaster.getTrack(ch, track);
+    }
+
+    struct Range {
+        PatternMaster::Data::const_iterator b;
+        PatternMaster::Data::const_iterator e;
+        PatternMaster::Data::const_iterator begin() const { return b; }
+        PatternMaster::Data::const_iterator end() const { return e; }
+    };
+
+    Range channel(ChType ch) const {
+        return { mMaster.tracksBegin(ch), mMaster.tracksEnd(ch) };
+    }
+
+private:
+    PatternMaster mMaster;
+};
+
+template <class Master>
+void fill(Master &master) {
+    for (int ch = 0; ch < 4; ++ch) {
+        for (int id = 0; id < TRACKS; ++id) {
+            auto &track = master.getTrack(static_cast<ChType>(ch), (uint8_t)id);
+            for (int row = 0; row < ROWS; row += 4) {
+                track.setNote(row, (uint8_t)(id % 60));
+            }
+        }
+    }
+}
+
+//
+// Looks up a pattern's worth of tracks, like Song::getRow
+//
+template <class Master>
+double lookup(Master &master, unsigned &checksum) {
+    auto const start = Clock::now();
+    for (int i = 0; i < LOOKUP_ITERATIONS; ++i) {
+        for (int id = 0; id < TRACKS; ++id) {
+            for (int ch = 0; ch < 4; ++ch) {
+                auto const& track = master.getTrack(static_cast<ChType>(ch), (uint8_t)id);
+                checksum += track.size();
+            }
+        }
+    }
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+//
+// Walks every row of every track, like the serializer
+//
+template <class Master>
+double iterate(Master const& master, unsigned &checksum) {
+    auto const start = Clock::now();
+    for (int i = 0; i < ITERATE_ITERATIONS; ++i) {
+        for (int ch = 0; ch < 4; ++ch) {
+            for (auto const& pair : master.channel(static_cast<ChType>(ch))) {
+                for (auto const& row : pair.second) {
+                    checksum += row.note;
+                }
+            }
+        }
+    }
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+template <class Master>
+void run(char const *name) {
+    Master master;
+    fill(master);
+    unsigned checksum = 0;
+    auto const lookupTime = lookup(master, checksum);
+    auto const iterateTime = iterate(master, checksum);
+    printf("%-14s lookup %8.3f ms  iterate %8.3f ms  (checksum %u)\n", name, lookupTime * 1e3, iterateTime * 1e3, checksum);
+}
+
+}
+
+int main() {
+    run<MapMaster>("unordered_map");
+    run<DenseMaster>("PatternMaster");
+    return 0;
+}
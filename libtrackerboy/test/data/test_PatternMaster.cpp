@@ -1,6 +1,8 @@
 #include "catch.hpp"
 #include "trackerboy/data/PatternMaster.hpp"
 
+#include <utility>
+
 using namespace trackerboy;
 
 // test cases are no longer valid since tracks method was changed to only
@@ -88,6 +90,119 @@ TEST_CASE("setRowSize resizes all Tracks", "[PatternMaster]") {
 
 }
 
+TEST_CASE("getTrack references are stable", "[PatternMaster]") {
+    PatternMaster pm(64);
+
+    auto &first = pm.getTrack(ChType::ch1, 0);
+    for (int i = 1; i != PatternMaster::MAX_TRACKS; ++i) {
+        pm.getTrack(ChType::ch1, (uint8_t)i);
+    }
+    REQUIRE(&pm.getTrack(ChType::ch1, 0) == &first);
+    REQUIRE(pm.tracksEnd(ChType::ch1) - pm.tracksBegin(ChType::ch1) == PatternMaster::MAX_TRACKS);
+
+    SECTION("copies keep their own tracks") {
+        PatternMaster copy(pm);
+        REQUIRE(&copy.getTrack(ChType::ch1, 0) != &first);
+        auto &copyFirst = copy.getTrack(ChType::ch1, 0);
+        copy.getTrack(ChType::ch2, 0);
+        REQUIRE(&copy.getTrack(ChType::ch1, 0) == &copyFirst);
+        REQUIRE(std::as_const(pm).getTrack(ChType::ch2, 0) == nullptr);
+    }
+}
+
+TEST_CASE("getTrack references on a copy are stable", "[PatternMaster]") {
+    PatternMaster pm(64);
+    pm.getTrack(ChType::ch1, 0);
+    PatternMaster copy(pm);
+
+    auto &first = copy.getTrack(ChType::ch1, 0);
+    for (int i = 1; i != PatternMaster::MAX_TRACKS; ++i) {
+        copy.getTrack(ChType::ch1, (uint8_t)i);
+    }
+    REQUIRE(&copy.getTrack(ChType::ch1, 0) == &first);
+}
+
+TEST_CASE("copies share track data until written", "[PatternMaster]") {
+    PatternMaster pm(64);
+    pm.getTrack(ChType::ch1, 0).setNote(0, 1);
+    pm.getTrack(ChType::ch2, 3).setNote(8, 2);
+
+    PatternMaster copy(pm);
+    auto const& cpm = pm;
+    REQUIRE(cpm.getTrack(ChType::ch1, 0)->isShared());
+    REQUIRE(cpm.getTrack(ChType::ch2, 3)->isShared());
+
+    copy.getTrack(ChType::ch1, 0).setNote(0, 5);
+    CHECK_FALSE(cpm.getTrack(ChType::ch1, 0)->isShared());
+    CHECK((*cpm.getTrack(ChType::ch1, 0))[0].queryNote() == 1);
+    CHECK((*std::as_const(copy).getTrack(ChType::ch1, 0))[0].queryNote() == 5);
+    CHECK(cpm.getTrack(ChType::ch2, 3)->isShared());
+}
+
+TEST_CASE("buildOperations prepares the streams of a snapshot copy", "[PatternMaster]") {
+    PatternMaster pm(64);
+    pm.getTrack(ChType::ch1, 0).setNote(0, 1);
+    pm.getTrack(ChType::ch3, 2).setNote(4, 2);
+    auto const& cpm = pm;
+    REQUIRE_FALSE(cpm.getTrack(ChType::ch1, 0)->hasOperations());
+
+    PatternMaster const snapshot(pm);
+    snapshot.buildOperations();
+    CHECK(snapshot.getTrack(ChType::ch1, 0)->hasOperations());
+    CHECK(snapshot.getTrack(ChType::ch3, 2)->hasOperations());
+    // the stream belongs to the shared track data
+    CHECK(cpm.getTrack(ChType::ch1, 0)->hasOperations());
+
+    // editing makes new data without a stream, the snapshot keeps its own
+    pm.getTrack(ChType::ch1, 0).setNote(1, 3);
+    CHECK_FALSE(cpm.getTrack(ChType::ch1, 0)->hasOperations());
+    CHECK(snapshot.getTrack(ChType::ch1, 0)->hasOperations());
+}
+
+TEST_CASE("remove", "[PatternMaster]") {
+    PatternMaster pm(64);
+    pm.getTrack(ChType::ch1, 0).setNote(0, 1);
+    pm.getTrack(ChType::ch1, 1).setNote(0, 2);
+    pm.getTrack(ChType::ch1, 4).setNote(0, 3);
+    pm.getTrack(ChType::ch2, 0).setNote(0, 4);
+
+    REQUIRE(pm.tracks(ChType::ch1) == 3);
+    REQUIRE(pm.tracks(ChType::ch2) == 1);
+
+    SECTION("removes a track for the specified channel") {
+        REQUIRE_NOTHROW(pm.remove(ChType::ch1, 0));
+        REQUIRE(pm.tracks(ChType::ch1) == 2);
+        REQUIRE(pm.tracks(ChType::ch2) == 1);
+
+        auto const& cpm = pm;
+        CHECK(cpm.getTrack(ChType::ch1, 0) == nullptr);
+        REQUIRE(cpm.getTrack(ChType::ch1, 1) != nullptr);
+        CHECK((*cpm.getTrack(ChType::ch1, 1))[0].queryNote() == 2);
+        REQUIRE(cpm.getTrack(ChType::ch1, 4) != nullptr);
+        CHECK((*cpm.getTrack(ChType::ch1, 4))[0].queryNote() == 3);
+    }
+
+    SECTION("removing a non-existing track has no effect") {
+        REQUIRE_NOTHROW(pm.remove(ChType::ch1, 2));
+        REQUIRE(pm.tracks(ChType::ch1) == 3);
+        REQUIRE(pm.tracks(ChType::ch2) == 1);
+    }
+
+}
+
+TEST_CASE("totalRows stops at the first pattern jump", "[PatternMaster]") {
+    PatternMaster pm(64);
+    auto pattern = pm.getPattern(0, 0, 0, 0);
+    REQUIRE(pattern.totalRows() == 64);
+
+    pm.getTrack(ChType::ch3, 0).setEffect(40, 0, EffectType::patternSkip);
+    CHECK(pattern.totalRows() == 41);
+    pm.getTrack(ChType::ch1, 0).setEffect(15, 2, EffectType::patternHalt);
+    CHECK(pattern.totalRows() == 16);
+    pm.getTrack(ChType::ch1, 0).clearEffect(15, 2);
+    CHECK(pattern.totalRows() == 41);
+}
+
 // TEST_CASE("getPattern", "[PatternMaster]") {
 //     PatternMaster pm(64);
 
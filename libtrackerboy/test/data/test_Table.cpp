@@ -86,3 +86,85 @@ TEMPLATE_TEST_CASE("table keeps track of the next available index", "[Table]", I
 }
 
 
+TEMPLATE_TEST_CASE("table handles only resolve to their item", "[Table]", InstrumentTable, WaveformTable) {
+
+    TestType table;
+
+    REQUIRE(table.get(table.handle(0)) == nullptr);
+
+    auto &item = table.insert(0);
+    auto handle = table.handle(0);
+    REQUIRE(table.get(handle) == &item);
+
+    SECTION("removed items do not resolve") {
+        table.remove(0);
+        REQUIRE(table.get(handle) == nullptr);
+    }
+
+    SECTION("a new item with the same id does not resolve") {
+        table.remove(0);
+        table.insert(0);
+        REQUIRE(table.get(handle) == nullptr);
+        REQUIRE(table.get(table.handle(0)) == table[0]);
+    }
+
+    SECTION("clear invalidates handles") {
+        table.clear();
+        REQUIRE(table.get(handle) == nullptr);
+    }
+}
+
+TEMPLATE_TEST_CASE("table snapshots share unchanged items", "[Table]", InstrumentTable, WaveformTable) {
+
+    TestType table;
+    table.insert(0);
+    table.insert(1);
+
+    auto first = table.snapshot();
+    REQUIRE(first->size() == 2);
+    REQUIRE(first->get(0) != table.get(0));
+    REQUIRE(first->get(table.handle(1)) == first->get(1));
+
+    SECTION("unchanged items are shared") {
+        auto second = table.snapshot(first.get());
+        CHECK(second->get(0) == first->get(0));
+        CHECK(second->get(1) == first->get(1));
+    }
+
+    SECTION("renamed items are shared") {
+        table[0]->setName("renamed");
+        auto second = table.snapshot(first.get());
+        CHECK(second->get(0) == first->get(0));
+    }
+
+    SECTION("replaced items are copied") {
+        table.remove(1);
+        table.insert(1);
+        auto second = table.snapshot(first.get());
+        CHECK(second->get(0) == first->get(0));
+        CHECK(second->get(1) != first->get(1));
+        CHECK(first->get(table.handle(1)) == nullptr);
+        CHECK(second->get(table.handle(1)) == second->get(1));
+    }
+
+    SECTION("removed items are not in the snapshot") {
+        table.remove(0);
+        auto second = table.snapshot(first.get());
+        CHECK(second->size() == 1);
+        CHECK(second->get(0) == nullptr);
+        CHECK(first->get(0) != nullptr);
+    }
+}
+
+TEST_CASE("table snapshots copy edited items", "[Table]") {
+
+    InstrumentTable table;
+    table.insert(0);
+    auto first = table.snapshot();
+
+    table[0]->setEnvelope(0x57);
+    auto second = table.snapshot(first.get());
+    REQUIRE(second->get(0) != first->get(0));
+    CHECK(second->get(0)->envelope() == 0x57);
+    CHECK(first->get(0)->envelope() != 0x57);
+}
@@ -0,0 +1,139 @@
+#include "catch.hpp"
+#include "trackerboy/data/Track.hpp"
+
+#include <utility>
+#include <vector>
+
+using namespace trackerboy;
+
+namespace {
+
+//
+// Gets the non-empty row indices of a track
+//
+std::vector<int> nonEmpty(Track const& track) {
+    std::vector<int> result;
+    for (auto entry : track.nonEmptyRows()) {
+        result.push_back(entry.row);
+    }
+    return result;
+}
+
+}
+
+TEST_CASE("sparse storage", "[Track]") {
+    Track track(64);
+
+    REQUIRE(track.isSparse());
+    REQUIRE(track.rowCount() == 0);
+    REQUIRE(nonEmpty(track).empty());
+
+    SECTION("setters keep the row count") {
+        track.setNote(10, 1);
+        track.setInstrument(10, 2);
+        track.setEffect(3, 0, EffectType::setTempo, 6);
+        CHECK(track.rowCount() == 2);
+        CHECK(nonEmpty(track) == std::vector<int>{ 3, 10 });
+
+        track.clearNote(10);
+        CHECK(track.rowCount() == 2);
+        track.clearInstrument(10);
+        CHECK(track.rowCount() == 1);
+        CHECK(std::as_const(track)[10].isEmpty());
+        track.clearEffect(3, 0);
+        CHECK(track.rowCount() == 0);
+        CHECK(track.isSparse());
+    }
+
+    SECTION("const iteration includes empty rows") {
+        track.setNote(1, 5);
+        track.setNote(63, 6);
+        auto const& ctrack = track;
+        CHECK(ctrack.end() - ctrack.begin() == 64);
+        int row = 0;
+        for (auto &rowdata : ctrack) {
+            if (row == 1 || row == 63) {
+                CHECK(rowdata.note == (row == 1 ? 6 : 7));
+            } else {
+                CHECK(rowdata.isEmpty());
+            }
+            ++row;
+        }
+        CHECK(row == 64);
+    }
+
+    SECTION("switches to dense storage past the threshold") {
+        for (int i = 0; i < 32; ++i) {
+            track.setNote(i * 2, 1);
+        }
+        CHECK_FALSE(track.isSparse());
+        CHECK(track.rowCount() == 32);
+        track.clear(0, 64);
+        CHECK(track.rowCount() == 0);
+    }
+
+    SECTION("mutable access switches to dense storage") {
+        track.setNote(4, 1);
+        track[8].setNote(2);
+        CHECK_FALSE(track.isSparse());
+        CHECK(track.rowCount() == 2);
+        CHECK(nonEmpty(track) == std::vector<int>{ 4, 8 });
+
+        SECTION("mostly empty copies are sparse") {
+            Track copy(track);
+            copy.setNote(9, 1);
+            CHECK(copy.isSparse());
+            CHECK(copy.rowCount() == 3);
+            CHECK(track.rowCount() == 2);
+            CHECK(nonEmpty(copy) == std::vector<int>{ 4, 8, 9 });
+        }
+    }
+
+    SECTION("resize drops rows past the new size") {
+        track.setNote(10, 1);
+        track.setNote(40, 1);
+        track.resize(32);
+        CHECK(track.size() == 32);
+        CHECK(track.rowCount() == 1);
+        track.resize(64);
+        CHECK(std::as_const(track)[40].isEmpty());
+    }
+}
+
+TEST_CASE("first jump row", "[Track]") {
+    Track track(64);
+    REQUIRE(track.firstJumpRow() == -1);
+
+    track.setEffect(20, 1, EffectType::patternHalt);
+    CHECK(track.firstJumpRow() == 20);
+
+    track.setEffect(30, 0, EffectType::patternGoto, 1);
+    CHECK(track.firstJumpRow() == 20);
+    track.setEffect(10, 2, EffectType::patternSkip, 0);
+    CHECK(track.firstJumpRow() == 10);
+
+    SECTION("removing the first jump finds the next one") {
+        track.clearEffect(10, 2);
+        CHECK(track.firstJumpRow() == 20);
+        track.setEffect(20, 1, EffectType::setTempo, 6);
+        CHECK(track.firstJumpRow() == 30);
+    }
+
+    SECTION("clear and resize") {
+        track.clear(0, 25);
+        CHECK(track.firstJumpRow() == 30);
+        track.resize(16);
+        CHECK(track.firstJumpRow() == -1);
+    }
+
+    SECTION("writes through a reference") {
+        track[5].effects[0] = { EffectType::patternHalt, 0 };
+        CHECK(track.firstJumpRow() == 5);
+    }
+
+    SECTION("replace") {
+        TrackRow row = {};
+        track.replace(10, row);
+        CHECK(track.firstJumpRow() == 20);
+    }
+}
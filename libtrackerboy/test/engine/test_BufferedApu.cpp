@@ -0,0 +1,122 @@
+
+#include "trackerboy/engine/BufferedApu.hpp"
+#include "catch.hpp"
+
+#include <vector>
+
+using namespace trackerboy;
+
+namespace {
+
+//
+// Apu that records every write given to it
+//
+class RecordingApu final : public IApu {
+
+public:
+    std::vector<RegisterWrite> writes;
+    int batches = 0;
+
+    uint8_t readRegister(uint8_t reg) override {
+        FAIL("BufferedApu read from the wrapped apu");
+        return reg;
+    }
+
+    void writeRegister(uint8_t reg, uint8_t value) override {
+        writes.push_back({ reg, value });
+    }
+
+    void writeRegisters(RegisterWrite const* batch, size_t count) override {
+        ++batches;
+        IApu::writeRegisters(batch, count);
+    }
+};
+
+bool contains(std::vector<RegisterWrite> const& writes, uint8_t reg, uint8_t value) {
+    for (auto &write : writes) {
+        if (write.reg == reg && write.value == value) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+
+TEST_CASE("writes are deferred until flush", "[BufferedApu]") {
+    RecordingApu rec;
+    BufferedApu apu(rec);
+
+    apu.writeRegister(gbapu::Apu::REG_NR12, 0xF0);
+    apu.writeRegister(gbapu::Apu::REG_NR51, 0x11);
+    REQUIRE(rec.writes.empty());
+    REQUIRE(apu.readRegister(gbapu::Apu::REG_NR51) == 0x11);
+
+    apu.flush();
+    REQUIRE(rec.batches == 1);
+    REQUIRE(rec.writes.size() == 2);
+    REQUIRE(apu.writeCount() == 2);
+
+    SECTION("redundant writes are dropped") {
+        rec.writes.clear();
+        apu.writeRegister(gbapu::Apu::REG_NR12, 0xF0);
+        apu.writeRegister(gbapu::Apu::REG_NR51, 0x33);
+        apu.writeRegister(gbapu::Apu::REG_NR51, 0x11);
+        apu.flush();
+        REQUIRE(rec.writes.empty());
+        REQUIRE(rec.batches == 1);
+    }
+
+    SECTION("triggers are always written") {
+        rec.writes.clear();
+        apu.writeRegister(gbapu::Apu::REG_NR14, 0x87);
+        apu.flush();
+        apu.writeRegister(gbapu::Apu::REG_NR14, 0x87);
+        apu.flush();
+        REQUIRE(rec.writes.size() == 2);
+        REQUIRE(rec.writes[1].value == 0x87);
+        REQUIRE(apu.readRegister(gbapu::Apu::REG_NR14) == 0x07);
+    }
+
+    SECTION("reset forces writes") {
+        rec.writes.clear();
+        apu.reset();
+        apu.writeRegister(gbapu::Apu::REG_NR12, 0xF0);
+        apu.flush();
+        REQUIRE(contains(rec.writes, gbapu::Apu::REG_NR12, 0xF0));
+    }
+}
+
+TEST_CASE("waveram uploads are done with the DAC off", "[BufferedApu]") {
+    RecordingApu rec;
+    BufferedApu apu(rec);
+
+    apu.writeRegister(gbapu::Apu::REG_NR30, 0x80);
+    apu.flush();
+    rec.writes.clear();
+
+    // same sequence that ChannelControl<ch3> uses
+    apu.writeRegister(gbapu::Apu::REG_NR30, 0x00);
+    apu.writeRegister(gbapu::Apu::REG_WAVERAM, 0x12);
+    apu.writeRegister(gbapu::Apu::REG_NR30, 0x80);
+    apu.writeRegister(gbapu::Apu::REG_NR34, 0x80);
+    apu.flush();
+
+    REQUIRE(rec.writes.size() == 4);
+    CHECK(rec.writes[0].reg == gbapu::Apu::REG_NR30);
+    CHECK(rec.writes[0].value == 0x00);
+    CHECK(rec.writes[1].reg == gbapu::Apu::REG_WAVERAM);
+    CHECK(rec.writes[2].reg == gbapu::Apu::REG_NR30);
+    CHECK(rec.writes[2].value == 0x80);
+    CHECK(rec.writes[3].reg == gbapu::Apu::REG_NR34);
+
+    SECTION("uploading the same waveform does not toggle the DAC") {
+        rec.writes.clear();
+        apu.writeRegister(gbapu::Apu::REG_NR30, 0x00);
+        apu.writeRegister(gbapu::Apu::REG_WAVERAM, 0x12);
+        apu.writeRegister(gbapu::Apu::REG_NR30, 0x80);
+        apu.flush();
+        REQUIRE(rec.writes.empty());
+    }
+}
@@ -0,0 +1,124 @@
+
+#include "trackerboy/engine/ChannelControl.hpp"
+#include "catch.hpp"
+
+#include <array>
+
+using namespace trackerboy;
+
+namespace {
+
+//
+// Apu with a register file that counts the number of writes to wave RAM
+//
+class WaveramApu final : public IApu {
+
+public:
+    std::array<uint8_t, 256> regs{};
+    int waveramWrites = 0;
+
+    uint8_t readRegister(uint8_t reg) override {
+        return regs[reg];
+    }
+
+    void writeRegister(uint8_t reg, uint8_t value) override {
+        if (reg >= gbapu::Apu::REG_WAVERAM && reg < gbapu::Apu::REG_WAVERAM + GB_WAVERAM_SIZE) {
+            ++waveramWrites;
+        }
+        regs[reg] = value;
+    }
+};
+
+ChannelState playing(uint8_t waveId) {
+    ChannelState state(ChType::ch3);
+    state.playing = true;
+    state.envelope = waveId;
+    return state;
+}
+
+}
+
+
+TEST_CASE("waveform generation", "[Waveform]") {
+    Waveform wave;
+    auto const gen = wave.generation();
+
+    SECTION("is unchanged by reads") {
+        Waveform const& cwave = wave;
+        (void)cwave.data();
+        (void)cwave[0];
+        (void)wave.toString();
+        CHECK(wave.generation() == gen);
+    }
+
+    SECTION("changes on write access") {
+        wave.data()[0] = 0x12;
+        auto const gen2 = wave.generation();
+        CHECK(gen2 != gen);
+        wave[1] = 0x34;
+        CHECK(wave.generation() != gen2);
+        wave.fromString("00");
+        CHECK(wave.generation() != gen2);
+    }
+
+    SECTION("is kept by copies") {
+        Waveform copy(wave);
+        CHECK(copy.generation() == gen);
+    }
+
+    SECTION("is unique among waveforms") {
+        Waveform other;
+        CHECK(other.generation() != gen);
+    }
+}
+
+TEST_CASE("resident waveforms are not uploaded again", "[ChannelControl]") {
+    WaveformTable table;
+    table.insert(0).fromString("0123456789ABCDEFFEDCBA9876543210");
+    table.insert(1).fromString("FFFFFFFFFFFFFFFF0000000000000000");
+    WaveformTable const& ctable = table;
+
+    WaveramApu apu;
+    WaveramCache waveram;
+
+    ChannelControl<ChType::ch3>::init(apu, ctable, waveram, playing(0));
+    REQUIRE(apu.waveramWrites == GB_WAVERAM_SIZE);
+    REQUIRE(apu.regs[gbapu::Apu::REG_NR30] == 0x80);
+
+    SECTION("steady state does not upload") {
+        ChannelControl<ChType::ch3>::update(apu, ctable, waveram, playing(0), playing(0));
+        CHECK(apu.waveramWrites == GB_WAVERAM_SIZE);
+    }
+
+    SECTION("changing the waveform uploads") {
+        ChannelControl<ChType::ch3>::update(apu, ctable, waveram, playing(0), playing(1));
+        CHECK(apu.waveramWrites == GB_WAVERAM_SIZE * 2);
+        CHECK(apu.regs[gbapu::Apu::REG_WAVERAM] == 0xFF);
+
+        SECTION("and changing back uploads again") {
+            ChannelControl<ChType::ch3>::update(apu, ctable, waveram, playing(1), playing(0));
+            CHECK(apu.waveramWrites == GB_WAVERAM_SIZE * 3);
+        }
+    }
+
+    SECTION("reinitializing with the same waveform only restores the DAC") {
+        ChannelControl<ChType::ch3>::clear(apu);
+        REQUIRE(apu.regs[gbapu::Apu::REG_NR30] == 0);
+        ChannelControl<ChType::ch3>::init(apu, ctable, waveram, playing(0));
+        CHECK(apu.waveramWrites == GB_WAVERAM_SIZE);
+        CHECK(apu.regs[gbapu::Apu::REG_NR30] == 0x80);
+    }
+
+    SECTION("editing the resident waveform uploads while playing") {
+        table[0]->data()[0] = 0xAB;
+        ChannelControl<ChType::ch3>::update(apu, ctable, waveram, playing(0), playing(0));
+        CHECK(apu.waveramWrites == GB_WAVERAM_SIZE * 2);
+        CHECK(apu.regs[gbapu::Apu::REG_WAVERAM] == 0xAB);
+    }
+
+    SECTION("an invalidated cache uploads") {
+        waveram.invalidate();
+        ChannelControl<ChType::ch3>::init(apu, ctable, waveram, playing(0));
+        CHECK(apu.waveramWrites == GB_WAVERAM_SIZE * 2);
+    }
+}
@@ -0,0 +1,157 @@
+
+#include "trackerboy/engine/CheckpointCache.hpp"
+#include "trackerboy/note.hpp"
+#include "catch.hpp"
+
+#include <array>
+#include <stdexcept>
+
+namespace trackerboy {
+
+namespace {
+
+//
+// Apu that only keeps the last value written to each register
+//
+class RegisterApu final : public IApu {
+
+public:
+    std::array<uint8_t, 256> regs{};
+
+    uint8_t readRegister(uint8_t reg) override {
+        return regs[reg];
+    }
+
+    void writeRegister(uint8_t reg, uint8_t value) override {
+        regs[reg] = value;
+    }
+};
+
+//
+// Plays the runtime until the given row is started, returns the frame of
+// that row.
+//
+Frame playUntil(RuntimeContext const& rc, MusicRuntime &runtime, int orderNo, int patternRow) {
+    Frame frame;
+    for (;;) {
+        REQUIRE_FALSE(runtime.step(rc, frame));
+        if (frame.startedNewRow && frame.order == orderNo && frame.row == patternRow) {
+            return frame;
+        }
+    }
+}
+
+}
+
+
+TEST_CASE("seek restores state from the start of the song", "[CheckpointCache]") {
+    Module mod;
+    auto &song = *mod.songs().get(0);
+    song.order().resize(2);
+    // speed change on the first row, which would be lost if we started from
+    // the middle of the song
+    song.patterns().getTrack(ChType::ch1, 0).setEffect(0, 0, EffectType::setTempo, 0x20);
+
+    NullApu apu;
+    RuntimeContext rc(apu, mod.instrumentTable(), mod.waveformTable());
+
+    CheckpointCache cache;
+    auto runtime = cache.seek(mod, song, 1, 5);
+    REQUIRE(runtime);
+    // checkpoints are only built up to the seeked row (row 69)
+    CHECK(cache.size() == 69 / CheckpointCache::DEFAULT_INTERVAL + 1);
+
+    REQUIRE(runtime->atRowStart());
+    Frame frame;
+    REQUIRE_FALSE(runtime->step(rc, frame));
+    CHECK(frame.startedNewRow);
+    CHECK(frame.order == 1);
+    CHECK(frame.row == 5);
+    CHECK(frame.speed == 0x20);
+
+    SECTION("restored runtime is identical to one played from the start") {
+        MusicRuntime expected(song, 0, 0);
+        auto expectedFrame = playUntil(rc, expected, 1, 5);
+        CHECK(expectedFrame.speed == frame.speed);
+        for (int i = 0; i != 100; ++i) {
+            REQUIRE_FALSE(runtime->step(rc, frame));
+            REQUIRE_FALSE(expected.step(rc, expectedFrame));
+            CHECK(frame.order == expectedFrame.order);
+            CHECK(frame.row == expectedFrame.row);
+            CHECK(frame.startedNewRow == expectedFrame.startedNewRow);
+        }
+    }
+
+    SECTION("invalidate removes all checkpoints") {
+        cache.invalidate();
+        CHECK(cache.size() == 0);
+    }
+}
+
+TEST_CASE("seeked runtimes write the same registers as one played from the start", "[CheckpointCache]") {
+    Module mod;
+    auto &song = *mod.songs().get(0);
+    auto &track = song.patterns().getTrack(ChType::ch1, 0);
+    track.setNote(0, NOTE_C + OCTAVE_4);
+    track.setNote(40, NOTE_G + OCTAVE_6);
+
+    CheckpointCache cache;
+    // build checkpoints past the second note first, so that a runtime sharing
+    // state with the builder would have the second note's frequency
+    REQUIRE(cache.seek(mod, song, 0, 50));
+    auto runtime = cache.seek(mod, song, 0, 20);
+    REQUIRE(runtime);
+
+    MusicRuntime expected(song, 0, 0);
+    RegisterApu expectedApu;
+    RuntimeContext expectedRc(expectedApu, mod.instrumentTable(), mod.waveformTable());
+    Frame expectedFrame = playUntil(expectedRc, expected, 0, 19);
+    while (!expected.atRowStart()) {
+        REQUIRE_FALSE(expected.step(expectedRc, expectedFrame));
+    }
+
+    RegisterApu apu;
+    RuntimeContext rc(apu, mod.instrumentTable(), mod.waveformTable());
+    // write the restored state, like Engine::play
+    runtime->reloadAll(rc);
+
+    // step both from row 20 until past the second note
+    Frame frame;
+    do {
+        REQUIRE_FALSE(runtime->step(rc, frame));
+        REQUIRE_FALSE(expected.step(expectedRc, expectedFrame));
+        REQUIRE(frame.row == expectedFrame.row);
+        INFO("row " << frame.row);
+        CHECK(apu.regs[gbapu::Apu::REG_NR13] == expectedApu.regs[gbapu::Apu::REG_NR13]);
+        CHECK(apu.regs[gbapu::Apu::REG_NR14] == expectedApu.regs[gbapu::Apu::REG_NR14]);
+    } while (frame.row != 45);
+
+    SECTION("and after the cache is invalidated") {
+        cache.invalidate();
+        // the runtime no longer refers to anything owned by the cache
+        Frame frame;
+        REQUIRE_FALSE(runtime->step(rc, frame));
+        REQUIRE_FALSE(expected.step(expectedRc, frame));
+        CHECK(apu.regs == expectedApu.regs);
+    }
+}
+
+TEST_CASE("seek fails for unreachable rows", "[CheckpointCache]") {
+    Module mod;
+    auto &song = *mod.songs().get(0);
+    song.order().resize(2);
+    // jump to the second pattern on row 3, rows 4-63 are never played
+    song.patterns().getTrack(ChType::ch1, 0).setEffect(3, 0, EffectType::patternGoto, 1);
+
+    CheckpointCache cache(4);
+    CHECK(cache.seek(mod, song, 1, 2));
+    CHECK_FALSE(cache.seek(mod, song, 0, 10));
+    CHECK_FALSE(cache.seek(mod, song, 1, 10));
+}
+
+TEST_CASE("interval must be positive", "[CheckpointCache]") {
+    REQUIRE_THROWS_AS(CheckpointCache(0), std::invalid_argument);
+}
+
+
+}
@@ -0,0 +1,151 @@
+
+#include "trackerboy/engine/BufferedApu.hpp"
+#include "trackerboy/engine/CheckpointCache.hpp"
+#include "trackerboy/engine/Engine.hpp"
+#include "catch.hpp"
+
+#include <vector>
+
+using namespace trackerboy;
+
+namespace {
+
+class RecordingApu final : public IApu {
+
+public:
+    std::vector<RegisterWrite> writes;
+
+    uint8_t readRegister(uint8_t reg) override {
+        (void)reg;
+        return 0;
+    }
+
+    void writeRegister(uint8_t reg, uint8_t value) override {
+        writes.push_back({ reg, value });
+    }
+};
+
+}
+
+
+TEST_CASE("engine output does not depend on the apu binding", "[Engine]") {
+    Module mod;
+    auto &song = *mod.songs().get(0);
+    auto &track1 = song.patterns().getTrack(ChType::ch1, 0);
+    track1.setNote(0, 24);
+    track1.setEffect(4, 0, EffectType::setTimbre, 1);
+    auto &track3 = song.patterns().getTrack(ChType::ch3, 0);
+    track3.setNote(2, 36);
+
+    // type-erased engine
+    RecordingApu rec1;
+    BufferedApu buf1(rec1);
+    Engine engine1(buf1, &mod);
+    engine1.setSong(&song);
+
+    // statically bound engine
+    RecordingApu rec2;
+    BufferedApu buf2(rec2);
+    BasicEngine<BufferedApu> engine2(buf2, &mod);
+    engine2.setSong(&song);
+
+    engine1.play(0);
+    engine2.play(0);
+    for (int i = 0; i != 64; ++i) {
+        Frame frame1, frame2;
+        engine1.step(frame1);
+        engine2.step(frame2);
+        buf1.flush();
+        buf2.flush();
+        REQUIRE(frame1.row == frame2.row);
+        REQUIRE(rec1.writes.size() == rec2.writes.size());
+        for (size_t j = 0; j != rec1.writes.size(); ++j) {
+            REQUIRE(rec1.writes[j].reg == rec2.writes[j].reg);
+            REQUIRE(rec1.writes[j].value == rec2.writes[j].value);
+        }
+    }
+    CHECK_FALSE(rec1.writes.empty());
+}
+
+TEST_CASE("engine continues playing when given a snapshot", "[Engine]") {
+    Module mod;
+    auto &song = *mod.songs().get(0);
+    auto &instrument = mod.instrumentTable().insert(0);
+    instrument.setEnvelope(0xF0);
+    song.patterns().getTrack(ChType::ch1, 0).setNote(0, 24);
+    song.patterns().getTrack(ChType::ch1, 0).setInstrument(0, 0);
+
+    RecordingApu rec;
+    BufferedApu apu(rec);
+    Engine engine(apu, &mod);
+    engine.setSong(&song);
+    engine.play(0);
+
+    Frame frame;
+    for (int i = 0; i != 20; ++i) {
+        engine.step(frame);
+    }
+    REQUIRE(frame.row == 3);
+
+    // edit the module, then give the engine a snapshot of it
+    song.patterns().getTrack(ChType::ch1, 0).setNote(4, 36);
+    instrument.setEnvelope(0x57);
+    Song snapshotSong(song);
+    auto instruments = mod.instrumentTable().snapshot();
+    auto waveforms = mod.waveformTable().snapshot();
+    engine.setTables(*instruments, *waveforms);
+    engine.setSong(&snapshotSong);
+
+    // the song was not restarted
+    engine.step(frame);
+    CHECK_FALSE(frame.halted);
+    CHECK(frame.row == 3);
+    for (int i = 0; i != 6; ++i) {
+        engine.step(frame);
+    }
+    CHECK(frame.row == 4);
+
+    SECTION("a null song stops the music") {
+        engine.setSong(nullptr);
+        engine.step(frame);
+        CHECK(frame.halted);
+    }
+}
+
+TEST_CASE("engine plays a runtime seeked by another cache", "[Engine]") {
+    Module mod;
+    auto &song = *mod.songs().get(0);
+    song.order().resize(2);
+    auto &track = song.patterns().getTrack(ChType::ch1, 0);
+    track.setNote(0, 24);
+    track.setEffect(0, 0, EffectType::setTempo, 0x20);
+
+    // seeked by the engine
+    RecordingApu rec1;
+    Engine engine1(rec1, &mod);
+    engine1.setSong(&song);
+    engine1.play(1, 10);
+
+    // seeked elsewhere and handed to the engine
+    RecordingApu rec2;
+    Engine engine2(rec2, &mod);
+    engine2.setSong(&song);
+    CheckpointCache cache;
+    auto runtime = cache.seek(mod, song, 1, 10);
+    REQUIRE(runtime);
+    engine2.play(*runtime);
+
+    for (int i = 0; i != 64; ++i) {
+        Frame frame1, frame2;
+        engine1.step(frame1);
+        engine2.step(frame2);
+        REQUIRE(frame1.order == frame2.order);
+        REQUIRE(frame1.row == frame2.row);
+        REQUIRE(frame1.speed == frame2.speed);
+    }
+    REQUIRE(rec1.writes.size() == rec2.writes.size());
+    for (size_t i = 0; i != rec1.writes.size(); ++i) {
+        REQUIRE(rec1.writes[i].reg == rec2.writes[i].reg);
+        REQUIRE(rec1.writes[i].value == rec2.writes[i].value);
+    }
+}
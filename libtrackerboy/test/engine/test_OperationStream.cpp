@@ -0,0 +1,80 @@
+
+#include "trackerboy/data/Track.hpp"
+#include "trackerboy/engine/OperationStream.hpp"
+#include "catch.hpp"
+
+#include <utility>
+
+using namespace trackerboy;
+
+TEST_CASE("stream only contains non-empty rows", "[OperationStream]") {
+    Track track(64);
+    track.setNote(0, 12);
+    track.setEffect(10, 1, EffectType::setTempo, 0x20);
+    track.setInstrument(63, 2);
+
+    OperationStream stream(track);
+    REQUIRE(stream.size() == 3);
+
+    auto op = stream.find(0);
+    REQUIRE(op != nullptr);
+    CHECK(op->note == 12);
+
+    op = stream.find(10);
+    REQUIRE(op != nullptr);
+    CHECK(op->speed == 0x20);
+
+    op = stream.find(63);
+    REQUIRE(op != nullptr);
+    CHECK(op->instrument == 2);
+
+    CHECK(stream.find(1) == nullptr);
+    CHECK(stream.find(62) == nullptr);
+}
+
+TEST_CASE("track caches its stream until modified", "[OperationStream]") {
+    Track track(64);
+    track.setNote(4, 12);
+
+    auto stream = &track.operations();
+    REQUIRE(stream->size() == 1);
+
+    SECTION("const access keeps the stream") {
+        auto const& row = std::as_const(track)[4];
+        CHECK_FALSE(row.isEmpty());
+        CHECK(&track.operations() == stream);
+    }
+
+    SECTION("edits rebuild the stream") {
+        track.setNote(8, 24);
+        CHECK(track.operations().size() == 2);
+    }
+
+    SECTION("non-const access rebuilds the stream") {
+        track[4].setNote({});
+        CHECK(track.operations().size() == 0);
+    }
+
+    SECTION("copies share the stream") {
+        Track copy(track);
+        CHECK(track.isShared());
+        CHECK(&copy.operations() == stream);
+    }
+
+    SECTION("editing a copy does not change the original") {
+        Track copy(track);
+        copy.setNote(8, 24);
+        CHECK_FALSE(track.isShared());
+        CHECK(copy.operations().size() == 2);
+        CHECK(&track.operations() == stream);
+        CHECK(std::as_const(track)[8].isEmpty());
+    }
+
+    SECTION("editing the original does not change the copy") {
+        Track copy(track);
+        track.clear(0, 64);
+        CHECK(track.operations().size() == 0);
+        CHECK(&copy.operations() == stream);
+        CHECK_FALSE(std::as_const(copy)[4].isEmpty());
+    }
+}
@@ -0,0 +1,200 @@
+
+#include "trackerboy/engine/BufferedApu.hpp"
+#include "trackerboy/engine/TraceFile.hpp"
+#include "trackerboy/engine/TracePlayer.hpp"
+#include "trackerboy/engine/TraceRecorder.hpp"
+#include "trackerboy/export/TraceExporter.hpp"
+#include "catch.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace trackerboy;
+
+namespace trackerboy {
+
+// for comparisons in this test only
+bool operator==(RegisterWrite const& lhs, RegisterWrite const& rhs) {
+    return lhs.reg == rhs.reg && lhs.value == rhs.value;
+}
+
+}
+
+namespace {
+
+//
+// Apu that records every write given to it, along with the frame it was
+// written in
+//
+class FrameRecordingApu final : public IApu {
+
+public:
+    std::vector<std::vector<RegisterWrite>> frames{1};
+
+    uint8_t readRegister(uint8_t reg) override {
+        (void)reg;
+        return 0;
+    }
+
+    void writeRegister(uint8_t reg, uint8_t value) override {
+        frames.back().push_back({ reg, value });
+    }
+
+    void endFrame() {
+        frames.emplace_back();
+    }
+};
+
+std::vector<std::vector<RegisterWrite>> replay(std::string const& data) {
+    TracePlayer player(reinterpret_cast<uint8_t const*>(data.data()), data.size());
+    FrameRecordingApu apu;
+    while (player.step(apu)) {
+        apu.endFrame();
+    }
+    REQUIRE(player.isFinished());
+    // remove the frame that was started after the last one
+    apu.frames.pop_back();
+    return apu.frames;
+}
+
+}
+
+
+TEST_CASE("recorded writes are replayed in the same frames", "[Trace]") {
+    NullApu nullApu;
+    std::ostringstream stream;
+    TraceRecorder recorder(nullApu, stream, GB_FRAMERATE_DMG);
+
+    recorder.writeRegister(gbapu::Apu::REG_NR12, 0xF0);
+    recorder.writeRegister(gbapu::Apu::REG_NR14, 0x87);
+    recorder.endFrame();
+    // 300 empty frames, more than one run
+    for (int i = 0; i != 300; ++i) {
+        recorder.endFrame();
+    }
+    RegisterWrite const batch[] = {
+        { gbapu::Apu::REG_NR51, 0x11 },
+        { gbapu::Apu::REG_WAVERAM, 0x12 }
+    };
+    recorder.writeRegisters(batch, 2);
+    // ending the trace ends the last frame
+    recorder.finish();
+
+    CHECK(recorder.frames() == 302);
+    CHECK(recorder.writeCount() == 4);
+
+    auto const data = stream.str();
+    // the empty frames are run length encoded
+    CHECK(data.size() < trace::HEADER_SIZE + 32);
+
+    TracePlayer player(reinterpret_cast<uint8_t const*>(data.data()), data.size());
+    CHECK(player.framerate() == GB_FRAMERATE_DMG);
+
+    auto frames = replay(data);
+    REQUIRE(frames.size() == 302);
+    REQUIRE(frames[0].size() == 2);
+    CHECK(frames[0][0] == RegisterWrite{ gbapu::Apu::REG_NR12, 0xF0 });
+    CHECK(frames[0][1] == RegisterWrite{ gbapu::Apu::REG_NR14, 0x87 });
+    for (size_t i = 1; i != 301; ++i) {
+        CHECK(frames[i].empty());
+    }
+    REQUIRE(frames[301].size() == 2);
+    CHECK(frames[301][0] == batch[0]);
+    CHECK(frames[301][1] == batch[1]);
+
+    SECTION("rewind restarts playback") {
+        NullApu apu;
+        while (player.step(apu));
+        CHECK(player.frame() == 302);
+        player.rewind();
+        CHECK_FALSE(player.isFinished());
+        CHECK(player.frame() == 0);
+        CHECK(player.step(apu));
+    }
+}
+
+TEST_CASE("exported trace matches the engine's output", "[Trace]") {
+    Module mod;
+    auto song = mod.songs().get(0);
+    song->patterns().getTrack(ChType::ch1, 0).setNote(0, 24);
+    song->patterns().getTrack(ChType::ch1, 0).setNote(16, 36);
+
+    std::ostringstream stream;
+    auto frames = exportTrace(mod, *song, 1, stream);
+    CHECK(frames == song->patterns().rowSize() * (Song::DEFAULT_SPEED >> 4));
+
+    // run the engine again, recording what it writes
+    FrameRecordingApu expected;
+    BufferedApu apu(expected);
+    Engine engine(apu, &mod);
+    engine.setSong(song);
+    Player player(engine);
+    player.start(1);
+    for (;;) {
+        player.step();
+        if (!player.isPlaying()) {
+            break;
+        }
+        apu.flush();
+        expected.endFrame();
+    }
+    expected.frames.pop_back();
+
+    auto actual = replay(stream.str());
+    REQUIRE(actual.size() == expected.frames.size());
+    CHECK(actual == expected.frames);
+}
+
+TEST_CASE("invalid traces are rejected", "[Trace]") {
+    std::string data = "not a trace file";
+    auto bytes = reinterpret_cast<uint8_t const*>(data.data());
+    REQUIRE_THROWS_AS(TracePlayer(bytes, data.size()), std::invalid_argument);
+    REQUIRE_THROWS_AS(TracePlayer(bytes, 4), std::invalid_argument);
+
+    SECTION("truncated trace") {
+        NullApu nullApu;
+        std::ostringstream stream;
+        TraceRecorder recorder(nullApu, stream, GB_FRAMERATE_DMG);
+        recorder.writeRegister(gbapu::Apu::REG_NR12, 0xF0);
+        recorder.finish();
+        auto trace = stream.str();
+        trace.resize(trace.size() - 2);
+        TracePlayer player(reinterpret_cast<uint8_t const*>(trace.data()), trace.size());
+        NullApu apu;
+        REQUIRE_THROWS_AS(player.step(apu), std::runtime_error);
+    }
+}
+
+TEST_CASE("traces can be played from a mapped file", "[Trace]") {
+    auto const path = (std::filesystem::temp_directory_path() / "trackerboy_test_trace.tbt").string();
+
+    {
+        NullApu nullApu;
+        std::ofstream stream(path, std::ios::binary);
+        TraceRecorder recorder(nullApu, stream, GB_FRAMERATE_SGB);
+        recorder.writeRegister(gbapu::Apu::REG_NR12, 0xF0);
+        recorder.endFrame();
+        recorder.endFrame();
+        recorder.finish();
+    }
+
+    {
+        TraceFile file(path);
+        REQUIRE(file.isOpen());
+        TracePlayer player(file.data(), file.size());
+        CHECK(player.framerate() == GB_FRAMERATE_SGB);
+        FrameRecordingApu apu;
+        CHECK(player.step(apu));
+        CHECK(player.step(apu));
+        CHECK_FALSE(player.step(apu));
+        CHECK(apu.frames.front().size() == 1);
+    }
+
+    std::remove(path.c_str());
+
+    REQUIRE_THROWS_AS(TraceFile(path), std::runtime_error);
+}
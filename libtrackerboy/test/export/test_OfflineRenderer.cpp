@@ -0,0 +1,74 @@
+
+#include "trackerboy/export/OfflineRenderer.hpp"
+#include "catch.hpp"
+
+#include <vector>
+
+using namespace trackerboy;
+
+namespace {
+
+constexpr int SAMPLERATE = 48000;
+
+}
+
+TEST_CASE("renders every frame of the song", "[OfflineRenderer]") {
+    Module mod;
+    auto song = mod.songs().get(0);
+    // 1 pattern, 64 rows at 6 frames per row
+    int const expectedFrames = song->patterns().rowSize() * (Song::DEFAULT_SPEED >> 4);
+
+    OfflineRenderer renderer(mod, SAMPLERATE);
+
+    SECTION("into a buffer") {
+        REQUIRE(renderer.start(0, 1));
+        std::vector<int16_t> buffer(1000 * 2);
+        size_t total = 0;
+        for (;;) {
+            auto rendered = renderer.render(buffer.data(), 1000);
+            total += rendered;
+            if (rendered != 1000) {
+                break;
+            }
+        }
+        CHECK(renderer.isFinished());
+        CHECK(renderer.framesRendered() == expectedFrames);
+        CHECK(total > 0);
+        CHECK(renderer.render(buffer.data(), 1000) == 0);
+    }
+
+    SECTION("into a sink") {
+        REQUIRE(renderer.start(0, 1));
+        size_t total = 0;
+        renderer.render([&total](int16_t const* samples, size_t count) {
+            (void)samples;
+            total += count;
+        });
+        CHECK(renderer.isFinished());
+        CHECK(renderer.framesRendered() == expectedFrames);
+        CHECK(total > 0);
+    }
+
+    SECTION("disabled channels do not change the render length") {
+        REQUIRE(renderer.isChannelEnabled(ChType::ch1));
+        renderer.setChannelEnabled(ChType::ch1, false);
+        renderer.setChannelEnabled(ChType::ch3, false);
+        CHECK_FALSE(renderer.isChannelEnabled(ChType::ch1));
+        CHECK(renderer.isChannelEnabled(ChType::ch2));
+        REQUIRE(renderer.start(0, 1));
+        renderer.render([](int16_t const* samples, size_t count) {
+            (void)samples;
+            (void)count;
+        });
+        CHECK(renderer.framesRendered() == expectedFrames);
+    }
+
+    SECTION("nothing is rendered for a 0 duration") {
+        REQUIRE_FALSE(renderer.start(0, 0));
+        CHECK(renderer.isFinished());
+    }
+
+    SECTION("invalid song index throws") {
+        REQUIRE_THROWS_AS(renderer.start(1, 1), std::invalid_argument);
+    }
+}
@@ -0,0 +1,89 @@
+
+#include "trackerboy/export/SongAnalyzer.hpp"
+#include "trackerboy/engine/MusicRuntime.hpp"
+#include "catch.hpp"
+
+using namespace trackerboy;
+
+namespace {
+
+// frames per row at the default speed
+constexpr int FRAMES_PER_ROW = Song::DEFAULT_SPEED >> 4;
+
+}
+
+
+TEST_CASE("default song loops back to the start", "[SongAnalyzer]") {
+    Module mod;
+    auto &song = *mod.songs().get(0);
+
+    SongAnalyzer analyzer;
+    analyzer.analyze(mod, song);
+
+    CHECK_FALSE(analyzer.halts());
+    CHECK(analyzer.timeline().size() == (size_t)song.patterns().rowSize());
+    CHECK(analyzer.loopIndex() == 0);
+    CHECK(analyzer.loopFrame() == 0);
+    CHECK(analyzer.totalFrames() == song.patterns().rowSize() * FRAMES_PER_ROW);
+    CHECK(analyzer.framesForLoops(3) == analyzer.totalFrames() * 3);
+    CHECK(analyzer.frameOf(0, 10) == 10 * FRAMES_PER_ROW);
+    CHECK(analyzer.sampleOf(60, 48000) == (uint64_t)(60 * 48000 / mod.framerate()));
+}
+
+TEST_CASE("pattern effects change the timeline", "[SongAnalyzer]") {
+    Module mod;
+    auto &song = *mod.songs().get(0);
+    song.order().resize(2);
+    auto &track = song.patterns().getTrack(ChType::ch1, 0);
+    SongAnalyzer analyzer;
+
+    SECTION("C00 halts the song") {
+        track.setEffect(3, 0, EffectType::patternHalt);
+        analyzer.analyze(mod, song);
+        CHECK(analyzer.halts());
+        CHECK(analyzer.loopIndex() == -1);
+        CHECK(analyzer.loopFrame() == -1);
+        CHECK(analyzer.timeline().size() == 4);
+        CHECK(analyzer.totalFrames() == 4 * FRAMES_PER_ROW);
+        CHECK(analyzer.framesForLoops(2) == analyzer.totalFrames());
+
+        // the runtime halts on the same frame
+        NullApu apu;
+        RuntimeContext rc(apu, mod.instrumentTable(), mod.waveformTable());
+        MusicRuntime runtime(song, 0, 0);
+        Frame frame;
+        int frames = 0;
+        while (!runtime.step(rc, frame)) {
+            ++frames;
+        }
+        CHECK(frames == analyzer.totalFrames());
+    }
+
+    SECTION("Bxx sets the loop point") {
+        track.setEffect(3, 0, EffectType::patternGoto, 1);
+        analyzer.analyze(mod, song);
+        CHECK_FALSE(analyzer.halts());
+        CHECK(analyzer.timeline().size() == 8);
+        CHECK(analyzer.loopIndex() == 4);
+        CHECK(analyzer.loopFrame() == 4 * FRAMES_PER_ROW);
+        CHECK(analyzer.totalFrames() == 8 * FRAMES_PER_ROW);
+        CHECK(analyzer.framesForLoops(2) == 12 * FRAMES_PER_ROW);
+        CHECK(analyzer.frameOf(0, 4) == -1);
+    }
+
+    SECTION("Fxx changes the frame timing") {
+        track.setEffect(0, 0, EffectType::setTempo, 0x20);
+        analyzer.analyze(mod, song);
+        CHECK(analyzer.frameOf(0, 1) == 2);
+        CHECK(analyzer.frameOf(1, 0) == 2 * song.patterns().rowSize());
+        // first row of the song now has a different speed than when the song
+        // started, so the loop point is the second row
+        CHECK(analyzer.loopIndex() == 1);
+    }
+
+    SECTION("invalid rows throw") {
+        analyzer.analyze(mod, song);
+        CHECK_THROWS_AS(analyzer.frameOf(2, 0), std::invalid_argument);
+        CHECK_THROWS_AS(analyzer.frameOf(0, 64), std::invalid_argument);
+    }
+}
@@ -3,13 +3,19 @@
 
 
 Module::Editor::Editor(Module &mod) :
-    QMutexLocker(&mod.mMutex)
+    QMutexLocker(&mod.mMutex),
+    mModule(mod)
 {
+    ++mod.mRevision;
+}
+
+Module::Editor::~Editor() {
+    unlock();
+    emit mModule.edited();
 }
 
 Module::PermanentEditor::PermanentEditor(Module &mod) :
-    Editor(mod),
-    mModule(mod)
+    Editor(mod)
 {
 }
 
@@ -26,7 +32,10 @@ Module::Module(QObject *parent) :
     mSongUndoStacks(),
     mSong(),
     mPermaDirty(false),
-    mModified(false)
+    mModified(false),
+    mRevision(0),
+    mSnapshot(),
+    mSnapshotSong(nullptr)
 {
     reset();
 
@@ -70,10 +79,38 @@ bool Module::isModified() const {
     return mModified;
 }
 
+unsigned Module::revision() const {
+    return mRevision;
+}
+
 QMutex& Module::mutex() {
     return mMutex;
 }
 
+std::shared_ptr<Module::Snapshot const> Module::snapshot() {
+    if (mSnapshot && mSnapshot->revision == mRevision && mSnapshotSong == mSong.get()) {
+        return mSnapshot;
+    }
+
+    auto snapshot = std::make_shared<Snapshot>();
+    snapshot->revision = mRevision;
+    snapshot->song = std::make_shared<trackerboy::Song const>(*mSong);
+    // edited tracks have no operation stream yet, build them here so that
+    // the render thread never has to
+    snapshot->song->patterns().buildOperations();
+    if (mSnapshot) {
+        snapshot->instrumentTable = mModule.instrumentTable().snapshot(mSnapshot->instrumentTable.get());
+        snapshot->waveformTable = mModule.waveformTable().snapshot(mSnapshot->waveformTable.get());
+    } else {
+        snapshot->instrumentTable = mModule.instrumentTable().snapshot();
+        snapshot->waveformTable = mModule.waveformTable().snapshot();
+    }
+
+    mSnapshot = std::move(snapshot);
+    mSnapshotSong = mSong.get();
+    return mSnapshot;
+}
+
 QUndoGroup* Module::undoGroup() {
     return mUndoGroup;
 }
@@ -83,6 +120,7 @@ QUndoStack* Module::undoStack() {
 }
 
 void Module::reset() {
+    ++mRevision;
     resizeUndoStacks(mModule.songs().size());
     setSong(0);
     clean();
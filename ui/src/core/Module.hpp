@@ -3,6 +3,7 @@
 
 #include "trackerboy/data/Module.hpp"
 #include "trackerboy/data/Song.hpp"
+#include "trackerboy/data/Table.hpp"
 
 #include <QMutex>
 #include <QMutexLocker>
@@ -11,6 +12,8 @@
 #include <QUndoStack>
 #include <QVector>
 
+#include <memory>
+
 //
 // Container class for a trackerboy::Module. Also contains a QMutex and
 // QUndoStacks for editing. Model classes edit the contained module.
@@ -24,10 +27,17 @@ public:
     //
     // Editor is just a QMutexLocker subclass. This
     // context is used for edits that can be undone, by using a QUndoCommand
-    // subclass.
+    // subclass. The edited signal is emitted when the editor is destructed.
     //
     class Editor : public QMutexLocker {
 
+    public:
+        ~Editor();
+
+    protected:
+        Module &mModule;
+
+    private:
         friend class Module;
 
         Editor(Module &module);
@@ -47,8 +57,19 @@ public:
 
         PermanentEditor(Module &module);
 
-        Module &mModule;
+    };
 
+    //
+    // An immutable copy of the current song and the module's tables. The
+    // renderer plays from a snapshot so that it never has to lock the module.
+    // Unchanged table items are shared between snapshots, and the song's
+    // tracks are copy-on-write, so making one is cheap.
+    //
+    struct Snapshot {
+        unsigned revision;
+        std::shared_ptr<trackerboy::Song const> song;
+        std::shared_ptr<trackerboy::InstrumentTable const> instrumentTable;
+        std::shared_ptr<trackerboy::WaveformTable const> waveformTable;
     };
 
     explicit Module(QObject *parent = nullptr);
@@ -78,8 +99,22 @@ public:
 
     bool isModified() const;
 
+    //
+    // Revision number of the module data, incremented each time an edit is
+    // started or the module is reset. Used to detect when data derived from
+    // the module (ie a snapshot) is out of date.
+    //
+    unsigned revision() const;
+
     QMutex& mutex();
 
+    //
+    // Gets a snapshot of the module for the current song. A new snapshot is
+    // only made when the module was edited or the current song changed since
+    // the last call. GUI thread only.
+    //
+    std::shared_ptr<Snapshot const> snapshot();
+
     QUndoGroup* undoGroup();
 
     QUndoStack* undoStack();
@@ -155,6 +190,12 @@ signals:
     //
     void songChanged();
 
+    //
+    // Emitted after an edit has finished (the editor returned by edit() or
+    // permanentEdit() was destructed).
+    //
+    void edited();
+
 private:
 
     //
@@ -185,5 +226,11 @@ private:
     //
     bool mModified;
 
+    unsigned mRevision;
+
+    std::shared_ptr<Snapshot const> mSnapshot;
+    // the song mSnapshot was made from
+    trackerboy::Song const* mSnapshotSong;
+
 };
 
@@ -0,0 +1,82 @@
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+//
+// Bounded, wait-free queue for a single producer thread and a single consumer
+// thread. Neither push or pop will block or allocate, making this suitable
+// for sending messages to a realtime thread.
+//
+// Items are moved into and out of a fixed array of Capacity slots, so T must
+// be default constructible and move assignable. A popped slot is left in a
+// moved-from state.
+//
+// Ownership of either end can be handed to another thread, provided that the
+// hand off synchronizes (ie the previous owner has stopped and the new owner
+// has waited for it).
+//
+template <class T, size_t Capacity>
+class SpscQueue {
+
+    static_assert(Capacity > 1 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of 2");
+
+public:
+
+    SpscQueue() :
+        mItems(),
+        mHead(0),
+        mTail(0)
+    {
+    }
+
+    //
+    // Producer only. Moves the item into the queue if there is room, returns
+    // false if the queue is full (the item is not moved from).
+    //
+    bool push(T &&item) {
+        auto const tail = mTail.load(std::memory_order_relaxed);
+        if (tail - mHead.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        mItems[tail & MASK] = std::move(item);
+        mTail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    //
+    // Consumer only. Moves the next item out of the queue, returns false if
+    // the queue is empty.
+    //
+    bool pop(T &item) {
+        auto const head = mHead.load(std::memory_order_relaxed);
+        if (head == mTail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = std::move(mItems[head & MASK]);
+        mHead.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    //
+    // Determines if the queue is empty. Only exact when called by the consumer
+    //
+    bool isEmpty() const {
+        return mHead.load(std::memory_order_acquire) == mTail.load(std::memory_order_acquire);
+    }
+
+private:
+
+    static constexpr size_t MASK = Capacity - 1;
+
+    std::array<T, Capacity> mItems;
+
+    // the head is written by the consumer and the tail by the producer, keep
+    // them on separate cache lines to avoid false sharing
+    alignas(64) std::atomic<size_t> mHead;
+    alignas(64) std::atomic<size_t> mTail;
+
+};
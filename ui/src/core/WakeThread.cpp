@@ -0,0 +1,45 @@
+#include "core/WakeThread.hpp"
+
+WakeThread::WakeThread(CallbackFn function, void *data, QObject *parent) :
+    QThread(parent),
+    mCallback(function),
+    mCallbackData(data),
+    mSemaphore(),
+    mPending(false),
+    mQuit(false)
+{
+}
+
+WakeThread::~WakeThread() {
+    stop();
+}
+
+void WakeThread::wake() noexcept {
+    if (!mPending.exchange(true, std::memory_order_acq_rel)) {
+        mSemaphore.release();
+    }
+}
+
+void WakeThread::stop() {
+    if (isRunning()) {
+        mQuit = true;
+        mSemaphore.release();
+        wait();
+        // reset for the next start
+        mSemaphore.tryAcquire(mSemaphore.available());
+        mPending = false;
+        mQuit = false;
+    }
+}
+
+void WakeThread::run() {
+    for (;;) {
+        mSemaphore.acquire();
+        if (mQuit) {
+            break;
+        }
+        // clear before invoking so that a wake during the callback is not lost
+        mPending.store(false, std::memory_order_release);
+        mCallback(mCallbackData);
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QSemaphore>
+#include <QThread>
+
+#include <atomic>
+
+//
+// Thread that invokes a callback function each time it is woken. Similar to
+// FastTimer, but the callback is driven by calls to wake() instead of a timer
+// interval.
+//
+// wake() may be called from any thread, including a realtime audio callback.
+// Wakes are coalesced: waking an already woken thread does nothing, so the
+// semaphore is released at most once per callback invocation.
+//
+class WakeThread : public QThread {
+
+public:
+
+    using CallbackFn = void(*)(void*);
+
+    explicit WakeThread(CallbackFn function, void *data = nullptr, QObject *parent = nullptr);
+    ~WakeThread();
+
+    //
+    // Wakes the thread, the callback will be invoked once the thread is
+    // scheduled.
+    //
+    void wake() noexcept;
+
+    //
+    // Stops the thread and waits for it to finish. Called by the destructor.
+    //
+    void stop();
+
+protected:
+
+    virtual void run() override;
+
+private:
+
+    Q_DISABLE_COPY(WakeThread)
+
+    CallbackFn const mCallback;
+    void *const mCallbackData;
+
+    QSemaphore mSemaphore;
+    std::atomic_bool mPending;
+    std::atomic_bool mQuit;
+
+};
@@ -3,6 +3,84 @@
 
 #include "miniaudio.h"
 
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <array>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+namespace {
+
+// samples per block, about 0.7 seconds at 48 kHz
+constexpr size_t BLOCK_SIZE = trackerboy::OfflineRenderer::DEFAULT_BLOCKSIZE * 4;
+// enough blocks so that neither thread waits on the other for long
+constexpr size_t BLOCK_COUNT = 4;
+// stdio buffer for the output file
+constexpr size_t FILE_BUFFER_SIZE = 1 << 20;
+
+struct Block {
+    std::vector<int16_t> samples;
+    size_t count;
+};
+
+//
+// Blocking FIFO of blocks shared between the render and encode threads.
+//
+class BlockQueue {
+
+public:
+    BlockQueue() :
+        mMutex(),
+        mCond(),
+        mBlocks(),
+        mHead(0),
+        mCount(0)
+    {
+    }
+
+    void push(Block *block) {
+        QMutexLocker locker(&mMutex);
+        mBlocks[(mHead + mCount) % BLOCK_COUNT] = block;
+        ++mCount;
+        mCond.wakeOne();
+    }
+
+    Block* pop() {
+        QMutexLocker locker(&mMutex);
+        while (mCount == 0) {
+            mCond.wait(&mMutex);
+        }
+        auto block = mBlocks[mHead];
+        mHead = (mHead + 1) % BLOCK_COUNT;
+        --mCount;
+        return block;
+    }
+
+private:
+    QMutex mMutex;
+    QWaitCondition mCond;
+    // one extra slot for the end of stream marker (nullptr)
+    std::array<Block*, BLOCK_COUNT + 1> mBlocks;
+    size_t mHead;
+    size_t mCount;
+};
+
+size_t onEncoderWrite(ma_encoder *encoder, void const *buffer, size_t bytesToWrite) {
+    return fwrite(buffer, 1, bytesToWrite, static_cast<FILE*>(encoder->pUserData));
+}
+
+ma_bool32 onEncoderSeek(ma_encoder *encoder, int byteOffset, ma_seek_origin origin) {
+    return fseek(
+        static_cast<FILE*>(encoder->pUserData),
+        byteOffset,
+        origin == ma_seek_origin_current ? SEEK_CUR : SEEK_SET
+    ) == 0;
+}
+
+}
+
 
 WavExporter::WavExporter(
     Module const& mod,
@@ -10,16 +88,13 @@ WavExporter::WavExporter(
     QObject *parent
 ) :
     QThread(parent),
-    mSamplerate(samplerate),
-    mSynth(samplerate, mod.data().framerate()),
-    mApu(mSynth.apu()),
-    mEngine(mApu, &mod.data()),
+    mSong(mod.song()),
+    mRenderer(mod.data(), samplerate),
     mDuration(0),
     mDestination(),
     mFailed(false),
     mAbort(false)
 {
-    mEngine.setSong(mod.song());
 }
 
 void WavExporter::setDuration(trackerboy::Player::Duration duration) {
@@ -30,76 +105,109 @@ void WavExporter::setDestination(QString const& dest) {
     mDestination = dest;
 }
 
+void WavExporter::setChannelEnabled(trackerboy::ChType ch, bool enabled) {
+    mRenderer.setChannelEnabled(ch, enabled);
+}
+
 bool WavExporter::failed() const {
     return mFailed;
 }
 
 void WavExporter::cancel() {
-    QMutexLocker locker(&mMutex);
-    mAbort = true;
+    mAbort.store(true, std::memory_order_relaxed);
 }
 
 
 void WavExporter::run() {
-    
-    trackerboy::Player player(mEngine);
-    player.start(mDuration);
 
-    ma_encoder_config config = ma_encoder_config_init(ma_resource_format_wav, ma_format_s16, 2, mSamplerate);
-    ma_encoder encoder;
+    mRenderer.start(*mSong, mDuration);
 
     auto dest = mDestination.toLatin1();
-    auto result = ma_encoder_init_file(dest.data(), &config, &encoder);
+    auto file = fopen(dest.data(), "wb");
+    if (file == nullptr) {
+        mFailed = true;
+        return;
+    }
+    std::unique_ptr<char[]> fileBuffer(new char[FILE_BUFFER_SIZE]);
+    setvbuf(file, fileBuffer.get(), _IOFBF, FILE_BUFFER_SIZE);
+
+    ma_encoder_config config = ma_encoder_config_init(ma_resource_format_wav, ma_format_s16, 2, mRenderer.samplerate());
+    ma_encoder encoder;
+    auto result = ma_encoder_init(onEncoderWrite, onEncoderSeek, file, &config, &encoder);
     if (result != MA_SUCCESS) {
+        fclose(file);
         mFailed = true;
         return;
     }
 
-    // temporary buffer for transferring samples from apu to the wav file
-    std::vector<int16_t> buffer;
-    buffer.resize(mSynth.framesize() * 2);
+    std::array<Block, BLOCK_COUNT> blocks;
+    BlockQueue freeBlocks;
+    BlockQueue filledBlocks;
+    for (auto &block : blocks) {
+        block.samples.resize(BLOCK_SIZE * 2);
+        block.count = 0;
+        freeBlocks.push(&block);
+    }
+
+    // the encoder thread writes filled blocks until it gets the end marker.
+    // If a write fails it keeps recycling blocks so the render loop never
+    // stalls, the render loop checks writeFailed and stops early.
+    std::atomic_bool writeFailed(false);
+    std::unique_ptr<QThread> encoderThread(QThread::create([&]() {
+        for (;;) {
+            auto block = filledBlocks.pop();
+            if (block == nullptr) {
+                break;
+            }
+            if (!writeFailed.load(std::memory_order_relaxed)) {
+                auto written = ma_encoder_write_pcm_frames(&encoder, block->samples.data(), block->count);
+                if (written != block->count) {
+                    writeFailed.store(true, std::memory_order_relaxed);
+                }
+            }
+            freeBlocks.push(block);
+        }
+    }));
+    encoderThread->start();
 
-    emit progressMax(player.progressMax());
-    auto lastProgress = player.progress();
+    emit progressMax(mRenderer.progressMax());
+    auto lastProgress = mRenderer.progress();
     emit progress(lastProgress);
-    auto &apu = mSynth.apu();
 
     for (;;) {
 
-        mMutex.lock();
-        if (mAbort) {
-            mAbort = false;
-            mMutex.unlock();
+        if (mAbort.exchange(false, std::memory_order_relaxed) || writeFailed.load(std::memory_order_relaxed)) {
             break;
         }
-        mMutex.unlock();
 
-        auto currentProgress = player.progress();
+        auto block = freeBlocks.pop();
+        auto const rendered = mRenderer.render(block->samples.data(), BLOCK_SIZE);
+        block->count = rendered;
+        if (rendered) {
+            filledBlocks.push(block);
+        } else {
+            freeBlocks.push(block);
+        }
+
+        auto currentProgress = mRenderer.progress();
         if (currentProgress != lastProgress) {
             lastProgress = currentProgress;
             emit progress(currentProgress);
         }
 
-        player.step();
-        if (!player.isPlaying()) {
+        if (rendered != BLOCK_SIZE) {
+            // render finished
             break;
         }
-        mSynth.run();
-
-        auto samplesRead = apu.readSamples(buffer.data(), buffer.size());
-
-        size_t toWrite = samplesRead;
-        auto dataPtr = buffer.data();
-        while (toWrite) {
-            auto written = ma_encoder_write_pcm_frames(&encoder, dataPtr, toWrite);
-            toWrite -= written;
-            dataPtr += written * 2;
-        }
-
 
     }
 
+    // drain the pipeline
+    filledBlocks.push(nullptr);
+    encoderThread->wait();
+
     ma_encoder_uninit(&encoder);
-    mFailed = false;
-    
+    auto const closeFailed = fclose(file) != 0;
+    mFailed = closeFailed || writeFailed.load(std::memory_order_relaxed);
+
 }
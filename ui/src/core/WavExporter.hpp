@@ -3,14 +3,20 @@
 
 #include "core/Module.hpp"
 
-#include "trackerboy/Synth.hpp"
-#include "trackerboy/export/Player.hpp"
+#include "trackerboy/export/OfflineRenderer.hpp"
 
 #include <QThread>
-#include <QMutex>
 
+#include <atomic>
+
+//
+// Worker thread for exporting a module to a wav file. Each exporter has its
+// own renderer, so multiple exporters can run at the same time (ie one per
+// channel when exporting stems).
 //
-// Worker thread for exporting a module to a wav file
+// Exporting is pipelined: this thread renders into a small pool of large
+// blocks while a second thread encodes filled blocks to the file, so
+// synthesis and disk I/O overlap.
 //
 class WavExporter : public QThread {
     Q_OBJECT
@@ -26,6 +32,11 @@ public:
 
     void setDestination(QString const& dest);
 
+    //
+    // Sets whether the given channel is audible in the exported file
+    //
+    void setChannelEnabled(trackerboy::ChType ch, bool enabled);
+
     bool failed() const;
 
     void cancel();
@@ -38,18 +49,14 @@ protected:
     virtual void run() override;
 
 private:
-    QMutex mMutex;
-
-    int mSamplerate;
-    trackerboy::Synth mSynth;
-    trackerboy::GbApu mApu;
-    trackerboy::Engine mEngine;
+    trackerboy::Song const* mSong;
+    trackerboy::OfflineRenderer mRenderer;
 
     trackerboy::Player::Duration mDuration;
 
     QString mDestination;
 
     bool mFailed;
-    bool mAbort;
+    std::atomic_bool mAbort;
 
 };
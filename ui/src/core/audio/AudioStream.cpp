@@ -4,9 +4,6 @@
 
 #include <QtDebug>
 
-#include <algorithm>
-
-
 
 static const char* LOG_PREFIX = "[AudioStream]";
 
@@ -18,8 +15,10 @@ AudioStream::AudioStream() :
     mBuffer(),
     mSamplerate(0),
     mRunning(false),
-    mPlaybackDelay(0),
-    mUnderruns(0)
+    mPullCallback(nullptr),
+    mPullCallbackData(nullptr),
+    mUnderruns(0),
+    mFramesPlayed(0)
 {
 }
 
@@ -49,13 +48,21 @@ size_t AudioStream::bufferSize() {
 }
 
 double AudioStream::elapsed() {
-    return 0.0;
+    if (mSamplerate == 0) {
+        return 0.0;
+    }
+    return (double)mFramesPlayed.load(std::memory_order_relaxed) / mSamplerate;
 }
 
 AudioRingbuffer::Writer AudioStream::writer() {
     return mBuffer.writer();
 }
 
+void AudioStream::setPullCallback(PullCallbackFn function, void *data) {
+    mPullCallback = function;
+    mPullCallbackData = data;
+}
+
 void AudioStream::setConfig(SoundConfig const& config) {
 
     auto const samplerate = config.samplerate();
@@ -79,6 +86,8 @@ void AudioStream::setConfig(SoundConfig const& config) {
     // must be disabled when applying config
     disable();
 
+    mSamplerate = samplerate;
+
     // update buffer size
     mBuffer.init((size_t)(config.latency() * samplerate / 1000));
 
@@ -97,11 +106,13 @@ void AudioStream::setConfig(SoundConfig const& config) {
 
 }
 
+void AudioStream::resetBuffer() {
+    mBuffer.reset();
+}
+
 bool AudioStream::start() {
     if (isEnabled() && !isRunning()) {
-        mBuffer.reset();
-        mPlaybackDelay = mBuffer.size();
-        
+        mFramesPlayed = 0;
         auto result = ma_device_start(mDevice.get());
         if (result != MA_SUCCESS) {
             handleError("failed to start device:", result);
@@ -147,16 +158,17 @@ void AudioStream::deviceDataCallback(ma_device *device, void *out, const void *i
 }
 
 void AudioStream::handleData(int16_t *out, size_t frames) {
-    if (mPlaybackDelay) {
-        auto samples = std::min(mPlaybackDelay, frames);
-        frames -= samples;
-        std::fill_n(out, samples * 2, (int16_t)0);
-        out += samples * 2;
-        mPlaybackDelay -= samples;
+    bool expecting = true;
+    if (mPullCallback) {
+        expecting = mPullCallback(mPullCallbackData, frames);
     }
 
     auto reader = mBuffer.reader();
-    reader.fullRead(out, frames);
+    auto const read = reader.fullRead(out, frames);
+    mFramesPlayed.fetch_add(read, std::memory_order_relaxed);
+    if (read < frames && expecting) {
+        mUnderruns.fetch_add(1, std::memory_order_relaxed);
+    }
     
 }
 
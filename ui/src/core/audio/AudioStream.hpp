@@ -22,6 +22,14 @@ class AudioStream : public QObject {
 
 public:
 
+    //
+    // Callback invoked by the device before reading from the buffer, see
+    // setPullCallback. Returns true if the buffer is expected to have the
+    // requested frames, false if the stream is finishing and a short read is
+    // not an underrun.
+    //
+    using PullCallbackFn = bool(*)(void *data, size_t frames);
+
     explicit AudioStream();
     ~AudioStream();
 
@@ -52,7 +60,8 @@ public:
     void setConfig(SoundConfig const& config);
 
     //
-    // Currently unused
+    // Number of device reads that got less than the requested frames while
+    // audio was expected, since the last resetUnderruns.
     //
     int underruns() const;
 
@@ -67,7 +76,7 @@ public:
     size_t bufferSize();
 
     //
-    // Unused, always returns 0.0
+    // Seconds of audio played out since the stream was last started.
     //
     double elapsed();
 
@@ -78,9 +87,25 @@ public:
     //
     AudioRingbuffer::Writer writer();
 
+    //
+    // Sets a callback to be invoked from the audio callback thread each time
+    // the device requests frames, just before they are read from the buffer.
+    // This lets the buffer be filled on demand instead of polled. The callback
+    // must be realtime safe. Must only be called when the stream is disabled
+    // or stopped.
+    //
+    void setPullCallback(PullCallbackFn function, void *data);
+
+    //
+    // Empties the buffer. Must only be called when the stream is not running.
+    //
+    void resetBuffer();
+
     //
     // start the stream, true is returned on success. If a stream is already
-    // running this function does nothing.
+    // running this function does nothing. There is no initial delay, the
+    // device plays what is in the buffer from its first callback. The buffer
+    // should be primed beforehand to avoid an underrun on start.
     //
     bool start();
 
@@ -123,7 +148,10 @@ private:
 
     std::atomic_bool mRunning;
 
-    size_t mPlaybackDelay;
+    PullCallbackFn mPullCallback;
+    void *mPullCallbackData;
 
     std::atomic_int mUnderruns;
+    // frames read by the device since the last start
+    std::atomic<uint64_t> mFramesPlayed;
 };
@@ -0,0 +1,85 @@
+
+#include "core/audio/LatencyController.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+// how long to observe headroom before shrinking the target
+constexpr auto WINDOW = std::chrono::milliseconds(500);
+
+// how long to wait before shrinking again after an underrun
+constexpr auto HOLD = std::chrono::seconds(4);
+
+// headroom always kept, in addition to the render time guard
+constexpr unsigned GUARD_MS = 2;
+
+constexpr size_t NO_HEADROOM = std::numeric_limits<size_t>::max();
+
+}
+
+LatencyController::LatencyController() :
+    mMinTarget(0),
+    mMaxTarget(0),
+    mTarget(0),
+    mSamplerate(0),
+    mUnderruns(0),
+    mWindowEnd(),
+    mMinHeadroom(NO_HEADROOM),
+    mWorstRender(0)
+{
+}
+
+void LatencyController::reset(size_t minTarget, size_t maxTarget, unsigned samplerate) {
+    mMaxTarget = maxTarget;
+    mMinTarget = std::min(minTarget, maxTarget);
+    mTarget = maxTarget;
+    mSamplerate = samplerate;
+}
+
+void LatencyController::restart(Clock::time_point now, int underruns) {
+    mUnderruns = underruns;
+    startWindow(now, WINDOW);
+}
+
+size_t LatencyController::target() const noexcept {
+    return mTarget;
+}
+
+size_t LatencyController::update(Clock::time_point now, int underruns, size_t headroom, Clock::duration renderTime) {
+
+    if (underruns != mUnderruns) {
+        // the count goes down when the diagnostics are cleared
+        bool const underran = underruns > mUnderruns;
+        mUnderruns = underruns;
+        if (underran) {
+            mTarget = std::min(mMaxTarget, mTarget + std::max(mTarget / 2, mMinTarget));
+            startWindow(now, HOLD);
+            return mTarget;
+        }
+    }
+
+    mMinHeadroom = std::min(mMinHeadroom, headroom);
+    mWorstRender = std::max(mWorstRender, renderTime);
+
+    if (now >= mWindowEnd) {
+        if (mMinHeadroom != NO_HEADROOM) {
+            auto const renderFrames = (size_t)(std::chrono::duration<double>(mWorstRender).count() * mSamplerate);
+            auto const guard = (renderFrames * 2) + (mSamplerate * GUARD_MS / 1000);
+            if (mMinHeadroom > guard) {
+                auto const shrink = std::min((mMinHeadroom - guard) / 2, mTarget / 8);
+                mTarget = std::max(mMinTarget, mTarget - shrink);
+            }
+        }
+        startWindow(now, WINDOW);
+    }
+
+    return mTarget;
+}
+
+void LatencyController::startWindow(Clock::time_point now, Clock::duration length) {
+    mWindowEnd = now + length;
+    mMinHeadroom = NO_HEADROOM;
+    mWorstRender = Clock::duration(0);
+}
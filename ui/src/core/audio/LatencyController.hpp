@@ -0,0 +1,65 @@
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+//
+// Adjusts the fill target of the playback buffer at runtime, so that
+// playback settles on the lowest latency that does not underrun on the
+// current machine. The buffer itself is never resized, only how much of it
+// the renderer keeps filled.
+//
+// Whenever an underrun occurs, the target grows by half and is then held
+// for a while. Otherwise the controller tracks the lowest headroom seen over
+// a window, which is the number of frames left in the buffer after a device
+// read. At the end of each window, the target shrinks by part of the unused
+// headroom. A guard is kept based on the slowest render seen, so a machine
+// with slow renders keeps more buffered.
+//
+class LatencyController {
+
+public:
+    using Clock = std::chrono::steady_clock;
+
+    LatencyController();
+
+    //
+    // Sets the range of the target in frames, the target starts at the
+    // maximum. Must be called when the buffer size or samplerate changes.
+    //
+    void reset(size_t minTarget, size_t maxTarget, unsigned samplerate);
+
+    //
+    // Starts a new window, keeping the current target. Call when a render
+    // starts so that time spent stopped is not counted.
+    //
+    void restart(Clock::time_point now, int underruns);
+
+    size_t target() const noexcept;
+
+    //
+    // Updates the controller, call once per render. underruns is the
+    // stream's underrun count, headroom is the lowest number of frames left
+    // in the buffer after a device read since the last update (SIZE_MAX if
+    // the device hasn't read) and renderTime is the duration of the last
+    // render. Returns the new target.
+    //
+    size_t update(Clock::time_point now, int underruns, size_t headroom, Clock::duration renderTime);
+
+private:
+
+    void startWindow(Clock::time_point now, Clock::duration length);
+
+    size_t mMinTarget;
+    size_t mMaxTarget;
+    size_t mTarget;
+    unsigned mSamplerate;
+
+    int mUnderruns;
+
+    Clock::time_point mWindowEnd;
+    size_t mMinHeadroom;
+    Clock::duration mWorstRender;
+
+};
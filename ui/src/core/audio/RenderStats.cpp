@@ -0,0 +1,125 @@
+
+#include "core/audio/RenderStats.hpp"
+
+#include <algorithm>
+
+namespace {
+
+// weight of the newest call in the moving average
+constexpr float LOAD_SMOOTHING = 0.1f;
+
+void storeMax(std::atomic<RenderStats::Clock::rep> &peak, RenderStats::Clock::rep value) {
+    // only the render thread stores peaks, so no CAS loop is needed
+    if (value > peak.load(std::memory_order_relaxed)) {
+        peak.store(value, std::memory_order_relaxed);
+    }
+}
+
+}
+
+RenderStats::RenderStats() :
+    mCurrent(),
+    mHistory(),
+    mHistoryIndex(0),
+    mHistoryCount(0),
+    mLoad(0.0f),
+    mLast(),
+    mPeak(),
+    mTotalLast(0),
+    mTotalPeak(0),
+    mLoadAverage(0),
+    mLoadPeak(0),
+    mHistogram(),
+    mClearRequested(false)
+{
+    reset();
+}
+
+void RenderStats::begin() noexcept {
+    mCurrent.fill(Clock::duration(0));
+}
+
+void RenderStats::add(Stage stage, Clock::duration time) noexcept {
+    mCurrent[(size_t)stage] += time;
+}
+
+void RenderStats::end(Clock::duration renderTime, Clock::duration period) noexcept {
+    if (mClearRequested.exchange(false, std::memory_order_relaxed)) {
+        reset();
+    }
+
+    for (size_t i = 0; i < STAGES; ++i) {
+        auto const time = mCurrent[i].count();
+        mLast[i].store(time, std::memory_order_relaxed);
+        storeMax(mPeak[i], time);
+    }
+    mTotalLast.store(renderTime.count(), std::memory_order_relaxed);
+    storeMax(mTotalPeak, renderTime.count());
+
+    if (period.count() <= 0) {
+        // nothing was rendered
+        return;
+    }
+
+    float const load = std::chrono::duration<float>(renderTime).count()
+                     / std::chrono::duration<float>(period).count();
+    mLoad += (load - mLoad) * LOAD_SMOOTHING;
+    mLoadAverage.store((unsigned)(mLoad * 1000.0f), std::memory_order_relaxed);
+    auto const loadPermille = (unsigned)(load * 1000.0f);
+    if (loadPermille > mLoadPeak.load(std::memory_order_relaxed)) {
+        mLoadPeak.store(loadPermille, std::memory_order_relaxed);
+    }
+
+    // rolling histogram, evict the oldest call once the history is full
+    auto const bin = (uint8_t)std::min(loadPermille / 100, (unsigned)HISTOGRAM_BINS - 1);
+    if (mHistoryCount == HISTORY) {
+        mHistogram[mHistory[mHistoryIndex]].fetch_sub(1, std::memory_order_relaxed);
+    } else {
+        ++mHistoryCount;
+    }
+    mHistory[mHistoryIndex] = bin;
+    mHistogram[bin].fetch_add(1, std::memory_order_relaxed);
+    mHistoryIndex = (mHistoryIndex + 1) % HISTORY;
+}
+
+RenderStats::Snapshot RenderStats::snapshot() const noexcept {
+    Snapshot snap;
+    for (size_t i = 0; i < STAGES; ++i) {
+        snap.stages[i] = {
+            Clock::duration(mLast[i].load(std::memory_order_relaxed)),
+            Clock::duration(mPeak[i].load(std::memory_order_relaxed))
+        };
+    }
+    snap.total = {
+        Clock::duration(mTotalLast.load(std::memory_order_relaxed)),
+        Clock::duration(mTotalPeak.load(std::memory_order_relaxed))
+    };
+    snap.load = mLoadAverage.load(std::memory_order_relaxed) / 1000.0f;
+    snap.peakLoad = mLoadPeak.load(std::memory_order_relaxed) / 1000.0f;
+    for (size_t i = 0; i < HISTOGRAM_BINS; ++i) {
+        snap.histogram[i] = mHistogram[i].load(std::memory_order_relaxed);
+    }
+    return snap;
+}
+
+void RenderStats::clear() noexcept {
+    mClearRequested.store(true, std::memory_order_relaxed);
+}
+
+void RenderStats::reset() noexcept {
+    mCurrent.fill(Clock::duration(0));
+    mHistoryIndex = 0;
+    mHistoryCount = 0;
+    mLoad = 0.0f;
+    for (size_t i = 0; i < STAGES; ++i) {
+        mLast[i].store(0, std::memory_order_relaxed);
+        mPeak[i].store(0, std::memory_order_relaxed);
+    }
+    mTotalLast.store(0, std::memory_order_relaxed);
+    mTotalPeak.store(0, std::memory_order_relaxed);
+    mLoadAverage.store(0, std::memory_order_relaxed);
+    mLoadPeak.store(0, std::memory_order_relaxed);
+    for (auto &count : mHistogram) {
+        count.store(0, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,112 @@
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+//
+// Timing statistics for Renderer::render. The render thread times each stage
+// of a render call and publishes the results with atomics at the end of the
+// call, so that the GUI thread can read them at any time without locking.
+//
+// Besides the per-stage times, the DSP load of each call is kept as a moving
+// average and as a histogram of the last HISTORY calls. The load is the time
+// spent rendering relative to the period of audio that was rendered, so a
+// load of 100% or more means the renderer cannot keep up with playback.
+//
+class RenderStats {
+
+public:
+
+    using Clock = std::chrono::steady_clock;
+
+    enum class Stage {
+        engine,         // stepping the engine
+        preview,        // stepping the instrument preview
+        synth,          // flushing register writes and running the synth
+        copy,           // reading samples into the playback buffer
+        visualizer,     // copying samples to the visualizer buffer
+        lockWait        // waiting on the render mutex before rendering
+    };
+
+    static constexpr int STAGES = 6;
+
+    // each bin is 10% load, the last bin is 100% or more
+    static constexpr int HISTOGRAM_BINS = 11;
+
+    // number of render calls in the histogram
+    static constexpr size_t HISTORY = 256;
+
+    struct Timing {
+        // time spent in the last render call
+        Clock::duration last;
+        // longest time spent in a single call since the last clear
+        Clock::duration peak;
+    };
+
+    struct Snapshot {
+        std::array<Timing, STAGES> stages;
+        Timing total;
+        // moving average of the load, 1.0 is 100%
+        float load;
+        float peakLoad;
+        std::array<unsigned, HISTOGRAM_BINS> histogram;
+    };
+
+    RenderStats();
+
+    // render thread -------------------------------------------------------
+
+    //
+    // Starts timing a render call
+    //
+    void begin() noexcept;
+
+    //
+    // Adds time spent in the given stage to the current call
+    //
+    void add(Stage stage, Clock::duration time) noexcept;
+
+    //
+    // Finishes the current call and publishes its timings. period is the
+    // duration of the audio rendered by the call.
+    //
+    void end(Clock::duration renderTime, Clock::duration period) noexcept;
+
+    // any thread ----------------------------------------------------------
+
+    Snapshot snapshot() const noexcept;
+
+    //
+    // Requests the peaks and histogram to be cleared, which is done by the
+    // render thread at the end of its next call.
+    //
+    void clear() noexcept;
+
+private:
+
+    void reset() noexcept;
+
+    std::array<Clock::duration, STAGES> mCurrent;
+
+    // render thread's copy of the history, as histogram bins
+    std::array<uint8_t, HISTORY> mHistory;
+    size_t mHistoryIndex;
+    size_t mHistoryCount;
+    float mLoad;
+
+    std::array<std::atomic<Clock::rep>, STAGES> mLast;
+    std::array<std::atomic<Clock::rep>, STAGES> mPeak;
+    std::atomic<Clock::rep> mTotalLast;
+    std::atomic<Clock::rep> mTotalPeak;
+    // loads are stored in permille
+    std::atomic<unsigned> mLoadAverage;
+    std::atomic<unsigned> mLoadPeak;
+    std::array<std::atomic<unsigned>, HISTOGRAM_BINS> mHistogram;
+
+    std::atomic_bool mClearRequested;
+
+};
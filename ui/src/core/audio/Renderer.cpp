@@ -1,4 +1,3 @@
-
 #include "core/audio/Renderer.hpp"
 #include "core/samplerates.hpp"
 
@@ -6,6 +5,10 @@
 
 #include <QMutexLocker>
 
+#include <algorithm>
+#include <limits>
+#include <utility>
+
 //static auto LOG_PREFIX = "[Renderer]";
 
 
@@ -13,32 +16,170 @@
 //
 // This class is reponsible for rendering audio in real time. The Renderer synthesizes
 // audio for playback which is then played out to speakers via the audio callback function.
-// Synthesized audio is put into an AudioStream's ringbuffer. This buffer is filled
-// completely every period, which is by default 5 ms. The audio callback takes what it
-// needs from the buffer. Ideally, the buffer is always at 100% utilization. A lower
-// utilization indicates that the callback is consuming faster than the rate the
-// audio is being produced. When this happens underruns occur, as the callback doesn't
-// get what it needs and there are now gaps in the playback.
+// Synthesized audio is put into an AudioStream's ringbuffer and the audio callback takes
+// what it needs from the buffer. When the callback doesn't get what it needs, underruns
+// occur and there are gaps in the playback.
+//
+// What calls render() depends on the render mode (SoundConfig::RenderMode):
+//  * timer: a FastTimer fills the buffer completely every period (default 5 ms).
+//    Timer jitter must be covered by the buffer size.
+//  * thread: the audio callback wakes a dedicated render thread when the buffer
+//    drops below a low-water mark (half the buffer). No polling interval.
+//  * callback: the audio callback renders just what it is about to read. The
+//    buffer only holds the remainder of the last synthesized frame. If the
+//    render keeps taking more than its share of the device period, the renderer
+//    falls back to the thread mode until the config is applied again.
+//
+// With adaptive latency (timer and thread modes), the renderer fills the buffer up
+// to a target instead of completely. A LatencyController grows the target on
+// underruns and shrinks it while the device never gets close to draining the buffer,
+// so the configured latency becomes the maximum.
+//
+// Threading
+//
+// The RenderContext has a single owner at any time. While the render is running,
+// the driver (timer thread, render thread or audio callback) owns it and the GUI
+// thread sends it commands through a wait-free queue. These commands are executed at
+// the start of each frame. When the render is stopped, the GUI thread owns the
+// context and executes commands immediately. Ownership is transferred with
+// mLifecycleMutex locked: the GUI marks the render as stopped and then locks
+// mRenderMutex, which a driver holds for the entire render() call, so any render in
+// progress has finished when the GUI takes the context.
+//
+// The render thread publishes the current frame and diagnostics via atomics.
+// Drivers never emit signals or post events (which allocate and lock the
+// receiver's event queue). The GUI thread polls the published state on a timer
+// while rendering instead, see poll().
+//
+// The render thread never locks the module. After each edit, the GUI thread
+// makes an immutable snapshot of the module (see Module::Snapshot) and sends it
+// as a command. Only one snapshot is queued at a time, edits made while it is
+// in flight are sent as a single newer snapshot by poll(). The engine is
+// rebound to the new snapshot between frames and the old one is sent back
+// through mRetiredSnapshots so that freeing it does not happen on the render
+// thread. If the GUI is behind on collecting, the old snapshot stays in the
+// context and is sent again on the next frame.
+//
+// Since commands are executed in order, the driver always has the snapshot the
+// GUI thread last sent when it executes a command. The GUI resolves anything a
+// command needs from that snapshot, so that drivers do no lookups, reference
+// counting or other unbounded work. Playing from the middle of a song requires
+// playing the song from the start to restore its state: the GUI seeks with its
+// own CheckpointCache and the play command carries the seeked runtime. The
+// instrument preview command carries the instrument to preview.
+//
+
+namespace {
+
+// lowest fill target adaptive latency may settle on, in milliseconds
+constexpr int MIN_AUTO_LATENCY = 5;
+
+// interval of the GUI poll timer, in milliseconds
+constexpr int POLL_INTERVAL = 10;
+
+// in callback mode, a render may take up to 1/CALLBACK_BUDGET of the device
+// period. After CALLBACK_OVER_BUDGET consecutive renders over it, rendering is
+// moved to the render thread.
+constexpr int CALLBACK_BUDGET = 2;
+constexpr int CALLBACK_OVER_BUDGET = 8;
+
+// The current frame is packed into a single word so that it can be published
+// atomically.
+// bits 0-31: time
+// bits 32-39: order
+// bits 40-47: row
+// bits 48-55: speed
+// bit 56: halted
+// bit 57: startedNewRow
+// bit 58: startedNewPattern
+
+uint64_t packFrame(trackerboy::Frame const& frame) {
+    return (uint64_t)(uint32_t)frame.time |
+           ((uint64_t)(uint8_t)frame.order << 32) |
+           ((uint64_t)(uint8_t)frame.row << 40) |
+           ((uint64_t)frame.speed << 48) |
+           ((uint64_t)frame.halted << 56) |
+           ((uint64_t)frame.startedNewRow << 57) |
+           ((uint64_t)frame.startedNewPattern << 58);
+}
 
+trackerboy::Frame unpackFrame(uint64_t bits) {
+    trackerboy::Frame frame;
+    frame.time = (int)(uint32_t)bits;
+    frame.order = (uint8_t)(bits >> 32);
+    frame.row = (uint8_t)(bits >> 40);
+    frame.speed = (trackerboy::Speed)(bits >> 48);
+    frame.halted = !!(bits & ((uint64_t)1 << 56));
+    frame.startedNewRow = !!(bits & ((uint64_t)1 << 57));
+    frame.startedNewPattern = !!(bits & ((uint64_t)1 << 58));
+    return frame;
+}
+
+}
+
+
+Renderer::Command::Command(Type type, int arg1, int arg2, int arg3) :
+    type(type),
+    arg1(arg1),
+    arg2(arg2),
+    arg3(arg3),
+    snapshot(),
+    runtime(),
+    instrument(nullptr)
+{
+}
+
+Renderer::Command::Command(Command &&cmd) noexcept :
+    type(cmd.type),
+    arg1(cmd.arg1),
+    arg2(cmd.arg2),
+    arg3(cmd.arg3),
+    snapshot(std::move(cmd.snapshot)),
+    runtime(std::move(cmd.runtime)),
+    instrument(cmd.instrument)
+{
+}
+
+Renderer::Command& Renderer::Command::operator=(Command &&cmd) noexcept {
+    type = cmd.type;
+    arg1 = cmd.arg1;
+    arg2 = cmd.arg2;
+    arg3 = cmd.arg3;
+    snapshot = std::move(cmd.snapshot);
+    instrument = cmd.instrument;
+    runtime.reset();
+    if (cmd.runtime) {
+        runtime.emplace(*cmd.runtime);
+        cmd.runtime.reset();
+    }
+    return *this;
+}
 
 Renderer::RenderContext::RenderContext(Module &mod) :
     mod(mod),
     stepping(false),
     step(false),
-    song(nullptr),
+    snapshot(),
+    retired(),
     synth(44100),
-    apu(synth.apu()),
+    synthApu(synth.apu()),
+    apu(synthApu),
+    previewRc(),
     engine(apu, &mod.data()),
     ip(),
     previewState(PreviewState::none),
     previewChannel(trackerboy::ChType::ch1),
-    state(State::stopped),
+    previewInstrument(-1),
+    previewNote(0),
+    previewWave(trackerboy::ChType::ch3),
     stopCounter(0),
     bufferSize(0),
+    autoLatency(false),
+    latency(),
+    lastRenderTime(0),
+    overBudget(0),
     watchdog(),
-    lastPeriod(),
-    periodTime(0),
-    writesSinceLastPeriod(0)
+    lastPeriod()
 {
 }
 
@@ -48,28 +189,63 @@ Renderer::Renderer(Module &mod, QObject *parent) :
     QObject(parent),
     mTimerThread(),
     mTimer(new FastTimer),
+    mRenderThread(wakeCallback, this),
+    mPollTimer(),
+    mRenderMutex(),
+    mRenderMode(SoundConfig::RenderMode::thread),
+    mLowWater(0),
+    mFillTarget(0),
+    mHeadroom(std::numeric_limits<size_t>::max()),
+    mStats(),
     mStream(),
     mVisBuffer(),
-    mContext(mod)
+    mContext(mod),
+    mCommands(),
+    mRetiredSnapshots(),
+    mLifecycleMutex(),
+    mState(State::stopped),
+    mSnapshotInFlight(false),
+    mFrame(packFrame(trackerboy::Frame())),
+    mFinishRequest(FinishRequest::none),
+    mWritesSinceLastPeriod(0),
+    mPeriodTime(0),
+    mStepping(false),
+    mPolledFrame(mFrame.load()),
+    mSnapshotPending(false),
+    mSentSnapshot(),
+    mCheckpoints()
 {
     mTimer->setCallback(timerCallback, this);
     mTimer->moveToThread(&mTimerThread);
     connect(&mTimerThread, &QThread::finished, mTimer, &FastTimer::deleteLater);
     mTimerThread.setObjectName(QStringLiteral("renderer timer thread"));
     mTimerThread.start();
+    mRenderThread.setObjectName(QStringLiteral("renderer thread"));
+    mRenderThread.start(QThread::TimeCriticalPriority);
+
+    mPollTimer.setInterval(POLL_INTERVAL);
+    connect(&mPollTimer, &QTimer::timeout, this, &Renderer::poll);
+
+    mStream.setPullCallback(pullCallback, this);
 
     connect(&mStream, &AudioStream::aborted, this,
         [this]() {
-            auto handle = mContext.access();
-            stopRender(handle, true);
+            stopRender(true);
         });
 
     connect(&mod, &Module::songChanged, this, &Renderer::setSong);
+    connect(&mod, &Module::edited, this, &Renderer::updateSnapshot);
     setSong();
 }
 
 Renderer::~Renderer() {
+    mState = State::stopped;
+    {
+        // wait for a render in progress
+        QMutexLocker locker(&mRenderMutex);
+    }
     mTimer->stop();
+    mRenderThread.stop();
 
     if (mStream.isRunning()) {
         mStream.stop();
@@ -80,27 +256,44 @@ Renderer::~Renderer() {
 }
 
 void Renderer::setSong() {
-    auto ctx = mContext.access();
-    ctx->song = ctx->mod.songShared();
-    ctx->engine.setSong(ctx->song.get());
+    // play below must use the new song, so this one cannot wait
+    sendSnapshot();
 
     // if we are playing, restart playback from the start with the new song
     // if we are stepping, stop playback
 
     if (mStream.isRunning()) {
-        if (ctx->stepping) {
-            _stopMusic(ctx);
+        if (mStepping) {
+            stopMusic();
         } else {
-            _play(ctx, 0, 0, false);
+            play(0, 0, false);
         }
     }
 }
 
-Renderer::Diagnostics Renderer::diagnostics() {
-    auto handle = mContext.access();
+void Renderer::updateSnapshot() {
+    if (mSnapshotInFlight.load(std::memory_order_acquire)) {
+        // only the latest snapshot matters, poll() sends it once the driver
+        // has taken the one in flight
+        mSnapshotPending = true;
+    } else {
+        sendSnapshot();
+    }
+}
+
+void Renderer::sendSnapshot() {
+    mSnapshotPending = false;
+    // the driver also holds this snapshot, keeping a reference here means the
+    // last one is always released by the GUI thread
+    mSentSnapshot = mContext.mod.snapshot();
+    mCheckpoints.invalidate();
+    Command cmd(Command::Type::setSnapshot);
+    cmd.snapshot = mSentSnapshot;
+    sendCommand(std::move(cmd));
+}
 
+Renderer::Diagnostics Renderer::diagnostics() {
     auto size = mStream.bufferSize();
-    // it is safe to access the writer since we have acquired access to context
     auto usage = size - mStream.writer().availableWrite();
 
 
@@ -108,13 +301,15 @@ Renderer::Diagnostics Renderer::diagnostics() {
         mStream.underruns(),
         usage,
         size,
-        handle->writesSinceLastPeriod,
-        handle->periodTime,
-        mStream.elapsed()
+        mWritesSinceLastPeriod.load(std::memory_order_relaxed),
+        Clock::duration(mPeriodTime.load(std::memory_order_relaxed)),
+        mStream.elapsed(),
+        mFillTarget.load(std::memory_order_relaxed),
+        mStats.snapshot()
     };
 }
 
-Guarded<VisualizerBuffer>& Renderer::visualizerBuffer() {
+VisualizerBuffer& Renderer::visualizerBuffer() {
     return mVisBuffer;
 }
 
@@ -123,16 +318,15 @@ bool Renderer::isRunning() {
 }
 
 bool Renderer::isStepping() {
-    return mContext.access()->stepping;
+    return mStepping;
 }
 
 bool Renderer::isPlaying() {
-    return !mContext.access()->currentEngineFrame.halted;
+    return !currentFrame().halted;
 }
 
 trackerboy::Frame Renderer::currentFrame() {
-    auto handle = mContext.access();
-    return handle->currentEngineFrame;
+    return unpackFrame(mFrame.load(std::memory_order_acquire));
 }
 
 bool Renderer::setConfig(SoundConfig const &soundConfig) {
@@ -141,97 +335,226 @@ bool Renderer::setConfig(SoundConfig const &soundConfig) {
     // resume with a slight gap in playback if the config applied without error,
     // otherwise the render is stopped
 
+    QMutexLocker locker(&mLifecycleMutex);
 
     bool wasRunning = mStream.isRunning();
-    if (wasRunning) {
-        mTimer->stop();
-    }
+    // stop the render thread, we now have access to the context
+    takeContext();
 
     mStream.setConfig(soundConfig);
 
     if (mStream.isEnabled()) {
 
         mTimer->setInterval(soundConfig.period(), Qt::PreciseTimer);
-        
+        mRenderMode = soundConfig.renderMode();
+        mFillTarget = mStream.bufferSize();
+        mLowWater = mStream.bufferSize() / 2;
 
-        // update the synthesizer (the guard isn't necessary here but we'll use it anyways)
-        {
-            auto handle = mContext.access();
-            
-            bool reloadRegisters = false;
-            auto const samplerate = soundConfig.samplerate();
-            if (samplerate != handle->synth.samplerate()) {
-                handle->synth.setSamplerate(samplerate);
-                reloadRegisters = wasRunning;
-            }
-            handle->synth.apu().setQuality(static_cast<gbapu::Apu::Quality>(soundConfig.quality()));
-            handle->synth.setupBuffers();
 
-            if (reloadRegisters) {
-                // resizing the buffers in synth results in an APU reset so we need to
+        // update the synthesizer
+        bool resized = false;
+        auto const samplerate = soundConfig.samplerate();
+        if (samplerate != mContext.synth.samplerate()) {
+            mContext.synth.setSamplerate(samplerate);
+            resized = true;
+        }
+        mContext.synth.apu().setQuality(static_cast<gbapu::Apu::Quality>(soundConfig.quality()));
+        mContext.synth.setupBuffers();
+
+        if (resized) {
+            // resizing the buffers in synth results in an APU reset, so
+            // the shadow registers are no longer valid
+            mContext.apu.reset();
+            if (wasRunning) {
                 // rewrite channel registers
-                handle->engine.reload();
+                mContext.engine.reload();
             }
+        }
 
-            handle->bufferSize = mStream.bufferSize();
-
-
-            mVisBuffer.access()->resize(handle->synth.framesize());
-
+        mContext.bufferSize = mStream.bufferSize();
+        // the callback mode renders on demand, it has no fill target to adapt
+        mContext.autoLatency = soundConfig.autoLatency()
+            && soundConfig.renderMode() != SoundConfig::RenderMode::callback;
+        mContext.latency.reset(
+            samplerate * MIN_AUTO_LATENCY / 1000,
+            mContext.bufferSize,
+            (unsigned)samplerate
+        );
 
 
-        }
+        mVisBuffer.resize(mContext.synth.framesize());
 
         if (wasRunning && mStream.isRunning()) {
-            mTimer->start();
+            // give the context back to the render thread
+            mContext.lastPeriod = Clock::now();
+            mContext.watchdog = mContext.lastPeriod;
+            mState = State::running;
+            startDriver();
         }
 
         return true;
 
     } else {
         // something went wrong
-        mContext.access()->state = State::stopped;
         return false;
     }
 }
 
-void Renderer::beginRender(Handle &handle) {
-    if (handle->state == State::stopped) {
+bool Renderer::startRender() {
+    mContext.lastPeriod = Clock::now();
+    mContext.watchdog = mContext.lastPeriod;
+    mContext.stopCounter = 0;
+    // keep the target learned from the last render, the machine is the same
+    mContext.latency.restart(mContext.lastPeriod, mStream.underruns());
+    mContext.lastRenderTime = Clock::duration(0);
+    mContext.overBudget = 0;
+    mHeadroom = std::numeric_limits<size_t>::max();
+    mFinishRequest = FinishRequest::none;
+
+    if (!mStream.isRunning()) {
+        // discard anything left over from the last render
+        mStream.resetBuffer();
+    }
 
-        bool success = mStream.start();
+    mState = State::running;
 
-        if (success) {
-            handle->lastPeriod = Clock::now();
-            handle->watchdog = handle->lastPeriod;
+    if (mRenderMode.load() != SoundConfig::RenderMode::callback) {
+        // prime the buffer now, so that the device plays audio from its first
+        // callback instead of waiting for the driver. The callback mode
+        // renders on demand so it has nothing to prime.
+        renderLocked();
+    }
+
+    if (!mStream.start()) {
+        mState = State::stopped;
+        return false;
+    }
+
+    startDriver();
+    return true;
+}
+
+void Renderer::takeContext() {
+    if (mState != State::stopped) {
+        mState = State::stopped;
+        // blocks until the current render call has finished, any render
+        // after this will see that we are stopped
+        mRenderMutex.lock();
+        mRenderMutex.unlock();
+    }
+    stopDriver();
+    // make room for the snapshots the driver (or we) retire
+    collectSnapshots();
+    // apply anything the driver didn't get to
+    drainCommands();
+    if (mContext.retired) {
+        retireSnapshot();
+    }
+}
+
+void Renderer::startDriver() {
+    switch (mRenderMode.load()) {
+        case SoundConfig::RenderMode::timer:
             mTimer->start();
-            handle.unlock();
-            emit audioStarted();
-            handle.relock();
-        } else {
-            // unable to start, an error occurred
-            handle.unlock();
-            emit audioError();
+            break;
+        case SoundConfig::RenderMode::thread:
+            // fill the buffer now instead of waiting for the device
+            mRenderThread.wake();
+            break;
+        case SoundConfig::RenderMode::callback:
+            // the device drives the render, nothing to start
+            break;
+    }
+}
+
+void Renderer::stopDriver() {
+    // the render thread and audio callback do nothing when stopped, only the
+    // timer needs to be stopped
+    mTimer->stop();
+}
+
+void Renderer::finishRender(bool aborted) {
+    // driver thread, the GUI thread may be waiting on us to finish rendering
+    // while holding the mutex so we cannot block here
+    if (!mLifecycleMutex.tryLock()) {
+        return;
+    }
+
+    if (!mCommands.isEmpty()) {
+        // the GUI thread has sent us more work
+        mLifecycleMutex.unlock();
+        return;
+    }
+
+    mState = State::stopped;
+    mLifecycleMutex.unlock();
+
+    // the device cannot be stopped from its own callback, let the GUI thread
+    // do it when it next polls
+    mFinishRequest.store(aborted ? FinishRequest::aborted : FinishRequest::finished, std::memory_order_release);
+}
+
+void Renderer::streamFinished(bool aborted) {
+    bool success;
+    {
+        QMutexLocker locker(&mLifecycleMutex);
+        if (mState != State::stopped || !mStream.isRunning()) {
+            // restarted or already stopped by the GUI
             return;
         }
-
+        // the driver has stopped, this just cleans up after it
+        takeContext();
+        success = mStream.stop();
     }
 
-    // reset state to running
-    handle->state = State::running;
-    handle->stopCounter = 0;
+    renderStopped(success, aborted);
 }
 
-void Renderer::stopRender(Handle &handle, bool aborted) {
+void Renderer::poll() {
+    collectSnapshots();
 
-    handle->state = State::stopped;
-    
-    mTimer->stop();
+    auto const bits = mFrame.load(std::memory_order_acquire);
+    if (bits != mPolledFrame) {
+        auto const wasHalted = unpackFrame(mPolledFrame).halted;
+        mPolledFrame = bits;
+        auto const halted = unpackFrame(bits).halted;
+        if (halted != wasHalted) {
+            emit isPlayingChanged(!halted);
+        }
+        emit frameSync();
+    }
 
-    auto success = mStream.stop();
+    if (mVisBuffer.hasNewData()) {
+        emit updateVisualizers();
+    }
 
-    handle.unlock();
+    if (mSnapshotPending) {
+        updateSnapshot();
+    }
 
-    mVisBuffer.access()->clear();
+    auto const request = mFinishRequest.exchange(FinishRequest::none, std::memory_order_acquire);
+    if (request != FinishRequest::none) {
+        streamFinished(request == FinishRequest::aborted);
+    }
+}
+
+void Renderer::stopRender(bool aborted) {
+    bool success;
+    {
+        QMutexLocker locker(&mLifecycleMutex);
+        takeContext();
+        success = mStream.stop();
+    }
+
+    renderStopped(success, aborted);
+}
+
+void Renderer::renderStopped(bool success, bool aborted) {
+    mPollTimer.stop();
+    // pick up the last frame published by the driver
+    poll();
+
+    mVisBuffer.clear();
     emit updateVisualizers();
 
     if (aborted) {
@@ -246,219 +569,474 @@ void Renderer::stopRender(Handle &handle, bool aborted) {
     }
 }
 
+void Renderer::sendCommand(Command &&cmd, bool start) {
+    collectSnapshots();
+
+    bool started = false;
+    bool startFailed = false;
+
+    {
+        QMutexLocker locker(&mLifecycleMutex);
+        if (mState == State::stopped) {
+            // the render thread is not running, we own the context
+            execute(cmd);
+            if (start) {
+                started = startRender();
+                startFailed = !started;
+            }
+        } else {
+            auto const isSnapshot = cmd.type == Command::Type::setSnapshot;
+            bool queued = false;
+            if (!isSnapshot || !mSnapshotInFlight.load(std::memory_order_acquire)) {
+                if (isSnapshot) {
+                    // set before pushing, the driver clears it after executing
+                    mSnapshotInFlight.store(true, std::memory_order_relaxed);
+                }
+                queued = mCommands.push(std::move(cmd));
+                if (!queued && isSnapshot) {
+                    mSnapshotInFlight.store(false, std::memory_order_relaxed);
+                }
+            }
+
+            if (!queued) {
+                // Waiting for the driver to make room could hang if it has
+                // stalled (ie the device stopped pulling). Instead, wait for
+                // the render call in progress (if any) to finish and run the
+                // commands here. Drivers only touch the context while holding
+                // mRenderMutex, so it is ours while locked.
+                QMutexLocker renderLocker(&mRenderMutex);
+                drainCommands();
+                execute(cmd);
+            }
+        }
+    }
+
+    // always emit signals with the mutex unlocked
+    if (started) {
+        mPollTimer.start();
+        emit audioStarted();
+    } else if (startFailed) {
+        emit audioError();
+    }
+}
+
+void Renderer::collectSnapshots() {
+    std::shared_ptr<Module::Snapshot const> snapshot;
+    while (mRetiredSnapshots.pop(snapshot)) {
+        snapshot.reset();
+    }
+}
+
+void Renderer::drainCommands() {
+    Command cmd;
+    while (mCommands.pop(cmd)) {
+        execute(cmd);
+    }
+}
+
+void Renderer::execute(Command &cmd) {
+    auto &ctx = mContext;
+
+    switch (cmd.type) {
+        case Command::Type::play:
+            _play(*cmd.runtime, cmd.arg3 != 0);
+            resume();
+            break;
+        case Command::Type::stepNextFrame:
+            if (ctx.stepping) {
+                ctx.step = true;
+            }
+            break;
+        case Command::Type::stepOut:
+            ctx.stepping = false;
+            break;
+        case Command::Type::jumpToPattern:
+            ctx.engine.jump(cmd.arg1);
+            break;
+        case Command::Type::setPatternRepeat:
+            ctx.engine.repeatPattern(cmd.arg1 != 0);
+            break;
+        case Command::Type::setPreviewNote: {
+            auto note = cmd.arg1;
+            switch (ctx.previewState) {
+                case PreviewState::waveform: {
+                    if (note > trackerboy::NOTE_LAST) {
+                        // should never happen, but clamp just in case
+                        note = trackerboy::NOTE_LAST;
+                    }
+                    auto freq = trackerboy::NOTE_FREQ_TABLE[note];
+                    ctx.previewWave.frequency = freq;
+                    ctx.apu.writeRegister(gbapu::Apu::REG_NR33, (uint8_t)(freq & 0xFF));
+                    ctx.apu.writeRegister(gbapu::Apu::REG_NR34, (uint8_t)(freq >> 8));
+                    break;
+                }
+                case PreviewState::instrument:
+                    // update the current note
+                    ctx.previewNote = (uint8_t)note;
+                    ctx.ip.play(ctx.previewNote);
+                    break;
+                default:
+                    break;
+
+            }
+            break;
+        }
+        case Command::Type::instrumentPreview: {
+            if (ctx.previewState != PreviewState::none) {
+                resetPreview();
+            }
+
+            auto const instrument = cmd.instrument;
+            auto const track = cmd.arg2;
+            if (track == -1) {
+                // instrument preview
+                if (instrument == nullptr) {
+                    // removed before the command was executed
+                    break;
+                }
+                ctx.previewChannel = instrument->channel();
+            } else {
+                // note preview
+                ctx.previewChannel = static_cast<trackerboy::ChType>(track);
+            }
+
+            ctx.previewInstrument = instrument ? cmd.arg3 : -1;
+            ctx.ip.setInstrument(instrument, ctx.previewChannel);
+
+            ctx.previewState = PreviewState::instrument;
+            // unlock the channel for preview
+            ctx.engine.unlock(ctx.previewChannel);
+            ctx.previewNote = (uint8_t)cmd.arg1;
+            ctx.ip.play(ctx.previewNote);
+            resume();
+            break;
+        }
+        case Command::Type::waveformPreview: {
+            if (ctx.previewState != PreviewState::none) {
+                resetPreview();
+            }
+
+            ctx.previewState = PreviewState::waveform;
+            ctx.previewChannel = trackerboy::ChType::ch3;
+            // unlock the channel, no longer effected by music
+            ctx.engine.unlock(trackerboy::ChType::ch3);
+
+            auto &state = ctx.previewWave;
+            state = trackerboy::ChannelState(trackerboy::ChType::ch3);
+            state.playing = true;
+            state.frequency = trackerboy::NOTE_FREQ_TABLE[cmd.arg1];
+            state.envelope = (uint8_t)cmd.arg2;
+            // wave RAM was last written by the music
+            ctx.previewRc->waveram.invalidate();
+            trackerboy::ChannelControl<trackerboy::ChType::ch3>::init(
+                ctx.apu, *ctx.snapshot->waveformTable, ctx.previewRc->waveram, state
+            );
+            resume();
+            break;
+        }
+        case Command::Type::stopPreview:
+            if (ctx.previewState != PreviewState::none) {
+                resetPreview();
+            }
+            break;
+        case Command::Type::stopMusic:
+            _stopMusic();
+            break;
+        case Command::Type::setChannelOutput:
+            _setChannelOutput(ChannelOutput::Flags(QFlag(cmd.arg1)));
+            break;
+        case Command::Type::setSnapshot:
+            _setSnapshot(std::move(cmd.snapshot));
+            retireSnapshot();
+            break;
+    }
+}
+
+void Renderer::resume() {
+    // cancel the stop countdown
+    mContext.stopCounter = 0;
+    auto expected = State::stopping;
+    mState.compare_exchange_strong(expected, State::running);
+}
+
 
 
 // SLOTS
 
 void Renderer::clearDiagnostics() {
     mStream.resetUnderruns();
+    mStats.clear();
 }
 
 void Renderer::play(int pattern, int row, bool stepmode) {
 
     if (mStream.isEnabled()) {
-        auto handle = mContext.access();
-        _play(handle, pattern, row, stepmode);
+        auto const& song = *mSentSnapshot->song;
+        if (pattern < 0 || pattern >= (int)song.order().size() || row < 0 || row >= song.patterns().rowSize()) {
+            return;
+        }
+
+        mStepping = stepmode;
+        Command cmd(Command::Type::play, pattern, row, stepmode);
+        // seek here, the driver only has to copy the runtime. Rows that are
+        // never reached from the start of the song are played fresh.
+        if (pattern != 0 || row != 0) {
+            auto seeked = mCheckpoints.seek(
+                *mSentSnapshot->instrumentTable,
+                *mSentSnapshot->waveformTable,
+                song,
+                pattern,
+                row
+            );
+            if (seeked) {
+                cmd.runtime.emplace(*seeked);
+            }
+        }
+        if (!cmd.runtime) {
+            cmd.runtime.emplace(song, pattern, row);
+        }
+        sendCommand(std::move(cmd), true);
     }
 }
 
 
 void Renderer::stepNextFrame() {
-    
-    if (mStream.isEnabled()) {
-        auto handle = mContext.access();
-        if (handle->stepping) {
-            handle->step = true;
-        }
 
+    if (mStream.isEnabled() && mStepping) {
+        sendCommand(Command::Type::stepNextFrame);
     }
 }
 
 void Renderer::stepOut() {
     if (mStream.isEnabled()) {
-        mContext.access()->stepping = false;
+        mStepping = false;
+        sendCommand(Command::Type::stepOut);
     }
 }
 
 void Renderer::jumpToPattern(int pattern) {
     if (mStream.isEnabled()) {
-        auto ctx = mContext.access();
-        ctx->engine.jump(pattern);
+        sendCommand({ Command::Type::jumpToPattern, pattern });
     }
 }
 
 void Renderer::setPatternRepeat(bool repeat) {
 
     if (mStream.isEnabled()) {
-        mContext.access()->engine.repeatPattern(repeat);
+        sendCommand({ Command::Type::setPatternRepeat, repeat });
     }
 }
 
 void Renderer::setPreviewNote(int note) {
     if (mStream.isEnabled()) {
-        auto ctx = mContext.access();
-        switch (ctx->previewState) {
-            case PreviewState::waveform: {
-                if (note > trackerboy::NOTE_LAST) {
-                    // should never happen, but clamp just in case
-                    note = trackerboy::NOTE_LAST;
-                }
-                auto freq = trackerboy::NOTE_FREQ_TABLE[note];
-                ctx->apu.writeRegister(gbapu::Apu::REG_NR33, (uint8_t)(freq & 0xFF));
-                ctx->apu.writeRegister(gbapu::Apu::REG_NR34, (uint8_t)(freq >> 8));
-                break;
-            }
-            case PreviewState::instrument:
-                // update the current note
-                ctx->ip.play((uint8_t)note);
-                break;
-            default:
-                break;
-        
-        }
+        sendCommand({ Command::Type::setPreviewNote, note });
     }
 }
 
 void Renderer::instrumentPreview(int note, int track, int instrumentId) {
     if (mStream.isEnabled()) {
-        auto ctx = mContext.access();
-        switch (ctx->previewState) {
-            case PreviewState::instrument:
-            case PreviewState::waveform:
-                resetPreview(ctx);
-                [[fallthrough]];
-            case PreviewState::none: {
-                auto const& itable = ctx->mod.data().instrumentTable();
-                std::shared_ptr<trackerboy::Instrument> inst = nullptr;
-                if (instrumentId != -1) {
-                    inst = itable.getShared((uint8_t)instrumentId);
-                }
-
-                if (track == -1) {
-                    // instrument preview
-                    Q_ASSERT(inst != nullptr); // must have an instrument
-                    ctx->previewChannel = inst->channel();
-                } else {
-                    // note preview
-                    ctx->previewChannel = static_cast<trackerboy::ChType>(track);
-                }
-
-                ctx->ip.setInstrument(std::move(inst), ctx->previewChannel);
-
-                ctx->previewState = PreviewState::instrument;
-                // unlock the channel for preview
-                ctx->engine.unlock(ctx->previewChannel);
-                ctx->ip.play((uint8_t)note);
-                break;
-            }
+        Command cmd(Command::Type::instrumentPreview, note, track, instrumentId);
+        if (instrumentId != -1) {
+            // the driver will have this snapshot when it runs the command,
+            // which keeps the instrument alive
+            cmd.instrument = mSentSnapshot->instrumentTable->get((uint8_t)instrumentId);
         }
-        beginRender(ctx);
+        sendCommand(std::move(cmd), true);
     }
 }
 
 void Renderer::waveformPreview(int note, int waveId) {
     if (mStream.isEnabled()) {
-        auto ctx = mContext.access();
-        switch (ctx->previewState) {
-            case PreviewState::instrument:
-            case PreviewState::waveform:
-                resetPreview(ctx);
-                [[fallthrough]];
-            case PreviewState::none:
-                ctx->previewState = PreviewState::waveform;
-                ctx->previewChannel = trackerboy::ChType::ch3;
-                // unlock the channel, no longer effected by music
-                ctx->engine.unlock(trackerboy::ChType::ch3);
-
-                trackerboy::ChannelState state(trackerboy::ChType::ch3);
-                state.playing = true;
-                state.frequency = trackerboy::NOTE_FREQ_TABLE[note];
-                state.envelope = (uint8_t)waveId;
-                trackerboy::ChannelControl<trackerboy::ChType::ch3>::init(
-                    ctx->apu, ctx->mod.data().waveformTable(), state
-                );
-                break;
-        }
-        beginRender(ctx);
+        sendCommand({ Command::Type::waveformPreview, note, waveId }, true);
     }
 }
 
 void Renderer::stopPreview() {
 
     if (mStream.isEnabled()) {
-        auto handle = mContext.access();
-        if (handle->previewState != PreviewState::none) {
-            resetPreview(handle);
-        }
+        sendCommand(Command::Type::stopPreview);
     }
-    
+
 }
 
 void Renderer::stopMusic() {
-    
+
     if (mStream.isEnabled()) {
-        auto handle = mContext.access();
-        _stopMusic(handle);
+        mStepping = false;
+        sendCommand(Command::Type::stopMusic);
     }
 
 }
 
-void Renderer::_stopMusic(Handle &handle) {
-    handle->engine.halt();
-    handle->stepping = false;
+void Renderer::_stopMusic() {
+    mContext.engine.halt();
+    mContext.stepping = false;
 }
 
 void Renderer::forceStop() {
 
     if (mStream.isEnabled()) {
-        auto handle = mContext.access();
-        if (handle->state != State::stopped) {
-            resetPreview(handle);
-            handle->engine.halt();
-            handle->stepping = false;
-            stopRender(handle);
+        bool success;
+        {
+            QMutexLocker locker(&mLifecycleMutex);
+            if (mState == State::stopped) {
+                return;
+            }
+            takeContext();
+            if (mContext.previewState != PreviewState::none) {
+                resetPreview();
+            }
+            _stopMusic();
+            mStepping = false;
+            success = mStream.stop();
         }
+        renderStopped(success, false);
     }
 }
 
-void Renderer::_play(Handle &handle, int orderNo, int rowNo, bool stepping) {
+void Renderer::_play(trackerboy::MusicRuntime const& runtime, bool stepping) {
 
-    handle->engine.play(orderNo, rowNo);
-    handle->stepping = stepping;
-    handle->step = stepping;
-    beginRender(handle);
+    auto &ctx = mContext;
+    ctx.engine.play(runtime);
+    ctx.stepping = stepping;
+    ctx.step = stepping;
 
 }
 
-void Renderer::resetPreview(Handle &handle) {
+void Renderer::_setSnapshot(std::shared_ptr<Module::Snapshot const> snapshot) {
+    auto &ctx = mContext;
+
+    // the old snapshot must stay alive until everything is rebound
+    auto old = std::move(ctx.snapshot);
+    ctx.snapshot = std::move(snapshot);
+
+    auto const& instrumentTable = *ctx.snapshot->instrumentTable;
+    auto const& waveTable = *ctx.snapshot->waveformTable;
+    ctx.engine.setTables(instrumentTable, waveTable);
+    ctx.engine.setSong(ctx.snapshot->song.get());
+    auto const waveram = ctx.previewRc ? ctx.previewRc->waveram : trackerboy::WaveramCache();
+    ctx.previewRc.emplace(ctx.apu, instrumentTable, waveTable);
+    ctx.previewRc->waveram = waveram;
+
+    if (ctx.previewState == PreviewState::waveform) {
+        // uploads the previewed waveform again if it was edited
+        trackerboy::ChannelControl<trackerboy::ChType::ch3>::update(
+            ctx.apu, waveTable, ctx.previewRc->waveram, ctx.previewWave, ctx.previewWave
+        );
+    }
+
+    if (ctx.previewState == PreviewState::instrument && ctx.previewInstrument != -1 && old) {
+        auto const id = (uint8_t)ctx.previewInstrument;
+        if (instrumentTable.get(id) != old->instrumentTable->get(id)) {
+            // the previewed instrument was edited or removed
+            if (auto instrument = instrumentTable.get(id)) {
+                ctx.ip.setInstrument(instrument, ctx.previewChannel);
+                ctx.ip.play(ctx.previewNote);
+            } else {
+                resetPreview();
+            }
+        }
+    }
+
+    // a driver only gets a snapshot once the previous one was retired, the
+    // GUI collects before executing one itself, so this always has room
+    if (ctx.retired) {
+        retireSnapshot();
+    }
+    Q_ASSERT(ctx.retired == nullptr);
+    ctx.retired = std::move(old);
+}
+
+void Renderer::retireSnapshot() {
+    auto &ctx = mContext;
+    if (ctx.retired && !mRetiredSnapshots.push(std::move(ctx.retired))) {
+        // never free it here, try again next frame
+        return;
+    }
+    mSnapshotInFlight.store(false, std::memory_order_release);
+}
+
+void Renderer::resetPreview() {
     // lock the channel so it can be used for music
-    handle->engine.lock(handle->previewChannel);
-    handle->ip.setInstrument(nullptr);
-    handle->previewState = PreviewState::none;
+    mContext.engine.lock(mContext.previewChannel);
+    mContext.ip.setInstrument(nullptr);
+    mContext.previewState = PreviewState::none;
+    mContext.previewInstrument = -1;
 }
 
  void Renderer::setChannelOutput(ChannelOutput::Flags flags) {
-     auto ctx = mContext.access();
-     _setChannelOutput(ctx, flags);
+     sendCommand({ Command::Type::setChannelOutput, (int)flags });
  }
 
- void Renderer::_setChannelOutput(Handle &handle, ChannelOutput::Flags flags) {
+ void Renderer::_setChannelOutput(ChannelOutput::Flags flags) {
      int flag = ChannelOutput::CH1;
      for (int i = 0; i < 4; ++i) {
          auto ch = static_cast<trackerboy::ChType>(i);
          if (flags.testFlag((ChannelOutput::Flag)(flag))) {
-             handle->engine.lock(ch);
+             mContext.engine.lock(ch);
          } else {
              // channel is disabled, keep unlocked
-             handle->engine.unlock(ch);
+             mContext.engine.unlock(ch);
          }
          flag <<= 1;
      }
  }
 
 void Renderer::timerCallback(void *userData) {
-    // called by FastTimer 
-    static_cast<Renderer*>(userData)->render();
+    // called by FastTimer
+    static_cast<Renderer*>(userData)->renderLocked();
+}
+
+void Renderer::wakeCallback(void *userData) {
+    // called by the render thread when woken
+    static_cast<Renderer*>(userData)->renderLocked();
+}
+
+void Renderer::renderLocked() {
+    auto const waitStart = Clock::now();
+    QMutexLocker locker(&mRenderMutex);
+    render(std::numeric_limits<size_t>::max(), Clock::now() - waitStart);
+}
+
+bool Renderer::pullCallback(void *userData, size_t frames) {
+    // called by AudioStream
+    return static_cast<Renderer*>(userData)->handlePull(frames);
+}
+
+bool Renderer::handlePull(size_t frames) {
+    // This function is called from the audio callback thread!
+
+    auto const state = mState.load(std::memory_order_acquire);
+    if (state == State::stopped) {
+        return false;
+    }
+
+    auto const buffered = mStream.bufferSize() - mStream.writer().availableWrite();
+
+    // track the lowest headroom for the latency controller
+    auto const headroom = buffered > frames ? buffered - frames : 0;
+    auto lowest = mHeadroom.load(std::memory_order_relaxed);
+    while (headroom < lowest && !mHeadroom.compare_exchange_weak(lowest, headroom, std::memory_order_relaxed)) {
+    }
+
+    switch (mRenderMode.load(std::memory_order_relaxed)) {
+        case SoundConfig::RenderMode::thread:
+            if (buffered < frames + mLowWater.load(std::memory_order_relaxed)) {
+                mRenderThread.wake();
+            }
+            break;
+        case SoundConfig::RenderMode::callback:
+            // if the GUI thread is taking the context, just play what we have
+            if (buffered < frames && mRenderMutex.tryLock()) {
+                render(frames - buffered);
+                mRenderMutex.unlock();
+            }
+            break;
+        default:
+            break;
+    }
+
+    return state == State::running;
 }
 
 // this is the number of frames to output before stopping playback
@@ -466,147 +1044,192 @@ void Renderer::timerCallback(void *userData) {
 // the high pass filter will decay the signal to 0)
 constexpr int STOP_FRAMES = 5;
 
-void Renderer::render() {
+void Renderer::render(size_t frames, Clock::duration lockWait) {
     // This function is called from a separate thread!
-    // FastTimer lives in its own thread and calls this function via the timer callback
-    
-    auto now = Clock::now();
+    // Either the timer thread, the render thread or the audio callback thread
 
-    auto handle = mContext.access();
-
-    if (handle->state == State::stopped) {
+    if (mState == State::stopped) {
         return;
     }
 
+    auto now = Clock::now();
+
+    auto &ctx = mContext;
+
 
     // diagnostics
-    handle->periodTime = now - handle->lastPeriod;
-    handle->lastPeriod = now;
-    handle->writesSinceLastPeriod = 0;
+    auto const period = now - ctx.lastPeriod;
+    mPeriodTime.store(period.count(), std::memory_order_relaxed);
+    ctx.lastPeriod = now;
+    size_t writesSinceLastPeriod = 0;
 
 
     auto writer = mStream.writer();
-    auto framesToRender = writer.availableWrite();
+    auto const buffered = ctx.bufferSize - writer.availableWrite();
+    auto target = ctx.bufferSize;
+    if (ctx.autoLatency) {
+        target = ctx.latency.update(
+            now,
+            mStream.underruns(),
+            mHeadroom.exchange(std::numeric_limits<size_t>::max(), std::memory_order_relaxed),
+            ctx.lastRenderTime
+        );
+        mFillTarget.store(target, std::memory_order_relaxed);
+        mLowWater.store(target / 2, std::memory_order_relaxed);
+    }
+    auto framesToRender = std::min(target > buffered ? target - buffered : 0, frames);
 
     if (framesToRender) {
         // reset the watchdog
-        handle->watchdog = now;
+        ctx.watchdog = now;
     } else {
+        mWritesSinceLastPeriod.store(0, std::memory_order_relaxed);
         constexpr auto WATCHDOG_INTERVAL = std::chrono::seconds(1);
-        auto timeSinceLastWatchdogReset = now - handle->watchdog;
+        auto timeSinceLastWatchdogReset = now - ctx.watchdog;
         if (timeSinceLastWatchdogReset >= WATCHDOG_INTERVAL) {
             // we have gone 1 second without renderering anything
             // abort the render
-            stopRender(handle, true);
+            finishRender(true);
         }
         // no frames to render, exit early
         return;
     }
 
-    
-    auto frame = handle->currentEngineFrame;
-    auto const haltedBefore = frame.halted;
+
+    // stage timing for diagnostics
+    mStats.begin();
+    mStats.add(RenderStats::Stage::lockWait, lockWait);
+    auto timed = [this](RenderStats::Stage stage, auto &&fn) {
+        auto const start = Clock::now();
+        fn();
+        mStats.add(stage, Clock::now() - start);
+    };
+
+    auto frame = ctx.currentEngineFrame;
 
     // cache a ref to the apu, we'll be using it often
-    auto &apu = handle->synth.apu();
+    auto &apu = ctx.synth.apu();
 
     bool newFrame = false;
 
-    auto visHandle = mVisBuffer.access();
-    visHandle->beginWrite(framesToRender);
+    mVisBuffer.beginWrite(framesToRender);
 
     while (framesToRender) {
 
-        if (handle->state == State::stopping) {
-            if (writer.availableWrite() == handle->bufferSize) {
-                // the buffer has been drained, stop the callback
-                visHandle.unlock();
-                stopRender(handle);
+        if (apu.availableSamples() == 0) {
+            // new frame, retry handing back the last snapshot and apply any
+            // requests from the GUI
+            if (ctx.retired) {
+                retireSnapshot();
             }
-            return;
+            drainCommands();
 
-        } else {
-
-            if (apu.availableSamples() == 0) {
-                // new frame
-
-                if (handle->state == State::stopping) {
-                    break; // stop, don't render any more
+            if (mState == State::stopping) {
+                // publish before finishing, the GUI owns the visualizer
+                // buffer once the render has finished
+                if (writesSinceLastPeriod) {
+                    mVisBuffer.publish();
                 }
+                if (writer.availableWrite() == ctx.bufferSize) {
+                    // the buffer has been drained, stop the callback
+                    finishRender(false);
+                }
+                return; // stop, don't render any more
+            }
 
-                if (handle->stopCounter) {
-                    if (--handle->stopCounter == 0) {
-                        handle->state = State::stopping;
-                    }
-                } else {
-                    newFrame = true;
-
-                    // the engine and previewer have read access to the module
-                    // so the document must be locked when stepping
-
-                    // step engine/previewer
-                    if (!handle->stepping || handle->step) {
-                        
-                        {
-                            QMutexLocker locker(&handle->mod.mutex());
-                            handle->engine.step(frame);
-                        }
-                        
-                        if (frame.startedNewRow) {
-                            handle->step = false;
-                        }
-                    }
+            if (ctx.stopCounter) {
+                if (--ctx.stopCounter == 0) {
+                    mState = State::stopping;
+                }
+            } else {
+                newFrame = true;
 
-                    if (handle->previewState == PreviewState::instrument) {
-                        auto &mod = handle->mod.data();
-                        trackerboy::RuntimeContext rc(handle->apu, mod.instrumentTable(), mod.waveformTable());
-                        
-                        {
-                            QMutexLocker locker(&handle->mod.mutex());
-                            handle->ip.step(rc);
-                        }
-                    }
+                // step engine/previewer, both read from the snapshot so
+                // there is no need to lock the module
+                if (!ctx.stepping || ctx.step) {
 
+                    timed(RenderStats::Stage::engine, [&]() {
+                        ctx.engine.step(frame);
+                    });
 
-                    if (frame.halted && handle->previewState == PreviewState::none) {
-                        // no longer doing anything, start the stop counter
-                        handle->stopCounter = STOP_FRAMES;
+                    if (frame.startedNewRow) {
+                        ctx.step = false;
                     }
+                }
 
+                if (ctx.previewState == PreviewState::instrument) {
+                    timed(RenderStats::Stage::preview, [&]() {
+                        ctx.ip.step(*ctx.previewRc);
+                    });
                 }
 
-                handle->synth.run();
+
+                if (frame.halted && ctx.previewState == PreviewState::none) {
+                    // no longer doing anything, start the stop counter
+                    ctx.stopCounter = STOP_FRAMES;
+                }
 
             }
 
-            size_t toWrite = std::min(framesToRender, apu.availableSamples());
-            auto writePtr = writer.acquireWrite(toWrite);
-            
-            // read from the apu to the ringbuffer
-            apu.readSamples(writePtr, toWrite);
-            // send a copy to the visualizer buffer as well
-            visHandle->write(writePtr, toWrite);
-            
-            writer.commitWrite(writePtr, toWrite);
-            
-            handle->writesSinceLastPeriod += toWrite;
-            framesToRender -= toWrite;
+            // send this frame's register writes to the synth
+            timed(RenderStats::Stage::synth, [&]() {
+                ctx.apu.flush();
+                ctx.synth.run();
+            });
 
         }
 
+        size_t toWrite = std::min(framesToRender, apu.availableSamples());
+        auto writePtr = writer.acquireWrite(toWrite);
+
+        // read from the apu to the ringbuffer
+        timed(RenderStats::Stage::copy, [&]() {
+            apu.readSamples(writePtr, toWrite);
+        });
+        // send a copy to the visualizer buffer as well
+        timed(RenderStats::Stage::visualizer, [&]() {
+            mVisBuffer.write(writePtr, toWrite);
+        });
+
+        writer.commitWrite(writePtr, toWrite);
+
+        writesSinceLastPeriod += toWrite;
+        framesToRender -= toWrite;
+
     }
 
-    if (handle->writesSinceLastPeriod) {
-        emit updateVisualizers();
+    mWritesSinceLastPeriod.store(writesSinceLastPeriod, std::memory_order_relaxed);
+
+    if (writesSinceLastPeriod) {
+        timed(RenderStats::Stage::visualizer, [&]() {
+            mVisBuffer.publish();
+        });
     }
 
+    ctx.lastRenderTime = Clock::now() - now;
+    mStats.end(
+        ctx.lastRenderTime,
+        std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>((double)writesSinceLastPeriod / ctx.synth.samplerate())
+        )
+    );
+
     if (newFrame) {
-        handle->currentEngineFrame = frame;
-        handle.unlock(); // always unlock before emitting signals
-        if (haltedBefore != frame.halted) {
-            emit isPlayingChanged(!frame.halted);
+        ctx.currentEngineFrame = frame;
+        mFrame.store(packFrame(frame), std::memory_order_release);
+    }
+
+    if (mRenderMode.load(std::memory_order_relaxed) == SoundConfig::RenderMode::callback) {
+        // the device needs the rest of its period, if we keep going over our
+        // share of it let the render thread take over
+        if (ctx.lastRenderTime * CALLBACK_BUDGET > period) {
+            if (++ctx.overBudget == CALLBACK_OVER_BUDGET) {
+                mRenderMode.store(SoundConfig::RenderMode::thread, std::memory_order_relaxed);
+                mRenderThread.wake();
+            }
+        } else {
+            ctx.overBudget = 0;
         }
-        emit frameSync();
     }
 
 }
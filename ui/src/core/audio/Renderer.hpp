@@ -2,32 +2,47 @@
 #pragma once
 
 #include "core/audio/AudioStream.hpp"
+#include "core/audio/LatencyController.hpp"
+#include "core/audio/RenderStats.hpp"
 #include "core/audio/Ringbuffer.hpp"
 #include "core/audio/VisualizerBuffer.hpp"
 #include "core/ChannelOutput.hpp"
 #include "core/config/SoundConfig.hpp"
 #include "core/FastTimer.hpp"
-#include "core/Guarded.hpp"
 #include "core/Module.hpp"
+#include "core/SpscQueue.hpp"
+#include "core/WakeThread.hpp"
 
 #include "trackerboy/data/Song.hpp"
 #include "trackerboy/data/Instrument.hpp"
 #include "trackerboy/data/Waveform.hpp"
+#include "trackerboy/engine/BufferedApu.hpp"
+#include "trackerboy/engine/CheckpointCache.hpp"
 #include "trackerboy/engine/Engine.hpp"
 #include "trackerboy/InstrumentPreview.hpp"
 #include "trackerboy/Synth.hpp"
 #include "trackerboy/note.hpp"
 
+#include <QMutex>
 #include <QObject>
 #include <QThread>
+#include <QTimer>
 
+#include <atomic>
 #include <chrono>
+#include <cstdint>
+#include <memory>
 #include <optional>
 
 //
 // Class handles all sound renderering. Sound is sent to the
 // configured device set in Config.
 //
+// The public interface is for the GUI thread only. Requests are sent to the
+// render thread as commands, which are applied at the next frame boundary,
+// so the GUI never waits on the render thread for synthesis. The render
+// thread plays from a snapshot of the module and never locks it.
+//
 class Renderer : public QObject {
 
     Q_OBJECT
@@ -43,6 +58,11 @@ public:
         size_t writesSinceLastPeriod;
         Clock::duration lastPeriod;
         double elapsed;
+        // frames the renderer keeps buffered, less than bufferSize when
+        // adaptive latency is enabled
+        size_t fillTarget;
+        // timing of each stage of the render, and the DSP load
+        RenderStats::Snapshot stats;
 
 
     };
@@ -61,7 +81,7 @@ public:
     // Accessor for the visualizer buffer. The updateVisualizers() signal is
     // emitted when this buffer is modified.
     //
-    Guarded<VisualizerBuffer>& visualizerBuffer();
+    VisualizerBuffer& visualizerBuffer();
 
     //
     // Determines if the renderer is renderering sound.
@@ -132,7 +152,8 @@ signals:
     void audioError();
 
     //
-    // emitted when a new frame is renderered
+    // emitted when the renderer has published a new frame, see currentFrame().
+    // Frames are polled, so frames renderered in between polls are skipped.
     //
     void frameSync();
 
@@ -203,6 +224,14 @@ private slots:
     //
     void setSong();
 
+    //
+    // invoked when the module was edited. The render thread is sent a new
+    // snapshot of the module, playback continues from the same position.
+    // Snapshots are coalesced, if the driver has yet to take the last one
+    // the new one is sent by poll() once it has.
+    //
+    void updateSnapshot();
+
 private:
     Q_DISABLE_COPY(Renderer)
 
@@ -218,9 +247,58 @@ private:
         stopped     // no longer renderering anything, do nothing when render is called
     };
 
+    // request from a driver to stop the stream, see finishRender
+    enum class FinishRequest {
+        none,
+        finished,
+        aborted
+    };
+
     //
-    // This struct contains shared data between the GUI thread and the
-    // render thread.
+    // A request from the GUI thread, see the slot with the same name for
+    // details on each command.
+    //
+    struct Command {
+        enum class Type {
+            play,
+            stepNextFrame,
+            stepOut,
+            jumpToPattern,
+            setPatternRepeat,
+            setPreviewNote,
+            instrumentPreview,
+            waveformPreview,
+            stopPreview,
+            stopMusic,
+            setChannelOutput,
+            setSnapshot
+        };
+
+        Type type;
+        // arguments, usage depends on the type
+        int arg1;
+        int arg2;
+        int arg3;
+        // setSnapshot: the new snapshot
+        std::shared_ptr<Module::Snapshot const> snapshot;
+        // play: the runtime to start from, already seeked by the GUI thread
+        std::optional<trackerboy::MusicRuntime> runtime;
+        // instrumentPreview: the instrument, resolved by the GUI thread from
+        // the snapshot the command is executed with (nullptr for none)
+        trackerboy::Instrument const* instrument;
+
+        Command(Type type = Type::stopMusic, int arg1 = 0, int arg2 = 0, int arg3 = 0);
+
+        // MusicRuntime is copy constructible only, so the runtime is
+        // reconstructed in place (it does not allocate)
+        Command(Command &&cmd) noexcept;
+        Command& operator=(Command &&cmd) noexcept;
+    };
+
+    //
+    // This struct contains the data used for rendering. It is owned by the
+    // render thread while the render is running. When the render is stopped
+    // (the timer is not running), the GUI thread owns it instead.
     //
     struct RenderContext {
         // the current module
@@ -231,88 +309,281 @@ private:
         // determines if the engine should step (ignored when mStepping = false)
         bool step;
 
-        std::shared_ptr<trackerboy::Song> song;
+        // the song and tables being played, the engine and previewer only
+        // read from this snapshot
+        std::shared_ptr<Module::Snapshot const> snapshot;
+        // the previous snapshot, when mRetiredSnapshots had no room for it
+        std::shared_ptr<Module::Snapshot const> retired;
 
         trackerboy::Synth synth;
-        trackerboy::GbApu apu;
-        //trackerboy::RuntimeContext mRc;
-        // read access to the current song, wave table and instrument table
-        trackerboy::Engine engine;
+        trackerboy::GbApu synthApu;
+        // all register writes go through here, and are flushed to the synth
+        // once per frame
+        trackerboy::BufferedApu apu;
+        // runtime context for the instrument preview, kept here so that it
+        // isn't constructed every frame. Bound to the snapshot's tables.
+        std::optional<trackerboy::BasicRuntimeContext<trackerboy::BufferedApu>> previewRc;
+        // read access to the snapshot's song, wave table and instrument table
+        trackerboy::BasicEngine<trackerboy::BufferedApu> engine;
         // has read access to an Instrument and wave table
         trackerboy::InstrumentPreview ip;
 
 
         PreviewState previewState;
         trackerboy::ChType previewChannel;
+        // id of the instrument being previewed, -1 for none
+        int previewInstrument;
+        uint8_t previewNote;
+        // state of CH3 during a waveform preview
+        trackerboy::ChannelState previewWave;
 
         trackerboy::Frame currentEngineFrame;
 
-        State state;
         int stopCounter;
 
         size_t bufferSize; // cache this here so we don't have to call mStream.bufferSize() in the render thread
 
+        // adjusts the fill target when adaptive latency is enabled
+        bool autoLatency;
+        LatencyController latency;
+        Clock::duration lastRenderTime;
+        // number of consecutive callback renders over budget
+        int overBudget;
+
         // diagnostics
         Clock::time_point watchdog; // occurance of last watchdog reset
         Clock::time_point lastPeriod; // occurance of the last period
-        Clock::duration periodTime; // time difference between the last period and the current one
-        size_t writesSinceLastPeriod; // number of samples written for the last period
 
         RenderContext(Module &mod);
     };
 
-    // type alias for mutually exclusive access to the RenderContext
-    using Handle = Locked<RenderContext>;
+    // command handling ------------------------------------------------------
 
-    // sets up the engine to play starting at the given pattern and row
-    void _play(Handle &handle, int pattern, int row, bool stepping = false);
+    //
+    // Sends a command to the render thread. If the render is stopped, the
+    // command is executed immediately and the render is started if start is
+    // true. If the command cannot be queued (the queue is full, or it is a
+    // snapshot and one is already queued), the GUI waits for the render call
+    // in progress and executes the queue and the command itself. The wait is
+    // bounded by a single render call, even if the driver has stalled.
+    //
+    void sendCommand(Command &&cmd, bool start = false);
 
-    void _stopMusic(Handle &handle);
+    //
+    // Sends a snapshot of the module now, regardless of one being in flight.
+    //
+    void sendSnapshot();
+
+    //
+    // Executes a command, must only be called by the owner of the context.
+    //
+    void execute(Command &cmd);
+
+    //
+    // Executes all commands in the queue, must only be called by the owner of
+    // the context.
+    //
+    void drainCommands();
+
+    // sets up the engine to play from the given runtime
+    void _play(trackerboy::MusicRuntime const& runtime, bool stepping);
+
+    //
+    // Plays from the given snapshot. The previous snapshot is kept in
+    // the context until retireSnapshot() sends it back to the GUI thread.
+    //
+    void _setSnapshot(std::shared_ptr<Module::Snapshot const> snapshot);
+
+    //
+    // Sends the retired snapshot to the GUI thread to be freed. If there is no
+    // room, it is kept and the driver tries again next frame. The snapshot
+    // command is finished (mSnapshotInFlight is cleared) once it is sent.
+    // Must only be called by the owner of the context.
+    //
+    void retireSnapshot();
+
+    //
+    // Frees the snapshots retired by the render thread. GUI thread only, called
+    // by poll() and when sending commands.
+    //
+    void collectSnapshots();
+
+    void _stopMusic();
 
     // utility function for preview slots
-    void resetPreview(Handle &handle);
+    void resetPreview();
 
-    void previewNoteOrInstrument(int note, int track = -1, int instrument = -1);
+    void _setChannelOutput(ChannelOutput::Flags flags);
 
-    void _setChannelOutput(Handle &handle, ChannelOutput::Flags flags);
+    //
+    // Cancels a pending stop, for commands that begin rendering.
+    //
+    void resume();
 
     // stream management -----------------------------------------------------
 
     //
-    // Start the audio callback thread for the configured device. If the audio
-    // callback thread is already running, the stop countdown is cancelled
+    // Start the audio callback thread for the configured device. The buffer
+    // is primed with the first block of audio before the device is started,
+    // so playback begins without an initial delay. Must be called with
+    // mLifecycleMutex locked and the render stopped. Returns false if the
+    // stream could not be started.
     //
-    void beginRender(Handle &handle);
+    bool startRender();
+
+    //
+    // Stops the render thread and takes ownership of the context, pending
+    // commands are executed. Must be called from the GUI thread with
+    // mLifecycleMutex locked.
+    //
+    void takeContext();
+
+    //
+    // Starts or stops whatever drives render() for the current render mode.
+    // GUI thread only.
+    //
+    void startDriver();
+    void stopDriver();
+
+    // render drivers, see SoundConfig::RenderMode
 
     static void timerCallback(void *userData);
 
+    static void wakeCallback(void *userData);
+
     //
-    // Fills the playback buffer with newly renderered samples. Stops rendering
-    // if there is no work to do and the buffer has drained completely.
+    // Locks mRenderMutex and renders as much as possible, timing the wait
+    // for the render stats. Used by the timer and render thread drivers.
     //
-    // This function is called periodically from a separate thread.
+    void renderLocked();
+
+    static bool pullCallback(void *userData, size_t frames);
+
+    //
+    // Called from the audio callback before it reads the given number of
+    // frames from the buffer. Depending on the mode, the render thread is
+    // woken if the buffer is low or the frames are rendered here. Returns
+    // false if the render is stopping or stopped, so the stream does not
+    // count the drained buffer as an underrun.
+    //
+    bool handlePull(size_t frames);
+
+    //
+    // Renders up to the given number of frames into the playback buffer, less
+    // if the buffer does not have the room. Stops rendering if there is no
+    // work to do and the buffer has drained completely.
     //
-    void render();
+    // This function is called from a driver thread with mRenderMutex locked.
+    // lockWait is the time the driver waited for the lock, for the stats.
+    //
+    void render(size_t frames, Clock::duration lockWait = Clock::duration(0));
 
     //
-    // Immediately stops the render without letting the buffer drain.
+    // Stops the render from a driver thread. The render is not stopped if
+    // the GUI thread has sent a command or is currently stopping the render.
+    // The stream is stopped later by poll() on the GUI thread, since a driver
+    // may be the device's own callback.
     //
-    void stopRender(Handle &handle, bool aborted = false);
+    void finishRender(bool aborted);
+
+    //
+    // GUI thread side of finishRender, stops the stream unless the render
+    // was restarted in the meantime.
+    //
+    void streamFinished(bool aborted);
+
+    //
+    // Checks the state published by the driver and emits the signals for
+    // it. Called by mPollTimer on the GUI thread while rendering, so that a
+    // driver never has to emit a signal or post an event.
+    //
+    void poll();
+
+    //
+    // Immediately stops the render without letting the buffer drain. GUI
+    // thread only.
+    //
+    void stopRender(bool aborted = false);
+
+    //
+    // Clears the visualizers and emits the appropriate signal after the
+    // render was stopped.
+    //
+    void renderStopped(bool success, bool aborted);
 
     // class members ---------------------------------------------------------
 
     QThread mTimerThread;
     FastTimer *mTimer;
-
-    AudioStream mStream;
-    Guarded<VisualizerBuffer> mVisBuffer;
+    WakeThread mRenderThread;
+    // runs poll() while rendering, GUI thread
+    QTimer mPollTimer;
 
     //
-    // All variables accessible from multiple threads are stored in the RenderContext
-    // struct, access to them is guarded by a mutex.
+    // Held by a driver for the duration of a render() call. The GUI thread
+    // locks it to wait for a render in progress after marking the render as
+    // stopped. The audio callback only try-locks it.
     //
-    Guarded<RenderContext> mContext;
-    
+    QMutex mRenderMutex;
+    std::atomic<SoundConfig::RenderMode> mRenderMode;
+    // the render thread is woken when the buffer has less than this many
+    // frames, after the device's read
+    std::atomic<size_t> mLowWater;
+    // number of frames the renderer keeps in the buffer, set by the render
+    // thread when adaptive latency is enabled
+    std::atomic<size_t> mFillTarget;
+    // lowest number of frames left after a device read, since the render
+    // thread last took it
+    std::atomic<size_t> mHeadroom;
+
+    RenderStats mStats;
+
+    AudioStream mStream;
+    VisualizerBuffer mVisBuffer;
+
+    RenderContext mContext;
+
+    // commands from the GUI thread, drained by the render thread at the
+    // start of each frame
+    SpscQueue<Command, 64> mCommands;
+
+    // snapshots no longer in use by the render thread, so that they are freed
+    // on the GUI thread instead
+    SpscQueue<std::shared_ptr<Module::Snapshot const>, 16> mRetiredSnapshots;
+
+    //
+    // Guards starting and stopping the render, which changes the owner of
+    // mContext. This mutex is never held while synthesizing, the render
+    // thread only try-locks it when stopping.
+    //
+    QMutex mLifecycleMutex;
+    std::atomic<State> mState;
+
+    // state published by the render thread for the GUI thread
+
+    // set by the GUI when a setSnapshot command is queued, cleared by the
+    // driver once it has executed it and retired the previous snapshot. At
+    // most one snapshot is queued.
+    std::atomic_bool mSnapshotInFlight;
+
+    // the current engine frame, packed (see Renderer.cpp)
+    std::atomic<uint64_t> mFrame;
+    std::atomic<FinishRequest> mFinishRequest;
+    std::atomic<size_t> mWritesSinceLastPeriod;
+    std::atomic<Clock::rep> mPeriodTime;
+
+    // GUI thread's view of step mode, updated when sending commands
+    bool mStepping;
+    // last frame seen by poll(), packed
+    uint64_t mPolledFrame;
+    // the module was edited while a snapshot was in flight
+    bool mSnapshotPending;
+    // the last snapshot sent to the driver. Commands are executed in order,
+    // so a command queued now is executed with this snapshot.
+    std::shared_ptr<Module::Snapshot const> mSentSnapshot;
+    // checkpoints of mSentSnapshot's song, so that seeking for play() is done
+    // here instead of on the driver
+    trackerboy::CheckpointCache mCheckpoints;
 
 
 };
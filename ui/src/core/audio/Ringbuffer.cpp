@@ -3,13 +3,63 @@
 
 #include <QtGlobal>
 
+#include <algorithm>
 #include <cstdint>
 #include <cstring>
 
+#ifdef Q_OS_LINUX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifdef Q_OS_LINUX
+
+//
+// Maps a memfd of the given size twice at consecutive addresses. The size
+// must be a multiple of the page size. Returns nullptr on failure.
+//
+uint8_t* mapMirrored(size_t size) {
+    int fd = memfd_create("trackerboy-ringbuffer", MFD_CLOEXEC);
+    if (fd == -1) {
+        return nullptr;
+    }
+
+    uint8_t *result = nullptr;
+    if (ftruncate(fd, (off_t)size) == 0) {
+        // reserve the address range for both mappings, then map the file
+        // over each half
+        auto region = mmap(nullptr, size * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (region != MAP_FAILED) {
+            auto base = static_cast<uint8_t*>(region);
+            auto first = mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+            auto second = mmap(base + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+            if (first == base && second == base + size) {
+                result = base;
+            } else {
+                munmap(region, size * 2);
+            }
+        }
+    }
+
+    // the mappings keep the memory alive
+    close(fd);
+    return result;
+}
+
+#endif
+
+}
+
 RingbufferBase::RingbufferBase() :
-    mInitialized(false),
-    mRingbuffer(),
-    mSize(0)
+    mData(nullptr),
+    mStorageSize(0),
+    mMirrored(false),
+    mHeap(),
+    mSize(0),
+    mReadCount(0),
+    mWriteCount(0)
 {
 
 }
@@ -20,146 +70,146 @@ RingbufferBase::~RingbufferBase() {
 
 void RingbufferBase::init(size_t buffersize, void *buffer) {
     uninit();
-    auto result = ma_rb_init(buffersize, buffer, nullptr, &mRingbuffer);
-    mInitialized = result == MA_SUCCESS;
-    if (mInitialized) {
-        ma_rb_reset(&mRingbuffer);
-    }
+
     mSize = buffersize;
+    if (buffersize == 0) {
+        return;
+    }
+
+    if (buffer != nullptr) {
+        // caller provided storage, cannot be mirrored
+        mData = static_cast<uint8_t*>(buffer);
+        mStorageSize = buffersize;
+    } else {
+        #ifdef Q_OS_LINUX
+        auto const pagesize = (size_t)sysconf(_SC_PAGESIZE);
+        auto const storageSize = (buffersize + pagesize - 1) / pagesize * pagesize;
+        mData = mapMirrored(storageSize);
+        if (mData != nullptr) {
+            mStorageSize = storageSize;
+            mMirrored = true;
+        }
+        #endif
+
+        if (mData == nullptr) {
+            mHeap.reset(new uint8_t[buffersize]);
+            mData = mHeap.get();
+            mStorageSize = buffersize;
+        }
+    }
+
+    reset();
 }
 
 void RingbufferBase::uninit() {
-    if (mInitialized) {
-        ma_rb_uninit(&mRingbuffer);
-        mInitialized = false;
+    #ifdef Q_OS_LINUX
+    if (mMirrored) {
+        munmap(mData, mStorageSize * 2);
     }
+    #endif
+    mHeap.reset();
+    mData = nullptr;
+    mStorageSize = 0;
+    mMirrored = false;
+    mSize = 0;
+    reset();
+}
+
+bool RingbufferBase::isMirrored() const {
+    return mMirrored;
 }
 
 size_t RingbufferBase::size() const {
     return mSize;
 }
 
+size_t RingbufferBase::contiguous(size_t pos, size_t available) const {
+    if (mMirrored) {
+        // the mirror makes everything contiguous
+        return available;
+    }
+    return std::min(available, mStorageSize - pos);
+}
+
 size_t RingbufferBase::read(void *data, size_t sizeInBytes) {
     size_t bytesToRead = sizeInBytes;
-    void *src;
-    
-    auto result = ma_rb_acquire_read(&mRingbuffer, &bytesToRead, &src);
-    Q_ASSERT(result == MA_SUCCESS);
-
+    auto src = acquireRead(bytesToRead);
     memcpy(data, src, bytesToRead);
-    
-    result = ma_rb_commit_read(&mRingbuffer, bytesToRead, src);
-    Q_ASSERT(result == MA_SUCCESS || result == MA_AT_END);
-    
-    Q_UNUSED(result)
+    commitRead(src, bytesToRead);
     return bytesToRead;
 }
 
 size_t RingbufferBase::write(void const *data, size_t sizeInBytes) {
-    void *dest;
     size_t bytesToWrite = sizeInBytes;
-
-    auto result = ma_rb_acquire_write(&mRingbuffer, &bytesToWrite, &dest);
-    Q_ASSERT(result == MA_SUCCESS);
-
+    auto dest = acquireWrite(bytesToWrite);
     memcpy(dest, data, bytesToWrite);
-    
-    result = ma_rb_commit_write(&mRingbuffer, bytesToWrite, dest);
-    Q_ASSERT(result == MA_SUCCESS || result == MA_AT_END);
-    
-    Q_UNUSED(result)
+    commitWrite(dest, bytesToWrite);
     return bytesToWrite;
 }
 
 size_t RingbufferBase::fullRead(void *buf, size_t sizeInBytes) {
-    size_t readAvail = ma_rb_available_read(&mRingbuffer);
-
-    if (readAvail == 0) {
-        return 0;
-    }
-
-    // do the first read
+    // with a mirrored buffer the first read gets everything
     size_t bytesRead = read(buf, sizeInBytes);
-
-    sizeInBytes -= bytesRead;
-    readAvail -= bytesRead;
-
-    if (sizeInBytes != 0 && readAvail) {
+    if (bytesRead != sizeInBytes && !mMirrored) {
         // do the second read (the read pointer starts at the beginning)
-        bytesRead += read(reinterpret_cast<uint8_t*>(buf) + bytesRead, sizeInBytes);
-
+        bytesRead += read(reinterpret_cast<uint8_t*>(buf) + bytesRead, sizeInBytes - bytesRead);
     }
-
     return bytesRead;
 }
 
 size_t RingbufferBase::fullWrite(void const *buf, size_t sizeInBytes) {
-    size_t writeAvail = ma_rb_available_write(&mRingbuffer);
-
-    if (writeAvail == 0) {
-        return 0;
-    }
-
     size_t bytesWritten = write(buf, sizeInBytes);
-
-    sizeInBytes -= bytesWritten;
-    writeAvail -= bytesWritten;
-
-    if (sizeInBytes != 0 && writeAvail) {
-        bytesWritten += write(reinterpret_cast<uint8_t const*>(buf) + bytesWritten, sizeInBytes);
+    if (bytesWritten != sizeInBytes && !mMirrored) {
+        bytesWritten += write(reinterpret_cast<uint8_t const*>(buf) + bytesWritten, sizeInBytes - bytesWritten);
     }
-
     return bytesWritten;
 }
 
 void* RingbufferBase::acquireRead(size_t &outSize) {
-    void *buf;
-    auto result = ma_rb_acquire_read(&mRingbuffer, &outSize, &buf);
-    Q_ASSERT(result == MA_SUCCESS);
-    Q_UNUSED(result)
-    return buf;
+    auto const readCount = mReadCount.load(std::memory_order_relaxed);
+    auto const pos = mStorageSize ? readCount % mStorageSize : 0;
+    outSize = std::min(outSize, contiguous(pos, availableRead()));
+    return mData + pos;
 }
 
 void RingbufferBase::commitRead(void *buf, size_t size) {
-    auto result = ma_rb_commit_read(&mRingbuffer, size, buf);
-    Q_ASSERT(result == MA_SUCCESS);
-    Q_UNUSED(result)
+    Q_ASSERT(size <= availableRead());
+    Q_UNUSED(buf)
+    // release so that the writer does not overwrite what we are reading
+    mReadCount.store(mReadCount.load(std::memory_order_relaxed) + size, std::memory_order_release);
 }
 
 void* RingbufferBase::acquireWrite(size_t &outSize) {
-    void *buf;
-    auto result = ma_rb_acquire_write(&mRingbuffer, &outSize, &buf);
-    Q_ASSERT(result == MA_SUCCESS);
-    Q_UNUSED(result)
-    return buf;
+    auto const writeCount = mWriteCount.load(std::memory_order_relaxed);
+    auto const pos = mStorageSize ? writeCount % mStorageSize : 0;
+    outSize = std::min(outSize, contiguous(pos, availableWrite()));
+    return mData + pos;
 }
 
 void RingbufferBase::commitWrite(void *buf, size_t size) {
-    auto result = ma_rb_commit_write(&mRingbuffer, size, buf);
-    Q_ASSERT(result == MA_SUCCESS);
-    Q_UNUSED(result)
+    Q_ASSERT(size <= availableWrite());
+    Q_UNUSED(buf)
+    // release so that the reader sees the written data
+    mWriteCount.store(mWriteCount.load(std::memory_order_relaxed) + size, std::memory_order_release);
 }
 
 size_t RingbufferBase::availableRead() {
-    return ma_rb_available_read(&mRingbuffer);
+    return mWriteCount.load(std::memory_order_acquire) - mReadCount.load(std::memory_order_relaxed);
 }
 
 size_t RingbufferBase::availableWrite() {
-    return ma_rb_available_write(&mRingbuffer);
+    return mSize - (mWriteCount.load(std::memory_order_relaxed) - mReadCount.load(std::memory_order_acquire));
 }
 
 void RingbufferBase::seekRead(size_t bytes) {
-    auto result = ma_rb_seek_read(&mRingbuffer, bytes);
-    Q_ASSERT(result == MA_SUCCESS);
-    Q_UNUSED(result)
+    commitRead(nullptr, bytes);
 }
 
 void RingbufferBase::seekWrite(size_t bytes) {
-    auto result = ma_rb_seek_write(&mRingbuffer, bytes);
-    Q_ASSERT(result == MA_SUCCESS);
-    Q_UNUSED(result)
+    commitWrite(nullptr, bytes);
 }
 
 void RingbufferBase::reset() {
-    ma_rb_reset(&mRingbuffer);
+    mReadCount.store(0, std::memory_order_relaxed);
+    mWriteCount.store(0, std::memory_order_relaxed);
 }
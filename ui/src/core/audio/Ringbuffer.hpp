@@ -1,13 +1,21 @@
 
 #pragma once
 
-#include "miniaudio.h"
-
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 
 //
-// Wrapper for a miniaudio ringbuffer, ma_rb.
+// Single producer, single consumer ringbuffer.
+//
+// On Linux the storage is mapped twice, back to back, in virtual memory (a
+// memfd mapped at two consecutive addresses). Bytes written past the end of
+// the first mapping appear at the start of the buffer, so every acquire
+// returns a single contiguous span of everything available and reads or
+// writes never have to be split at the wrap point. On other platforms, or if
+// the mapping fails, a regular buffer is used and acquires are limited to the
+// end of the buffer, like miniaudio's ma_rb.
 //
 class RingbufferBase {
 
@@ -17,8 +25,16 @@ public:
     
     void uninit();
 
+    //
+    // Empties the buffer, must not be called while reading or writing
+    //
     void reset();
 
+    //
+    // Determines if the storage is mirrored, see above.
+    //
+    bool isMirrored() const;
+
 protected:
     RingbufferBase();
 
@@ -56,11 +72,29 @@ protected:
 
 private:
 
-    bool mInitialized;
-    ma_rb mRingbuffer;
-
+    //
+    // Gets the contiguous span size for the given position and available
+    // amount
+    //
+    size_t contiguous(size_t pos, size_t available) const;
+
+    // storage, either mapped or heap allocated
+    uint8_t *mData;
+    // size of the storage, the mapping is twice this size. May be larger than
+    // mSize since mappings are a multiple of the page size.
+    size_t mStorageSize;
+    bool mMirrored;
+    std::unique_ptr<uint8_t[]> mHeap;
+
+    // capacity in bytes
     size_t mSize;
 
+    // total bytes read and written, positions in the storage are these
+    // modulo mStorageSize. Only the reader stores mReadCount and only the
+    // writer stores mWriteCount.
+    std::atomic<size_t> mReadCount;
+    std::atomic<size_t> mWriteCount;
+
 };
 
 // thin template idiom
@@ -5,71 +5,127 @@
 
 #include <QtGlobal>
 
-VisualizerBuffer::VisualizerBuffer() :
-    mBufferData(),
-    mBufferSize(0),
-    mIndex(0),
-    mIgnoreCounter(0)
+namespace {
+
+//
+// Combines two adjacent bins of equal width into one
+//
+VisualizerPeak combine(VisualizerPeak a, VisualizerPeak b) {
+    return {
+        std::min(a.min, b.min),
+        std::max(a.max, b.max),
+        (int16_t)((a.mean + b.mean) / 2)
+    };
+}
+
+}
+
+
+VisualizerFrame::VisualizerFrame() :
+    mSize(0),
+    mLevels(0),
+    mOffsets(),
+    mData()
 {
 }
 
-void VisualizerBuffer::clear() {
-    std::fill_n(mBufferData.get(), mBufferSize * 2, (int16_t)0);
-    mIndex = 0;
-    mIgnoreCounter = 0;
+size_t VisualizerFrame::size() const noexcept {
+    return mSize;
 }
 
-void VisualizerBuffer::resize(size_t size) {
+int VisualizerFrame::levels() const noexcept {
+    return mLevels;
+}
 
-    if (mBufferSize != size) {
-        mBufferSize = size;
+size_t VisualizerFrame::levelSize(int level) const noexcept {
+    return mSize >> level;
+}
 
-        auto samples = size * 2;
-        mBufferData.reset(new int16_t[samples]);
+VisualizerPeak const* VisualizerFrame::level(int level, int channel) const noexcept {
+    Q_ASSERT(level < mLevels);
+    return mData.data() + mOffsets[level] + (channel * levelSize(level));
+}
 
-        // resize the buffer clears it
-        clear();
+int VisualizerFrame::levelFor(float samplesPerBin) const noexcept {
+    int level = 0;
+    while (level + 1 < mLevels && (float)(1 << (level + 1)) <= samplesPerBin) {
+        ++level;
     }
+    return level;
 }
 
-size_t VisualizerBuffer::size() const {
-    return mBufferSize;
+VisualizerPeak* VisualizerFrame::levelData(int level, int channel) noexcept {
+    Q_ASSERT(level < mLevels);
+    return mData.data() + mOffsets[level] + (channel * levelSize(level));
 }
 
+void VisualizerFrame::resize(size_t size, int levels) {
+    mSize = size;
+    mLevels = levels;
+    size_t offset = 0;
+    for (int i = 0; i < levels; ++i) {
+        mOffsets[i] = offset;
+        offset += levelSize(i) * 2;
+    }
+    mData.assign(offset, { 0, 0, 0 });
+}
 
-void VisualizerBuffer::read(size_t index, int16_t &outLeft, int16_t &outRight) {
-    Q_ASSERT(index < mBufferSize);
-
-    index = (index + mIndex) % mBufferSize;
 
-    auto buf = mBufferData.get() + (index * 2);
-    outLeft = *buf++;
-    outRight = *buf;
+VisualizerBuffer::VisualizerBuffer() :
+    mBufferSize(0),
+    mIgnoreCounter(0),
+    mHistory(),
+    mFrames(),
+    mBack(0),
+    mFront(1),
+    mMiddle(2)
+{
+}
 
+void VisualizerBuffer::clear() {
+    for (auto &level : mHistory) {
+        for (auto &bins : level.bins) {
+            std::fill(bins.begin(), bins.end(), VisualizerPeak{ 0, 0, 0 });
+        }
+        level.index = 0;
+        level.hasPartial = false;
+    }
+    mIgnoreCounter = 0;
+    publish();
 }
 
-void VisualizerBuffer::averageSample(float index, float bin, float &outLeft, float &outRight) {
-    
-    // determine the number of samples to average, with a minimum of 1 sample
-    int samples = std::max(1, (int)((index + bin) - (int)index));
+void VisualizerBuffer::resize(size_t size) {
+
+    if (mBufferSize != size) {
+        mBufferSize = size;
+
+        // stop when a level would have no bins
+        int levels = 0;
+        while (levels < VisualizerFrame::MAX_LEVELS && (size >> levels) != 0) {
+            ++levels;
+        }
 
-    size_t bufIndex = (mIndex + (size_t)index) % mBufferSize;
-    auto buf = mBufferData.get() + (bufIndex * 2);
+        mHistory.resize(levels);
+        for (int i = 0; i < levels; ++i) {
+            for (auto &bins : mHistory[i].bins) {
+                bins.resize(size >> i);
+            }
+        }
 
-    int sumLeft = 0;
-    int sumRight = 0;
-    for (int i = 0; i < samples; ++i) {
-        sumLeft += *buf++;
-        sumRight += *buf++;
-        if (++bufIndex == mBufferSize) {
-            bufIndex = 0;
-            buf = mBufferData.get();
+        for (auto &frame : mFrames) {
+            frame.resize(size, levels);
         }
+        mBack = 0;
+        mFront = 1;
+        mMiddle.store(2, std::memory_order_relaxed);
+
+        // resize the buffer clears it
+        clear();
     }
-    
-    outLeft = (float)sumLeft / samples;
-    outRight = (float)sumRight / samples;
+}
 
+size_t VisualizerBuffer::size() const {
+    return mBufferSize;
 }
 
 void VisualizerBuffer::beginWrite(size_t amount) {
@@ -81,43 +137,79 @@ void VisualizerBuffer::beginWrite(size_t amount) {
     }
 }
 
-void VisualizerBuffer::write(int16_t buf[], size_t amount) {
+void VisualizerBuffer::write(int16_t const buf[], size_t amount) {
 
     auto ignoring = std::min(mIgnoreCounter, amount);
     amount -= ignoring;
     mIgnoreCounter -= ignoring;
 
-    if (amount) {
-        // adjust buffer pointer skip whatever we ignored
-        buf += ignoring * 2;
-
-        auto dest = mBufferData.get() + (mIndex * 2);
-
-        // this loop should only iterate two times max, if not then the amount is
-        // greater than the buffer's capacity and the caller did not call
-        // beginWrite first. Iterating more than twice is inefficient, since we
-        // are overwriting what we just copied.
-        for (;;) {
-            auto const toWrite = std::min(mBufferSize - mIndex, amount);
-            auto const toWriteSamples = toWrite * 2;
-            std::copy_n(buf, toWriteSamples, dest);
-            amount -= toWrite;
-            mIndex += toWrite;
-
-            if (mIndex == mBufferSize) {
-                mIndex = 0;
-                dest = mBufferData.get();
-            } else {
-                dest += toWriteSamples;
-            }
+    if (mHistory.empty()) {
+        return;
+    }
 
-            if (amount > 0) {
-                buf += toWriteSamples;
-            } else {
-                break;
-            }
+    buf += ignoring * 2;
+    for (size_t i = 0; i < amount; ++i) {
+        auto const left = *buf++;
+        auto const right = *buf++;
+        push(0, { left, left, left }, { right, right, right });
+    }
+}
+
+void VisualizerBuffer::push(int level, VisualizerPeak left, VisualizerPeak right) {
+    int const levels = (int)mHistory.size();
+    for (;;) {
+        auto &history = mHistory[level];
+        history.bins[0][history.index] = left;
+        history.bins[1][history.index] = right;
+        if (++history.index == history.bins[0].size()) {
+            history.index = 0;
+        }
+
+        if (++level == levels) {
+            break;
         }
 
+        // every two bins pushed to this level completes a bin in the next
+        auto &next = mHistory[level];
+        if (!next.hasPartial) {
+            next.partial[0] = left;
+            next.partial[1] = right;
+            next.hasPartial = true;
+            break;
+        }
+        next.hasPartial = false;
+        left = combine(next.partial[0], left);
+        right = combine(next.partial[1], right);
     }
+}
+
+void VisualizerBuffer::publish() {
+    auto &frame = mFrames[mBack];
+    for (int i = 0; i < (int)mHistory.size(); ++i) {
+        auto const &history = mHistory[i];
+        for (int ch = 0; ch < 2; ++ch) {
+            auto const &bins = history.bins[ch];
+            // unrotate, oldest bin first
+            std::rotate_copy(
+                bins.begin(),
+                bins.begin() + history.index,
+                bins.end(),
+                frame.levelData(i, ch)
+            );
+        }
+    }
+
+    // hand the back frame to the reader and take the one in transit
+    mBack = mMiddle.exchange(mBack | NEW_DATA, std::memory_order_acq_rel) & INDEX_MASK;
+}
+
+VisualizerFrame const& VisualizerBuffer::read() {
+    if (mMiddle.load(std::memory_order_relaxed) & NEW_DATA) {
+        mFront = mMiddle.exchange(mFront, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+    return mFrames[mFront];
+}
 
+bool VisualizerBuffer::hasNewData() const {
+    return mMiddle.load(std::memory_order_relaxed) & NEW_DATA;
 }
@@ -1,31 +1,92 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <cstdint>
-#include <memory>
+#include <cstddef>
+#include <vector>
 
 
 //
-// Audio buffer for visualizers.
-// 
-// 
-// The buffer is a rotating sample buffer, with newest data at the end of the buffer
-// The index determines the starting and ending position of the buffer
-// 
-// 0 0 0 0 0
-// ^
-// 
-// write A B C to the buffer (0 is now the oldest, C is the newest)
-// 
-// A B C 0 0
-//       ^
-// 
-// write D E F to the buffer (B is now the oldest, F is the newest)
-// 
-// F B C D E
-//   ^
-// 
-// When the index gets to the end of the buffer, it wraps (rotates) to the start
-// The index points to the oldest sample in the buffer, the sample before it is the newest.
+// Summary of a bin of samples for a single channel
+//
+struct VisualizerPeak {
+    int16_t min;
+    int16_t max;
+    int16_t mean;
+};
+
+//
+// A published view of the most recent samples, oldest first. The frame is
+// organized as a pyramid of levels: level 0 contains the samples themselves
+// (min == max == mean) and each level after it halves the number of bins by
+// combining two bins from the previous level. A visualizer can then pick
+// the level closest to its samples per pixel ratio and read one bin per pixel.
+//
+class VisualizerFrame {
+
+public:
+
+    static constexpr int MAX_LEVELS = 8;
+
+    VisualizerFrame();
+
+    //
+    // Number of samples in the frame (the size of level 0)
+    //
+    size_t size() const noexcept;
+
+    int levels() const noexcept;
+
+    //
+    // Number of bins in the given level, size() >> level
+    //
+    size_t levelSize(int level) const noexcept;
+
+    //
+    // Gets the bins of a level for the given channel, 0 for left and 1 for
+    // right. The returned pointer has levelSize(level) bins.
+    //
+    VisualizerPeak const* level(int level, int channel) const noexcept;
+
+    //
+    // Selects the coarsest level whose bins are no wider than the given
+    // number of samples.
+    //
+    int levelFor(float samplesPerBin) const noexcept;
+
+private:
+
+    friend class VisualizerBuffer;
+
+    void resize(size_t size, int levels);
+
+    VisualizerPeak* levelData(int level, int channel) noexcept;
+
+    size_t mSize;
+    int mLevels;
+    // offset of each level in mData, levels are stored left then right
+    std::array<size_t, MAX_LEVELS> mOffsets;
+    std::vector<VisualizerPeak> mData;
+
+};
+
+//
+// Transports audio from the render thread to visualizers without locking.
+//
+// The writer (render thread) keeps a rotating history of the most recent
+// samples along with a rotating history for each level of the peak pyramid.
+// Levels are updated incrementally as samples are written, so publishing
+// only needs to linearize the histories into a VisualizerFrame.
+//
+// Frames are exchanged through a triple buffer: the writer owns one frame,
+// the reader owns another, and the third is swapped atomically between
+// them. Neither side ever waits on the other, the reader always gets the
+// latest published frame and the writer never blocks the audio thread.
+//
+// Writer functions (clear, resize, beginWrite, write, publish) must only be
+// called by one thread at a time, the thread that owns the render context.
+// read() must only be called by a single reader thread (the GUI).
 //
 class VisualizerBuffer {
 
@@ -33,21 +94,19 @@ public:
     VisualizerBuffer();
     ~VisualizerBuffer() = default;
 
+    //
+    // Clears the history and publishes a silent frame.
+    //
     void clear();
 
+    //
+    // Sets the number of samples to keep. Resizing clears the buffer. Must
+    // not be called while the reader is using a frame.
+    //
     void resize(size_t size);
 
     size_t size() const;
 
-    void read(size_t index, int16_t &outLeft, int16_t &outRight);
-
-    //
-    // Computes the average left and right samples for the given index and bin
-    // size. Bin size refers to the ratio of samples per pixel. ie, a bin size
-    // of 2.5 means that 2.5 samples are represented by a single pixel.
-    //
-    void averageSample(float index, float bin, float &outLeft, float &outRight);
-
     //
     // Begin a write operation. If amount is greater than this buffer's
     // capacity, then some of the data written when calling write will
@@ -57,16 +116,52 @@ public:
     //
     void beginWrite(size_t amount);
 
-    void write(int16_t buf[], size_t amount);
+    void write(int16_t const buf[], size_t amount);
+
+    //
+    // Makes the samples written so far available to the reader.
+    //
+    void publish();
+
+    //
+    // Reader side. Gets the most recently published frame, which remains
+    // valid until the next call to read().
+    //
+    VisualizerFrame const& read();
 
+    //
+    // Reader side. Determines if a frame was published since the last read().
+    //
+    bool hasNewData() const;
 
 private:
 
-    std::unique_ptr<int16_t[]> mBufferData;
-    size_t mBufferSize;
+    static constexpr int NEW_DATA = 4;
+    static constexpr int INDEX_MASK = 3;
 
-    size_t mIndex;
+    //
+    // Rotating history of bins for a level, the index points to the oldest
+    // bin. Levels after 0 also accumulate a partial bin from the level below.
+    //
+    struct Level {
+        std::vector<VisualizerPeak> bins[2];
+        size_t index;
+        VisualizerPeak partial[2];
+        bool hasPartial;
+    };
+
+    void push(int level, VisualizerPeak left, VisualizerPeak right);
 
+    size_t mBufferSize;
     size_t mIgnoreCounter;
+    std::vector<Level> mHistory;
+
+    std::array<VisualizerFrame, 3> mFrames;
+    // frame owned by the writer
+    int mBack;
+    // frame owned by the reader
+    int mFront;
+    // frame in transit, NEW_DATA is set when the writer has published to it
+    std::atomic_int mMiddle;
 
 };
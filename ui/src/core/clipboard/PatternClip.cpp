@@ -39,9 +39,9 @@
 //        0, 0, 0, 0        // row 4
 // }
 //
-// The clip can be restored to its original location, or moved (pasted) to a
-// new location. Pasting to a new location may result in a partial copy if the
-// clip goes out of bounds of the destination pattern.
+// The clip can be moved (pasted) to a new location. Pasting to a new location
+// may result in a partial copy if the clip goes out of bounds of the
+// destination pattern.
 // 
 //
 //
@@ -147,11 +147,6 @@ PatternSelection const& PatternClip::selection() {
     return mLocation;
 }
 
-void PatternClip::restore(trackerboy::Pattern &dest) const {
-    pasteImpl<false>(dest, std::nullopt);
-
-}
-
 void PatternClip::paste(trackerboy::Pattern &dest, PatternCursor pos, bool mix) const {
     if (mix) {
         pasteImpl<true>(dest, pos);
@@ -162,39 +157,30 @@ void PatternClip::paste(trackerboy::Pattern &dest, PatternCursor pos, bool mix)
 }
 
 template <bool tMix>
-void PatternClip::pasteImpl(trackerboy::Pattern &dest, std::optional<PatternCursor> pos) const {
+void PatternClip::pasteImpl(trackerboy::Pattern &dest, PatternCursor pos) const {
     
 
     auto bufAtRowStart = mData.get();
     auto iter = mLocation.iterator();
     auto const rowLength = getRowLength(iter);
     
-    int trackEnd, rowEnd, rowStart;
-
-    if (pos) {
-        auto destRegion = mLocation;
-        destRegion.moveTo(*pos);
+    auto destRegion = mLocation;
+    destRegion.moveTo(pos);
 
-        iter = destRegion.iterator();
+    iter = destRegion.iterator();
 
-        auto clipRowOffset = 0;
-        rowStart = iter.rowStart();
-        if (rowStart < 0) {
-            clipRowOffset = -rowStart;
-            rowStart = 0;
-        }
-        rowEnd = std::min((int)dest.size() - 1, iter.rowEnd());
-        trackEnd = std::min(iter.trackEnd(), PatternCursor::MAX_TRACKS - 1);
+    auto clipRowOffset = 0;
+    auto rowStart = iter.rowStart();
+    if (rowStart < 0) {
+        clipRowOffset = -rowStart;
+        rowStart = 0;
+    }
+    auto const rowEnd = std::min((int)dest.size() - 1, iter.rowEnd());
+    auto const trackEnd = std::min(iter.trackEnd(), PatternCursor::MAX_TRACKS - 1);
 
-        Q_ASSERT(rowStart <= rowEnd);
+    Q_ASSERT(rowStart <= rowEnd);
 
-        bufAtRowStart += (rowLength * clipRowOffset);
-    } else {
-        // no position to paste at given, paste at the source of the clip
-        trackEnd = iter.trackEnd();
-        rowEnd = iter.rowEnd();
-        rowStart = iter.rowStart();
-    }
+    bufAtRowStart += (rowLength * clipRowOffset);
 
     for (auto track = iter.trackStart(); track <= trackEnd; ++track) {
         auto const tmeta = iter.getTrackMeta(track);
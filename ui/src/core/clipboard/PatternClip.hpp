@@ -12,9 +12,9 @@
 //
 // Container class for clipped pattern data. A PatternSelection can be used to
 // store a copy of the pattern data within that selection. Once saved, the
-// clip can be moved to a new location or restored to its original location.
-// The clip can also be transferred to/from a QMimeData object, allowing it
-// to be put on the system's clipboard.
+// clip can be pasted to a location in a pattern. The clip can also be
+// transferred to/from a QMimeData object, allowing it to be put on the
+// system's clipboard.
 //
 class PatternClip {
 
@@ -46,11 +46,6 @@ public:
     //
     PatternSelection const& selection();
 
-    //
-    // Restores previously clipped data to the given pattern.
-    //
-    void restore(trackerboy::Pattern &dest) const;
-
     //
     // Pastes this clip's data at the given position. If mix is true, then
     // paste data will be mixed with the destination pattern data, or only
@@ -79,7 +74,7 @@ public:
 private:
 
     template <bool mix>
-    void pasteImpl(trackerboy::Pattern &dest, std::optional<PatternCursor> pos) const;
+    void pasteImpl(trackerboy::Pattern &dest, PatternCursor pos) const;
 
     std::unique_ptr<char[]> mData;
     PatternSelection mLocation;
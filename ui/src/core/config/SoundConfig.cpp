@@ -18,7 +18,9 @@ SoundConfig::SoundConfig() :
     mSamplerateIndex(4),
     mLatency(40),
     mPeriod(5),
-    mQuality(1)
+    mQuality(1),
+    mRenderMode(RenderMode::thread),
+    mAutoLatency(false)
 {
 }
 
@@ -50,6 +52,14 @@ int SoundConfig::quality() const {
     return mQuality;
 }
 
+SoundConfig::RenderMode SoundConfig::renderMode() const {
+    return mRenderMode;
+}
+
+bool SoundConfig::autoLatency() const {
+    return mAutoLatency;
+}
+
 void SoundConfig::setBackendIndex(int index) {
     if (index >= -1) {
         mBackendIndex = index;
@@ -105,6 +115,23 @@ void SoundConfig::setQuality(int quality) {
     mQuality = quality;
 }
 
+void SoundConfig::setRenderMode(RenderMode mode) {
+    switch (mode) {
+        case RenderMode::timer:
+        case RenderMode::thread:
+        case RenderMode::callback:
+            mRenderMode = mode;
+            break;
+        default:
+            qWarning() << TU::LOG_PREFIX << "invalid render mode";
+            break;
+    }
+}
+
+void SoundConfig::setAutoLatency(bool autoLatency) {
+    mAutoLatency = autoLatency;
+}
+
 void SoundConfig::readSettings(QSettings &settings) {
     settings.beginGroup(Keys::Sound);
 
@@ -151,6 +178,8 @@ void SoundConfig::readSettings(QSettings &settings) {
     setLatency(settings.value(Keys::latency, mLatency).toInt());
     setPeriod(settings.value(Keys::period, mPeriod).toInt());
     setQuality(settings.value(Keys::quality, mQuality).toInt());
+    setRenderMode(static_cast<RenderMode>(settings.value(Keys::renderMode, (int)mRenderMode).toInt()));
+    setAutoLatency(settings.value(Keys::autoLatency, mAutoLatency).toBool());
 
     settings.endGroup();
 }
@@ -177,6 +206,8 @@ void SoundConfig::writeSettings(QSettings &settings) const {
     settings.setValue(Keys::latency, mLatency);
     settings.setValue(Keys::period, mPeriod);
     settings.setValue(Keys::quality, mQuality);
+    settings.setValue(Keys::renderMode, (int)mRenderMode);
+    settings.setValue(Keys::autoLatency, mAutoLatency);
 
     settings.endGroup();
 }
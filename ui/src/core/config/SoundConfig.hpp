@@ -7,6 +7,16 @@
 class SoundConfig {
 
 public:
+
+    //
+    // Determines what drives the renderer
+    //
+    enum class RenderMode {
+        timer,      // poll the buffer every period
+        thread,     // render thread is woken by the device when the buffer is low
+        callback    // render inside the device's callback
+    };
+
     static constexpr int MIN_PERIOD = 1;
     static constexpr int MAX_PERIOD = 100;
 
@@ -26,6 +36,12 @@ public:
     int latency() const;
     int period() const;
     int quality() const;
+    RenderMode renderMode() const;
+    //
+    // When enabled, the latency is the maximum and the renderer adjusts the
+    // actual latency at runtime.
+    //
+    bool autoLatency() const;
 
     void setBackendIndex(int index);
 
@@ -40,6 +56,10 @@ public:
     void setPeriod(int period);
 
     void setQuality(int quality);
+
+    void setRenderMode(RenderMode mode);
+
+    void setAutoLatency(bool autoLatency);
     
     void readSettings(QSettings &settings);
 
@@ -53,4 +73,6 @@ private:
     int mLatency;                // latency, or internal buffer size, in milliseconds
     int mPeriod;                 // period, in milliseconds
     int mQuality;                // synthesizer quality setting
+    RenderMode mRenderMode;      // what drives the renderer
+    bool mAutoLatency;           // adapt latency at runtime, up to mLatency
 };
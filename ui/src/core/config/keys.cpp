@@ -29,6 +29,8 @@ QString const samplerate { QStringLiteral("samplerate") };
 QString const period { QStringLiteral("period") };
 QString const latency { QStringLiteral("latency") };
 QString const quality { QStringLiteral("quality") };
+QString const renderMode { QStringLiteral("renderMode") };
+QString const autoLatency { QStringLiteral("autoLatency") };
 QString const deviceId { QStringLiteral("deviceId") };
 
 }
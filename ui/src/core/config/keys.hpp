@@ -40,6 +40,8 @@ extern QString const samplerate;
 extern QString const period;
 extern QString const latency;
 extern QString const quality;
+extern QString const renderMode;
+extern QString const autoLatency;
 extern QString const deviceId;
 
 }
@@ -8,6 +8,8 @@
 
 #include <algorithm>
 #include <memory>
+#include <utility>
+#include <vector>
 
 PatternModel::PatternModel(Module &mod, SongModel &songModel, QObject *parent) :
     QObject(parent),
@@ -23,6 +25,7 @@ PatternModel::PatternModel(Module &mod, SongModel &songModel, QObject *parent) :
     mPatternPrev(),
     mPatternCurr(mod.song()->getPattern(0)),
     mPatternNext(),
+    mPatternSize(mPatternCurr.totalRows()),
     mHasSelection(false),
     mSelection()
 {
@@ -451,16 +454,20 @@ void PatternModel::setPatterns(int pattern, CursorChangeFlags &flags) {
     }
 
     // update the current pattern
-    auto oldsize = (int)mPatternCurr.totalRows();
     mPatternCurr = song->getPattern(pattern);
-    auto newsize = (int)mPatternCurr.totalRows();
+    updatePatternSize(flags);
 
-    if (oldsize != newsize) {
+    emit invalidated();
+}
+
+void PatternModel::updatePatternSize(CursorChangeFlags &flags) {
+    auto newsize = mPatternCurr.totalRows();
+
+    if (mPatternSize != newsize) {
+        mPatternSize = newsize;
         emit patternSizeChanged(newsize);
     }
 
-    emit invalidated();
-
     if (mCursor.row >= newsize) {
         mCursor.row = newsize - 1;
         flags |= CursorRowChanged;
@@ -494,7 +501,7 @@ int PatternModel::cursorEffectNo() {
     return (mCursor.column - PatternCursor::ColumnEffect1Type) / 3;
 }
 
-void PatternModel::invalidate(int pattern, bool updatePatterns) {
+void PatternModel::invalidate(int pattern) {
 
     // check if the pattern being invalidated is accessible
     bool isInvalid = (mCursorPattern == pattern) ||
@@ -502,17 +509,15 @@ void PatternModel::invalidate(int pattern, bool updatePatterns) {
                      (mPatternNext && pattern == mCursorPattern + 1);
 
     if (isInvalid) {
-        // pattern is now invalid, either reset the pattern accessors
-        // or send the invalidated signal
-        if (updatePatterns) {
-            // reset pattern accessors and invalidate
-            CursorChangeFlags flags = CursorUnchanged;
-            setPatterns(mCursorPattern, flags);
-            emitIfChanged(flags);
-        } else {
-            // views just need to redraw
-            emit invalidated();
+        // the pattern accessors stay valid and Pattern::totalRows is always
+        // up to date, but an edit to the current pattern may have added or
+        // removed a pattern jump effect, changing its size
+        CursorChangeFlags flags = CursorUnchanged;
+        if (pattern == mCursorPattern) {
+            updatePatternSize(flags);
         }
+        emit invalidated();
+        emitIfChanged(flags);
     }
 
 }
@@ -524,7 +529,7 @@ bool PatternModel::selectionDataIsEmpty() {
         for (auto track = iter.trackStart(); track <= iter.trackEnd(); ++track) {
             auto tmeta = iter.getTrackMeta(track);
             for (auto row = iter.rowStart(); row <= iter.rowEnd(); ++row) {
-                auto const& rowdata = mPatternCurr.getTrackRow(static_cast<trackerboy::ChType>(track), (uint16_t)row);
+                auto const& rowdata = std::as_const(mPatternCurr).getTrackRow(static_cast<trackerboy::ChType>(track), (uint16_t)row);
                 if (tmeta.hasColumn<PatternAnchor::SelectNote>()) {
                     if (rowdata.queryNote()) {
                         return false;
@@ -562,7 +567,7 @@ bool PatternModel::selectionDataIsEmpty() {
 }
 
 trackerboy::TrackRow const& PatternModel::cursorTrackRow() {
-    return mPatternCurr.getTrackRow(
+    return std::as_const(mPatternCurr).getTrackRow(
         static_cast<trackerboy::ChType>(mCursor.track),
         (uint16_t)mCursor.row
     );
@@ -589,14 +594,6 @@ static uint8_t replaceNibble(uint8_t value, uint8_t nibble, bool highNibble) {
     }
 }
 
-static constexpr bool effectTypeRequiresUpdate(trackerboy::EffectType type) {
-    // these effects shorten the length of a pattern which when set/removed
-    // will require a recount
-    return type == trackerboy::EffectType::patternHalt ||
-           type == trackerboy::EffectType::patternSkip ||
-           type == trackerboy::EffectType::patternGoto;
-}
-
 class TrackEditCmd : public QUndoCommand {
 
 protected:
@@ -628,31 +625,23 @@ public:
     }
 
 protected:
-    trackerboy::TrackRow& getRow() {
-        return mModel.source()->getRow(
-            static_cast<trackerboy::ChType>(mTrack),
-            mPattern,
-            (uint16_t)mRow
-        );
-    }
-
-    virtual bool edit(trackerboy::TrackRow &rowdata, uint8_t data) = 0;
+    virtual void edit(trackerboy::TrackRow &rowdata, uint8_t data) = 0;
 
 private:
     void setData(uint8_t data) {
-        auto &rowdata = mModel.source()->getRow(
-            static_cast<trackerboy::ChType>(mTrack),
-            mPattern,
-            (uint16_t)mRow
-        );
+        auto song = mModel.source();
+        auto const ch = static_cast<trackerboy::ChType>(mTrack);
+        // edit a copy and replace the row, so that the track can update its
+        // row count and jump row incrementally
+        auto rowdata = std::as_const(*song).getRow(ch, mPattern, (uint16_t)mRow);
+        edit(rowdata, data);
 
-        bool update;
         {
             auto ctx = mModel.mModule.edit();
-            update = edit(rowdata, data);
+            song->setRow(ch, mPattern, (uint16_t)mRow, rowdata);
         }
 
-        mModel.invalidate(mPattern, update);
+        mModel.invalidate(mPattern);
 
     }
 
@@ -663,9 +652,8 @@ class NoteEditCmd : public TrackEditCmd {
     using TrackEditCmd::TrackEditCmd;
 
 protected:
-    virtual bool edit(trackerboy::TrackRow &rowdata, uint8_t data) override {
+    virtual void edit(trackerboy::TrackRow &rowdata, uint8_t data) override {
         rowdata.note = data;
-        return false;
     }
 };
 
@@ -674,9 +662,8 @@ class InstrumentEditCmd : public TrackEditCmd {
     using TrackEditCmd::TrackEditCmd;
 
 protected:
-    virtual bool edit(trackerboy::TrackRow &rowdata, uint8_t data) override {
+    virtual void edit(trackerboy::TrackRow &rowdata, uint8_t data) override {
         rowdata.instrumentId = data;
-        return false;
     }
 
 };
@@ -699,12 +686,8 @@ class EffectTypeEditCmd : public EffectEditCmd {
     using EffectEditCmd::EffectEditCmd;
 
 protected:
-    virtual bool edit(trackerboy::TrackRow &rowdata, uint8_t data) override {
-        auto &effect = rowdata.effects[mEffectNo];
-        auto oldtype = effect.type;
-        auto type = static_cast<trackerboy::EffectType>(data);
-        effect.type = type;
-        return effectTypeRequiresUpdate(type) || effectTypeRequiresUpdate(oldtype);
+    virtual void edit(trackerboy::TrackRow &rowdata, uint8_t data) override {
+        rowdata.effects[mEffectNo].type = static_cast<trackerboy::EffectType>(data);
     }
 
 };
@@ -714,37 +697,87 @@ class EffectParamEditCmd : public EffectEditCmd {
     using EffectEditCmd::EffectEditCmd;
 
 protected:
-    virtual bool edit(trackerboy::TrackRow &rowdata, uint8_t data) override {
+    virtual void edit(trackerboy::TrackRow &rowdata, uint8_t data) override {
         rowdata.effects[mEffectNo].param = data;
-        return false;
     }
 
 };
 
 
+//
+// Undo data for commands that modify a range of tracks in a pattern. Tracks
+// are copy-on-write, so saving only copies a reference to each track's rows
+// and the rows are physically copied when the command first modifies them.
+// The tracks are restored by id, so the snapshot is unaffected by changes to
+// the order.
+//
+class TrackSnapshot {
+
+public:
+    TrackSnapshot() :
+        mTracks()
+    {
+    }
+
+    void save(trackerboy::Song &song, int pattern, int trackStart, int trackEnd) {
+        auto const& ids = song.order()[pattern];
+        auto &master = song.patterns();
+        mTracks.clear();
+        for (auto track = trackStart; track <= trackEnd; ++track) {
+            auto const ch = static_cast<trackerboy::ChType>(track);
+            auto const id = ids[track];
+            mTracks.push_back({ ch, id, master.getTrack(ch, id) });
+        }
+    }
+
+    void restore(trackerboy::Song &song) const {
+        auto &master = song.patterns();
+        for (auto const& saved : mTracks) {
+            auto &track = master.getTrack(saved.ch, saved.id);
+            track = saved.track;
+            // the pattern size may have changed since the snapshot
+            if (track.size() != master.rowSize()) {
+                track.resize(master.rowSize());
+            }
+        }
+    }
+
+private:
+    struct SavedTrack {
+        trackerboy::ChType ch;
+        uint8_t id;
+        trackerboy::Track track;
+    };
+
+    std::vector<SavedTrack> mTracks;
+
+};
+
 class SelectionCmd : public QUndoCommand {
 
 protected:
     PatternModel &mModel;
     uint8_t mPattern;
-    PatternClip mClip;
+    PatternSelection mSelection;
+    TrackSnapshot mPast;
 
     explicit SelectionCmd(PatternModel &model) :
         mModel(model),
         mPattern((uint8_t)model.mCursorPattern),
-        mClip()
+        mSelection(model.mSelection),
+        mPast()
     {
-        mClip.save(model.mPatternCurr, model.mSelection);
+        auto iter = mSelection.iterator();
+        mPast.save(*model.source(), mPattern, iter.trackStart(), iter.trackEnd());
     }
 
-    void restore(bool update) {
-        auto pattern = mModel.source()->getPattern(mPattern);
+    void restore() {
         {
             auto ctx = mModel.mModule.edit();
-            mClip.restore(pattern);
+            mPast.restore(*mModel.source());
         }
 
-        mModel.invalidate(mPattern, update);
+        mModel.invalidate(mPattern);
     }
 
 };
@@ -762,7 +795,7 @@ public:
         {
             auto ctx = mModel.mModule.edit();
             // clear all set data in the selection
-            auto iter = mClip.selection().iterator();
+            auto iter = mSelection.iterator();
             auto pattern = mModel.source()->getPattern(mPattern);
 
             for (auto track = iter.trackStart(); track <= iter.trackEnd(); ++track) {
@@ -793,11 +826,11 @@ public:
 
         }
 
-        mModel.invalidate(mPattern, true);
+        mModel.invalidate(mPattern);
     }
 
     virtual void undo() override {
-        restore(true);
+        restore();
     }
 
 
@@ -807,7 +840,7 @@ class PasteCmd : public QUndoCommand {
 
     PatternModel &mModel;
     PatternClip mSrc;
-    PatternClip mPast;
+    TrackSnapshot mPast;
     PatternCursor mPos;
     uint8_t mPattern;
     bool mMix;
@@ -825,7 +858,8 @@ public:
         auto region = mSrc.selection();
         region.moveTo(pos);
         region.clamp(model.mPatternCurr.size() - 1);
-        mPast.save(model.mPatternCurr, region);
+        auto iter = region.iterator();
+        mPast.save(*model.source(), mPattern, iter.trackStart(), iter.trackEnd());
     }
 
     virtual void redo() override {
@@ -835,17 +869,16 @@ public:
             mSrc.paste(pattern, mPos, mMix);
         }
 
-        mModel.invalidate(mPattern, true);
+        mModel.invalidate(mPattern);
     }
 
     virtual void undo() override {
         {
             auto ctx = mModel.mModule.edit();
-            auto pattern = mModel.source()->getPattern(mPattern);
-            mPast.restore(pattern);
+            mPast.restore(*mModel.source());
         }
 
-        mModel.invalidate(mPattern, true);
+        mModel.invalidate(mPattern);
     }
 
 };
@@ -866,7 +899,7 @@ public:
     virtual void redo() override {
         {
             auto ctx = mModel.mModule.edit();
-            auto iter = mClip.selection().iterator();
+            auto iter = mSelection.iterator();
             auto pattern = mModel.source()->getPattern(mPattern);
 
             for (auto track = iter.trackStart(); track <= iter.trackEnd(); ++track) {
@@ -882,11 +915,11 @@ public:
             }
         }
 
-        mModel.invalidate(mPattern, false);
+        mModel.invalidate(mPattern);
     }
 
     virtual void undo() override {
-        restore(false);
+        restore();
     }
 
 };
@@ -960,7 +993,7 @@ private:
                 }
             }
         }
-        mModel.invalidate(mPattern, true);
+        mModel.invalidate(mPattern);
     }
 
 };
@@ -234,6 +234,12 @@ private:
     void setPatterns(int pattern, CursorChangeFlags &flags);
     void setPreviewPatterns(int pattern);
 
+    //
+    // Emits patternSizeChanged if the current pattern's size changed, and
+    // clamps the cursor row to the new size.
+    //
+    void updatePatternSize(CursorChangeFlags &flags);
+
     void emitIfChanged(CursorChangeFlags flags);
 
     int cursorEffectNo();
@@ -248,7 +254,7 @@ private:
 
     trackerboy::TrackRow const& cursorTrackRow();
 
-    void invalidate(int pattern, bool updatePatterns);
+    void invalidate(int pattern);
 
     bool selectionDataIsEmpty();
 
@@ -268,6 +274,8 @@ private:
     std::optional<trackerboy::Pattern> mPatternPrev;
     trackerboy::Pattern mPatternCurr;
     std::optional<trackerboy::Pattern> mPatternNext;
+    // last known size of the current pattern, for detecting size changes
+    int mPatternSize;
 
     bool mHasSelection;
     PatternSelection mSelection;
@@ -1,6 +1,8 @@
 
 #include "core/model/graph/WaveModel.hpp"
 
+#include <utility>
+
 WaveModel::WaveModel(Module &mod, QObject *parent) :
     GraphModel(mod, parent),
     mWaveform(nullptr)
@@ -27,7 +29,8 @@ struct WaveIndex {
 WaveModel::DataType WaveModel::dataAt(int i) {
     WaveIndex wi(i);
 
-    auto samplepair = mWaveform->operator[](wi.index);
+    // read through const so that the content generation is not changed
+    auto samplepair = std::as_const(*mWaveform)[wi.index];
     if (wi.isLowNibble) {
         return (DataType)(samplepair & 0xF);
     } else {
@@ -4,8 +4,21 @@
 #include <QTime>
 #include <QTimerEvent>
 
+#include <algorithm>
+
 constexpr int DEFAULT_REFRESH_INTERVAL = 100;
 
+namespace {
+
+QString timingText(RenderStats::Timing const& timing) {
+    using Micros = std::chrono::duration<double, std::micro>;
+    return AudioDiagDialog::tr("%1 us (peak %2 us)")
+        .arg(Micros(timing.last).count(), 0, 'f', 1)
+        .arg(Micros(timing.peak).count(), 0, 'f', 1);
+}
+
+}
+
 AudioDiagDialog::AudioDiagDialog(Renderer &renderer, QWidget *parent) :
     QDialog(parent, Qt::WindowTitleHint | Qt::WindowSystemMenuHint | Qt::WindowCloseButtonHint),
     mRenderer(renderer),
@@ -15,11 +28,19 @@ AudioDiagDialog::AudioDiagDialog(Renderer &renderer, QWidget *parent) :
     mRenderLayout(),
     mUnderrunLabel(),
     mBufferProgress(),
+    mTargetLabel(),
     mStatusLabel(),
     mElapsedLabel(),
     mPeriodLabel(),
     mPeriodWrittenLabel(),
     mClearButton(tr("Clear")),
+    mTimingGroup(tr("Render timing")),
+    mTimingLayout(),
+    mStageLabels(),
+    mTotalLabel(),
+    mLoadProgress(),
+    mPeakLoadLabel(),
+    mHistogramLabel(),
     mButtonLayout(),
     mAutoRefreshCheck(tr("Auto refresh")),
     mIntervalSpin(),
@@ -28,13 +49,27 @@ AudioDiagDialog::AudioDiagDialog(Renderer &renderer, QWidget *parent) :
 {
     mRenderLayout.addRow(tr("Underruns"), &mUnderrunLabel);
     mRenderLayout.addRow(tr("Buffer usage"), &mBufferProgress);
+    mRenderLayout.addRow(tr("Fill target"), &mTargetLabel);
     mRenderLayout.addRow(tr("Status"), &mStatusLabel);
     mRenderLayout.addRow(tr("Elapsed"), &mElapsedLabel);
     mRenderLayout.addRow(tr("Refresh rate"), &mPeriodLabel);
     mRenderLayout.addRow(tr("Samples written"), &mPeriodWrittenLabel);
-    mRenderLayout.setWidget(6, QFormLayout::LabelRole, &mClearButton);
+    mRenderLayout.setWidget(7, QFormLayout::LabelRole, &mClearButton);
     mRenderGroup.setLayout(&mRenderLayout);
 
+    // same order as RenderStats::Stage
+    mTimingLayout.addRow(tr("Engine"), &mStageLabels[0]);
+    mTimingLayout.addRow(tr("Preview"), &mStageLabels[1]);
+    mTimingLayout.addRow(tr("Synth"), &mStageLabels[2]);
+    mTimingLayout.addRow(tr("Buffer copy"), &mStageLabels[3]);
+    mTimingLayout.addRow(tr("Visualizer"), &mStageLabels[4]);
+    mTimingLayout.addRow(tr("Lock wait"), &mStageLabels[5]);
+    mTimingLayout.addRow(tr("Total"), &mTotalLabel);
+    mTimingLayout.addRow(tr("DSP load"), &mLoadProgress);
+    mTimingLayout.addRow(tr("Peak load"), &mPeakLoadLabel);
+    mTimingLayout.addRow(tr("Load histogram"), &mHistogramLabel);
+    mTimingGroup.setLayout(&mTimingLayout);
+
     mButtonLayout.addWidget(&mAutoRefreshCheck);
     mButtonLayout.addWidget(&mIntervalSpin);
     mButtonLayout.addWidget(&mRefreshButton);
@@ -42,6 +77,7 @@ AudioDiagDialog::AudioDiagDialog(Renderer &renderer, QWidget *parent) :
     mButtonLayout.addWidget(&mCloseButton);
 
     mLayout.addWidget(&mRenderGroup, 1);
+    mLayout.addWidget(&mTimingGroup, 1);
     mLayout.addLayout(&mButtonLayout);
     mLayout.setSizeConstraint(QLayout::SizeConstraint::SetFixedSize);
     setLayout(&mLayout);
@@ -55,6 +91,11 @@ AudioDiagDialog::AudioDiagDialog(Renderer &renderer, QWidget *parent) :
     mBufferProgress.setAlignment(Qt::AlignCenter);
     mBufferProgress.setFormat(tr("%p% (%v / %m samples)"));
 
+    mLoadProgress.setAlignment(Qt::AlignCenter);
+    mLoadProgress.setRange(0, 100);
+    mLoadProgress.setFormat(tr("%p%"));
+    mHistogramLabel.setToolTip(tr("DSP load of the last %1 renders, from 0% to 100% or more in 10% steps").arg(RenderStats::HISTORY));
+
     mCloseButton.setDefault(true);
 
     setWindowTitle(tr("Audio diagnostics"));
@@ -119,6 +160,7 @@ void AudioDiagDialog::refresh() {
 
     mBufferProgress.setMaximum((int)diags.bufferSize);
     mBufferProgress.setValue((int)diags.bufferUse);
+    mTargetLabel.setText(tr("%1 / %2 samples").arg(diags.fillTarget).arg(diags.bufferSize));
     /*mBufferLabel.setText(tr("%1% (%2 / %3 samples)")
         .arg(diags.bufferUse * 100 / diags.bufferSize)
         .arg(diags.bufferUse)
@@ -138,4 +180,28 @@ void AudioDiagDialog::refresh() {
     double periodMs = std::chrono::duration<double>(diags.lastPeriod).count() * 1000.0;
     mPeriodLabel.setText(tr("%1 ms").arg(periodMs, 0, 'f', 3));
     mPeriodWrittenLabel.setText(QString::number(diags.writesSinceLastPeriod));
+
+    auto const& stats = diags.stats;
+    for (size_t i = 0; i < RenderStats::STAGES; ++i) {
+        mStageLabels[i].setText(timingText(stats.stages[i]));
+    }
+    mTotalLabel.setText(timingText(stats.total));
+    mLoadProgress.setValue(std::min(100, (int)(stats.load * 100.0f)));
+    mPeakLoadLabel.setText(tr("%1%").arg(stats.peakLoad * 100.0f, 0, 'f', 1));
+
+    // one bar per bin, scaled to the fullest bin
+    static constexpr QChar BARS[] = {
+        QChar(0x2581), QChar(0x2582), QChar(0x2583), QChar(0x2584),
+        QChar(0x2585), QChar(0x2586), QChar(0x2587), QChar(0x2588)
+    };
+    auto const fullest = *std::max_element(stats.histogram.begin(), stats.histogram.end());
+    QString histogram;
+    for (auto count : stats.histogram) {
+        if (count == 0) {
+            histogram += QChar(' ');
+        } else {
+            histogram += BARS[std::min(7u, count * 8 / (fullest + 1))];
+        }
+    }
+    mHistogramLabel.setText(histogram);
 }
@@ -14,6 +14,8 @@
 #include <QPushButton>
 #include <QSpinBox>
 
+#include <array>
+
 //
 // Audio diagnostics dialog. Shows stats about the Renderer and detailed device information
 //
@@ -49,11 +51,19 @@ private:
                 QLabel mUnderrunLabel;
                 //QLabel mBufferLabel;
                 QProgressBar mBufferProgress;
+                QLabel mTargetLabel;
                 QLabel mStatusLabel;
                 QLabel mElapsedLabel;
                 QLabel mPeriodLabel;
                 QLabel mPeriodWrittenLabel;
                 QPushButton mClearButton;
+        QGroupBox mTimingGroup;
+            QFormLayout mTimingLayout;
+                std::array<QLabel, RenderStats::STAGES> mStageLabels;
+                QLabel mTotalLabel;
+                QProgressBar mLoadProgress;
+                QLabel mPeakLoadLabel;
+                QLabel mHistogramLabel;
         QHBoxLayout mButtonLayout;
             QCheckBox mAutoRefreshCheck;
             QSpinBox mIntervalSpin;
@@ -35,7 +35,9 @@ ExportWavDialog::ExportWavDialog(
     mStatusLabel(),
     mButtons(),
     mExportButton(nullptr),
-    mExporter(nullptr),
+    mExporters(),
+    mExporterProgress(),
+    mExportersRunning(0),
     mTimeEditDuration(60)
 {
     setModal(true);
@@ -56,6 +58,7 @@ ExportWavDialog::ExportWavDialog(
         mChannelSelectLayout.addWidget(&check);
         connect(&check, &QCheckBox::toggled, this,
             [this](bool toggled) {
+                updateExportButton();
                 if (toggled) {
                     for (auto &box : mChannelChecks) {
                         box.setEnabled(true);
@@ -101,9 +104,6 @@ ExportWavDialog::ExportWavDialog(
     mTimeEdit.setInputMask(QStringLiteral("99:99"));
     mTimeEdit.setMaxLength(5);
     mProgress.setAlignment(Qt::AlignVCenter | Qt::AlignHCenter);
-    
-    // disable this group since individual channel selection is not implemented at this time
-    mChannelGroup.setEnabled(false);
 
     mExportButton = mButtons.addButton(tr("Export"), QDialogButtonBox::AcceptRole);
     mExportButton->setEnabled(false);
@@ -149,8 +149,8 @@ ExportWavDialog::ExportWavDialog(
         });
 
     connect(&mFilenameEdit, &QLineEdit::textChanged, this,
-        [this](QString const& str) {
-            mExportButton->setEnabled(!str.isEmpty());
+        [this]() {
+            updateExportButton();
         });
 
     connect(&mBrowseButton, &QPushButton::clicked, this,
@@ -183,42 +183,90 @@ ExportWavDialog::ExportWavDialog(
 
 void ExportWavDialog::accept() {
     // begin the export
-    bool isExporting = false;
-    if (mExporter && mExporter->isRunning()) {
-        isExporting = true;
-    }
-
-    if (!isExporting) {
-        if (mExporter == nullptr) {
-            mExporter = new WavExporter(mModule, mSamplerate, this);
-            connect(mExporter, &WavExporter::progressMax, &mProgress, &QProgressBar::setMaximum);
-            connect(mExporter, &WavExporter::progress, &mProgress, &QProgressBar::setValue);
-            connect(mExporter, &WavExporter::finished, this,
-                [this]() {
-                    if (mExporter->failed()) {
-                        mStatusLabel.setText(tr("Export failed"));
-                    } else {
-                        mProgress.setValue(mProgress.maximum());
-                        mStatusLabel.setText(tr("Export complete"));
-                    }
-                    mExportButton->setEnabled(true);
-                    setGroupsEnabled(true);
-                });
-        }
+    if (!isExporting() && hasChannels()) {
 
+        trackerboy::Player::Duration duration;
         if (mLoopRadio.isChecked()) {
-            mExporter->setDuration(mLoopSpin.value());
+            duration = mLoopSpin.value();
         } else {
-            mExporter->setDuration(std::chrono::seconds(mTimeEditDuration));
+            duration = std::chrono::seconds(mTimeEditDuration);
         }
 
-        mExporter->setDestination(mFilenameEdit.text());
+        auto const separate = mSeparateChannelsCheck.isChecked();
+        auto const filename = mFilenameEdit.text();
+
+        // the exporters are recreated for each export, as each one has its own
+        // engine and synth
+        for (auto &exporter : mExporters) {
+            delete exporter;
+            exporter = nullptr;
+        }
+        mExporterProgress.fill(0);
+
+        int jobs = 0;
+        for (int i = 0; i != (int)mExporters.size(); ++i) {
+            if (separate && !mChannelChecks[i].isChecked()) {
+                continue;
+            }
+
+            auto exporter = new WavExporter(mModule, mSamplerate, this);
+            exporter->setDuration(duration);
+            if (separate) {
+                // stem export, this exporter only renders channel i
+                for (int ch = 0; ch != (int)mChannelChecks.size(); ++ch) {
+                    exporter->setChannelEnabled(static_cast<trackerboy::ChType>(ch), ch == i);
+                }
+                exporter->setDestination(stemFilename(filename, i + 1));
+            } else {
+                for (int ch = 0; ch != (int)mChannelChecks.size(); ++ch) {
+                    exporter->setChannelEnabled(static_cast<trackerboy::ChType>(ch), mChannelChecks[ch].isChecked());
+                }
+                exporter->setDestination(filename);
+            }
+
+            // each exporter has the same song and duration, so the total
+            // progress is the sum of each exporter's progress
+            connect(exporter, &WavExporter::progressMax, this,
+                [this](int max) {
+                    int jobCount = 0;
+                    for (auto exporter : mExporters) {
+                        if (exporter) {
+                            ++jobCount;
+                        }
+                    }
+                    mProgress.setMaximum(max * jobCount);
+                });
+            connect(exporter, &WavExporter::progress, this,
+                [this, i](int amount) {
+                    mExporterProgress[i] = amount;
+                    int total = 0;
+                    for (auto value : mExporterProgress) {
+                        total += value;
+                    }
+                    mProgress.setValue(total);
+                });
+            connect(exporter, &WavExporter::finished, this, &ExportWavDialog::exporterFinished);
+
+            mExporters[i] = exporter;
+            ++jobs;
+
+            if (!separate) {
+                break;
+            }
+        }
 
         mStatusLabel.setText(tr("Exporting..."));
         mProgress.setValue(0);
         setGroupsEnabled(false);
-        mExporter->start();
         mExportButton->setEnabled(false);
+
+        // start all exporters at once, they each render on their own thread
+        mExportersRunning = jobs;
+        for (auto exporter : mExporters) {
+            if (exporter) {
+                exporter->start();
+            }
+        }
     }
 
     // don't call QDialog::accept, we want to keep the dialog open until the user
@@ -227,9 +275,15 @@ void ExportWavDialog::accept() {
 
 void ExportWavDialog::reject() {
     // cancel the current export if there is one in progress
-    if (mExporter && mExporter->isRunning()) {
-        mExporter->cancel();
-        mExporter->wait();
+    for (auto exporter : mExporters) {
+        if (exporter && exporter->isRunning()) {
+            exporter->cancel();
+        }
+    }
+    for (auto exporter : mExporters) {
+        if (exporter) {
+            exporter->wait();
+        }
     }
 
     QDialog::reject();
@@ -237,5 +291,59 @@ void ExportWavDialog::reject() {
 
 void ExportWavDialog::setGroupsEnabled(bool enabled) {
     mDurationGroup.setEnabled(enabled);
+    mChannelGroup.setEnabled(enabled);
     mDestinationGroup.setEnabled(enabled);
 }
+
+bool ExportWavDialog::isExporting() const {
+    return mExportersRunning != 0;
+}
+
+void ExportWavDialog::exporterFinished() {
+    if (mExportersRunning == 0 || --mExportersRunning != 0) {
+        // still waiting on other exporters
+        return;
+    }
+
+    bool failed = false;
+    for (auto exporter : mExporters) {
+        if (exporter && exporter->failed()) {
+            failed = true;
+        }
+    }
+
+    if (failed) {
+        mStatusLabel.setText(tr("Export failed"));
+    } else {
+        mProgress.setValue(mProgress.maximum());
+        mStatusLabel.setText(tr("Export complete"));
+    }
+    updateExportButton();
+    setGroupsEnabled(true);
+}
+
+bool ExportWavDialog::hasChannels() const {
+    for (auto &check : mChannelChecks) {
+        if (check.isChecked()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ExportWavDialog::updateExportButton() {
+    mExportButton->setEnabled(!mFilenameEdit.text().isEmpty() && hasChannels());
+}
+
+QString ExportWavDialog::stemFilename(QString const& filename, int channel) {
+    // "song.wav" -> "song-ch1.wav"
+    QFileInfo info(filename);
+    auto suffix = info.suffix();
+    if (suffix.isEmpty()) {
+        suffix = QStringLiteral("wav");
+    }
+    return info.dir().filePath(QStringLiteral("%1-ch%2.%3")
+                                .arg(info.completeBaseName())
+                                .arg(channel)
+                                .arg(suffix));
+}
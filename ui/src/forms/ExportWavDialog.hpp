@@ -39,6 +39,29 @@ public:
 private:
     void setGroupsEnabled(bool enabled);
 
+    bool isExporting() const;
+
+    //
+    // Determines if at least one channel is selected for export
+    //
+    bool hasChannels() const;
+
+    //
+    // Enables the export button when there is a destination and at least one
+    // channel to export
+    //
+    void updateExportButton();
+
+    //
+    // Called when one of the exporters has finished
+    //
+    void exporterFinished();
+
+    //
+    // Determines the destination filename for the channel's stem
+    //
+    static QString stemFilename(QString const& filename, int channel);
+
     Module const& mModule;
     int mSamplerate;
 
@@ -66,7 +89,11 @@ private:
 
         QPushButton *mExportButton;
 
-    WavExporter *mExporter;
+    // one exporter per channel, only the first is used when not exporting
+    // channels separately
+    std::array<WavExporter*, 4> mExporters;
+    std::array<int, 4> mExporterProgress;
+    int mExportersRunning;
 
     unsigned mTimeEditDuration;
 
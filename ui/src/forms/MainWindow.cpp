@@ -448,7 +448,7 @@ void MainWindow::setupUi() {
     
     auto scope = mSidebar->scope();
     scope->setBuffer(&mRenderer->visualizerBuffer());
-    connect(mRenderer, &Renderer::updateVisualizers, scope, qOverload<>(&AudioScope::update));
+    connect(mRenderer, &Renderer::updateVisualizers, scope, &AudioScope::requestRepaint);
 
     lazyconnect(mRenderer, isPlayingChanged, mPatternModel, setPlaying);
 
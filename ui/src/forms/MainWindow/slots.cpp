@@ -347,8 +347,9 @@ void MainWindow::onFrameSync() {
 
     auto frame = mRenderer->currentFrame();
 
-    // check if the player position changed
-    if (frame.startedNewRow) {        
+    // check if the player position changed, frames are polled so the frame
+    // that started the row may have been skipped
+    if (frame.row != mLastEngineFrame.row || frame.order != mLastEngineFrame.order) {
         // update tracker position
         mPatternModel->setTrackerCursor(frame.row, frame.order);
 
@@ -29,6 +29,9 @@ SoundConfigTab::SoundConfigTab(QWidget *parent) :
     mPeriodSpin(),
     mSamplerateLabel(tr("Sample rate")),
     mSamplerateCombo(),
+    mRenderModeLabel(tr("Render mode")),
+    mRenderModeCombo(),
+    mAutoLatencyCheck(tr("Adaptive latency")),
     mQualityGroup(tr("Quality")),
     mQualityLayout(),
     mQualityRadioLayout(),
@@ -60,6 +63,9 @@ SoundConfigTab::SoundConfigTab(QWidget *parent) :
     mDeviceLayout.addWidget(&mPeriodSpin,       4, 1);
     mDeviceLayout.addWidget(&mSamplerateLabel,  5, 0);
     mDeviceLayout.addWidget(&mSamplerateCombo,  5, 1);
+    mDeviceLayout.addWidget(&mRenderModeLabel,  6, 0);
+    mDeviceLayout.addWidget(&mRenderModeCombo,  6, 1);
+    mDeviceLayout.addWidget(&mAutoLatencyCheck, 7, 0, 1, 2);
 
     mDeviceLayout.setColumnStretch(1, 1);
     mDeviceGroup.setLayout(&mDeviceLayout);
@@ -93,6 +99,16 @@ SoundConfigTab::SoundConfigTab(QWidget *parent) :
         mSamplerateCombo.addItem(tr("%1 Hz").arg(SAMPLERATE_TABLE[i]));
     }
 
+    // same order as SoundConfig::RenderMode
+    mRenderModeCombo.addItem(tr("Timer"));
+    mRenderModeCombo.addItem(tr("Render thread"));
+    mRenderModeCombo.addItem(tr("Audio callback"));
+    mRenderModeCombo.setItemData(0, tr("Polls the buffer every period"), Qt::ToolTipRole);
+    mRenderModeCombo.setItemData(1, tr("The device wakes the render thread when the buffer runs low"), Qt::ToolTipRole);
+    mRenderModeCombo.setItemData(2, tr("Synthesizes directly in the device's callback, lowest latency"), Qt::ToolTipRole);
+
+    mAutoLatencyCheck.setToolTip(tr("Lowers the latency at runtime until there are no underruns. The latency setting is used as the maximum."));
+
     setupTimeSpinbox(mLatencySpin);
     mLatencySpin.setMinimum(SoundConfig::MIN_LATENCY);
     mLatencySpin.setMaximum(SoundConfig::MAX_LATENCY);
@@ -116,6 +132,8 @@ SoundConfigTab::SoundConfigTab(QWidget *parent) :
     connect(&mDeviceCombo, qOverload<int>(&QComboBox::currentIndexChanged), this, &SoundConfigTab::onDeviceComboSelected);
     connect(&mLatencySpin, qOverload<int>(&QSpinBox::valueChanged), this, &SoundConfigTab::setDirty);
     connect(&mPeriodSpin, qOverload<int>(&QSpinBox::valueChanged), this, &SoundConfigTab::setDirty);
+    connect(&mRenderModeCombo, qOverload<int>(&QComboBox::activated), this, &SoundConfigTab::renderModeChanged);
+    connect(&mAutoLatencyCheck, &QCheckBox::toggled, this, &SoundConfigTab::setDirty);
     connect(&mQualityButtons, qOverload<QAbstractButton*, bool>(&QButtonGroup::buttonToggled), this, &SoundConfigTab::qualityRadioToggled);
     connect(&mRescanButton, &QPushButton::clicked, this, &SoundConfigTab::rescan);
 }
@@ -133,6 +151,8 @@ void SoundConfigTab::apply(SoundConfig &soundConfig) {
     soundConfig.setLatency(mLatencySpin.value());
     soundConfig.setPeriod(mPeriodSpin.value());
     soundConfig.setQuality(mQualityButtons.checkedId());
+    soundConfig.setRenderMode(static_cast<SoundConfig::RenderMode>(mRenderModeCombo.currentIndex()));
+    soundConfig.setAutoLatency(mAutoLatencyCheck.isChecked());
 
     clean();
 }
@@ -156,6 +176,12 @@ void SoundConfigTab::resetControls(SoundConfig const& soundConfig) {
     mLatencySpin.setValue(soundConfig.latency());
     mPeriodSpin.setValue(soundConfig.period());
     mQualityButtons.button(soundConfig.quality())->setChecked(true);
+    mRenderModeCombo.setCurrentIndex((int)soundConfig.renderMode());
+    // the period is only used by the timer
+    mPeriodSpin.setEnabled(soundConfig.renderMode() == SoundConfig::RenderMode::timer);
+    mAutoLatencyCheck.setChecked(soundConfig.autoLatency());
+    // the callback mode has no buffer to adapt
+    mAutoLatencyCheck.setEnabled(soundConfig.renderMode() != SoundConfig::RenderMode::callback);
 
     clean();
 }
@@ -169,6 +195,12 @@ void SoundConfigTab::qualityRadioToggled(QAbstractButton *btn, bool checked) {
     }
 }
 
+void SoundConfigTab::renderModeChanged(int index) {
+    mPeriodSpin.setEnabled(index == (int)SoundConfig::RenderMode::timer);
+    mAutoLatencyCheck.setEnabled(index != (int)SoundConfig::RenderMode::callback);
+    setDirty();
+}
+
 void SoundConfigTab::apiChanged(int index) {
     Q_UNUSED(index)
     rescan(true); // new api selected, pick the default device
@@ -47,6 +47,8 @@ private:
 
     void apiChanged(int index);
 
+    void renderModeChanged(int index);
+
     QVBoxLayout mLayout;
         QGroupBox mDeviceGroup;
             QGridLayout mDeviceLayout;
@@ -68,6 +70,11 @@ private:
                 // row 5
                 QLabel mSamplerateLabel;
                 QComboBox mSamplerateCombo;
+                // row 6
+                QLabel mRenderModeLabel;
+                QComboBox mRenderModeCombo;
+                // row 7
+                QCheckBox mAutoLatencyCheck;
         QGroupBox mQualityGroup;
             QVBoxLayout mQualityLayout;
                 QHBoxLayout mQualityRadioLayout;
@@ -2,12 +2,14 @@
 #include "widgets/sidebar/AudioScope.hpp"
 
 #include <QGuiApplication>
-#include <QMutexLocker>
 #include <QPainter>
 #include <QPen>
+#include <QScreen>
+#include <QWindow>
 
 #include <QtDebug>
 
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 
@@ -16,7 +18,11 @@ constexpr int LINE_WIDTH = 1;
 
 AudioScope::AudioScope(QWidget *parent) :
     QFrame(parent),
-    mBuffer(nullptr)
+    mBuffer(nullptr),
+    mRepaintTimer(),
+    mLastRepaint(),
+    mLeftLine(),
+    mRightLine()
 {
     setAttribute(Qt::WA_StyledBackground);
     setAutoFillBackground(true);
@@ -36,21 +42,37 @@ AudioScope::AudioScope(QWidget *parent) :
     setLineWidth(LINE_WIDTH);
     setFixedHeight(WAVE_HEIGHT * 2 + LINE_WIDTH * 2);
 
+    mRepaintTimer.setSingleShot(true);
+    mRepaintTimer.setTimerType(Qt::PreciseTimer);
+    connect(&mRepaintTimer, &QTimer::timeout, this, qOverload<>(&AudioScope::update));
+
 }
 
-void AudioScope::setBuffer(Guarded<VisualizerBuffer> *buffer) {
+void AudioScope::setBuffer(VisualizerBuffer *buffer) {
     if (buffer != mBuffer) {
         mBuffer = buffer;
         update();
     }
 }
 
+void AudioScope::requestRepaint() {
+    if (mRepaintTimer.isActive()) {
+        // already scheduled, the repaint will pick up the latest frame
+        return;
+    }
+
+    auto const interval = repaintInterval();
+    auto const elapsed = mLastRepaint.isValid() ? mLastRepaint.elapsed() : interval;
+    if (elapsed >= interval) {
+        update();
+    } else {
+        mRepaintTimer.start(interval - (int)elapsed);
+    }
+}
+
 void AudioScope::paintEvent(QPaintEvent *evt) {
     QFrame::paintEvent(evt);
-
-    // it may be more efficient to do renderering in a separate thread
-    // we can convert a sample buffer to a buffer of QLines, then
-    // the paint event just draws the lines
+    mLastRepaint.start();
 
     if (mBuffer == nullptr) {
         // no buffer, draw nothing
@@ -58,8 +80,9 @@ void AudioScope::paintEvent(QPaintEvent *evt) {
         return;
     }
 
-    auto handle = mBuffer->access();
-    auto size = handle->size();
+    // never blocks, the frame is ours until the next read
+    auto const& frame = mBuffer->read();
+    auto size = frame.size();
     if (size == 0) {
         // buffer is empty, draw nothing
         drawSilence();
@@ -67,36 +90,38 @@ void AudioScope::paintEvent(QPaintEvent *evt) {
     }
 
     auto const w = width() - (LINE_WIDTH * 2);
+    if (w <= 0) {
+        return;
+    }
     
     QPainter painter(this);
     painter.setRenderHint(QPainter::Antialiasing);
     painter.setPen(palette().color(QPalette::WindowText));
 
-    // pixels per sample
-    float ratio = (unsigned)size / (float)w;
+    // samples per pixel, use the pyramid level with bins closest to this
+    // ratio so that each pixel is a single lookup
+    float const ratio = (unsigned)size / (float)w;
+    int const level = frame.levelFor(ratio);
+    auto const binsLeft = frame.level(level, 0);
+    auto const binsRight = frame.level(level, 1);
+    auto const lastBin = frame.levelSize(level) - 1;
+    float const binRatio = ratio / (1 << level);
     float index = 0;
 
-    float prevLeft;
-    float prevRight;
-    sample(handle, 0.0f, ratio, prevLeft, prevRight);
-
-    int const end = w + LINE_WIDTH;
-    for (int t = 1 + LINE_WIDTH; t < end; ++t) {
-        index += ratio;
-        
-        float leftSample;
-        float rightSample;
-        sample(handle, index, ratio, leftSample, rightSample);
-
-        painter.drawLine(QLineF(t - 1, prevLeft, t, leftSample));
-        painter.drawLine(QLineF(t - 1, prevRight, t, rightSample));
-
-        prevLeft = leftSample;
-        prevRight = rightSample;
-
-        
+    // build each channel as a single polyline, so that antialiasing and
+    // stroking is done in one pass per channel instead of once per pixel
+    mLeftLine.resize(w);
+    mRightLine.resize(w);
+    for (int t = 0; t < w; ++t) {
+        auto const bin = std::min((size_t)index, lastBin);
+        float const x = (float)(t + LINE_WIDTH);
+        mLeftLine[t] = QPointF(x, toY(binsLeft[bin], WAVE_LEFT_AXIS));
+        mRightLine[t] = QPointF(x, toY(binsRight[bin], WAVE_RIGHT_AXIS));
+        index += binRatio;
     }
-    
+
+    painter.drawPolyline(mLeftLine);
+    painter.drawPolyline(mRightLine);
 }
 
 void AudioScope::drawSilence() {
@@ -108,10 +133,22 @@ void AudioScope::drawSilence() {
 
 }
 
-void AudioScope::sample(Locked<VisualizerBuffer> &handle, float index, float ratio, float &outLeft, float &outRight) {
-    float left, right;
-    handle->averageSample(index, ratio, left, right);
+float AudioScope::toY(VisualizerPeak const& peak, int axis) {
+    return axis - (peak.mean / (65536.0f / WAVE_HEIGHT));
+}
 
-    outLeft = WAVE_LEFT_AXIS - (left / (65536.0f / WAVE_HEIGHT));
-    outRight = WAVE_RIGHT_AXIS - (right / (65536.0f / WAVE_HEIGHT));
+int AudioScope::repaintInterval() const {
+    QScreen *screen = nullptr;
+    if (auto handle = window()->windowHandle(); handle != nullptr) {
+        screen = handle->screen();
+    }
+    if (screen == nullptr) {
+        screen = QGuiApplication::primaryScreen();
+    }
+
+    qreal rate = screen ? screen->refreshRate() : 0.0;
+    if (rate <= 0.0) {
+        rate = 60.0;
+    }
+    return std::max(1, (int)(1000.0 / rate));
 }
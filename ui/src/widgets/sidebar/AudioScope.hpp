@@ -2,12 +2,13 @@
 #pragma once
 
 
-#include "core/Guarded.hpp"
 #include "core/audio/VisualizerBuffer.hpp"
 
+#include <QElapsedTimer>
 #include <QFrame>
-#include <QMutex>
 #include <QPixmap>
+#include <QPolygonF>
+#include <QTimer>
 
 #include <array>
 #include <cstdint>
@@ -24,7 +25,15 @@ public:
     explicit AudioScope(QWidget *parent = nullptr);
 
 
-    void setBuffer(Guarded<VisualizerBuffer>* buffer);
+    void setBuffer(VisualizerBuffer *buffer);
+
+public slots:
+
+    //
+    // Schedules a repaint for new visualizer data. Requests are coalesced so
+    // that the scope is repainted at most once per display refresh.
+    //
+    void requestRepaint();
 
 protected:
 
@@ -35,7 +44,13 @@ private:
 
     void drawSilence();
 
-    void sample(Locked<VisualizerBuffer> &handle, float index, float ratio, float &outLeft, float &outRight);
+    static float toY(VisualizerPeak const& peak, int axis);
+
+    //
+    // Minimum time between repaints in milliseconds, from the refresh rate of
+    // the screen the scope is on.
+    //
+    int repaintInterval() const;
 
     static constexpr int WAVE_WIDTH = 160;
     static constexpr int WAVE_HEIGHT = 64;
@@ -44,7 +59,14 @@ private:
     static constexpr int WAVE_LEFT_AXIS = (WAVE_HEIGHT / 2) + 1;
     static constexpr int WAVE_RIGHT_AXIS = (WAVE_HEIGHT / 2) + WAVE_HEIGHT + 1;
 
-    Guarded<VisualizerBuffer> *mBuffer;
+    VisualizerBuffer *mBuffer;
+
+    QTimer mRepaintTimer;
+    QElapsedTimer mLastRepaint;
+
+    // reused between paints to avoid allocating
+    QPolygonF mLeftLine;
+    QPolygonF mRightLine;
 
 
 };
@@ -0,0 +1,163 @@
+//
+// Throughput benchmark for the audio ringbuffer. Compares the current
+// Ringbuffer (mirrored on Linux) against miniaudio's ma_rb, which it replaced.
+//
+// A producer thread writes blocks of a frame's worth of samples using the
+// acquire/commit interface, like Renderer::render. A consumer thread reads
+// them back in device sized chunks using a full read, like the audio
+// callback. Block sizes do not divide the buffer size, so transfers wrap.
+//
+
+#include "core/audio/Ringbuffer.hpp"
+
+#include "miniaudio.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t BUFFER_FRAMES = 1920;      // 40 ms at 48000 Hz
+constexpr size_t WRITE_FRAMES = 801;        // one frame of synth output
+constexpr size_t READ_FRAMES = 256;         // typical device period
+constexpr size_t TOTAL_FRAMES = 100000000;
+constexpr size_t FRAME_BYTES = sizeof(int16_t) * 2;
+
+using Clock = std::chrono::steady_clock;
+
+//
+// ma_rb with the same split read/write logic the old RingbufferBase had
+//
+class MaRingbuffer {
+
+public:
+    MaRingbuffer(size_t bytes) {
+        ma_rb_init(bytes, nullptr, nullptr, &mRb);
+    }
+
+    ~MaRingbuffer() {
+        ma_rb_uninit(&mRb);
+    }
+
+    int16_t* acquireWrite(size_t &frames) {
+        size_t bytes = frames * FRAME_BYTES;
+        void *buf;
+        ma_rb_acquire_write(&mRb, &bytes, &buf);
+        frames = bytes / FRAME_BYTES;
+        return static_cast<int16_t*>(buf);
+    }
+
+    void commitWrite(int16_t *buf, size_t frames) {
+        ma_rb_commit_write(&mRb, frames * FRAME_BYTES, buf);
+    }
+
+    size_t fullRead(int16_t *dest, size_t frames) {
+        auto bytes = frames * FRAME_BYTES;
+        auto read = readOnce(dest, bytes);
+        if (read != bytes && ma_rb_available_read(&mRb)) {
+            read += readOnce(reinterpret_cast<uint8_t*>(dest) + read, bytes - read);
+        }
+        return read / FRAME_BYTES;
+    }
+
+private:
+
+    size_t readOnce(void *dest, size_t bytes) {
+        void *src;
+        ma_rb_acquire_read(&mRb, &bytes, &src);
+        memcpy(dest, src, bytes);
+        ma_rb_commit_read(&mRb, bytes, src);
+        return bytes;
+    }
+
+    ma_rb mRb;
+};
+
+//
+// Adapts AudioRingbuffer to the same interface
+//
+class MirroredRingbuffer {
+
+public:
+    MirroredRingbuffer(size_t bytes) {
+        mRb.init(bytes / FRAME_BYTES);
+    }
+
+    bool isMirrored() const {
+        return mRb.isMirrored();
+    }
+
+    int16_t* acquireWrite(size_t &frames) {
+        return mRb.writer().acquireWrite(frames);
+    }
+
+    void commitWrite(int16_t *buf, size_t frames) {
+        mRb.writer().commitWrite(buf, frames);
+    }
+
+    size_t fullRead(int16_t *dest, size_t frames) {
+        return mRb.reader().fullRead(dest, frames);
+    }
+
+private:
+    AudioRingbuffer mRb;
+};
+
+template <class Rb>
+double run(Rb &rb) {
+    auto const start = Clock::now();
+
+    std::thread producer([&rb]() {
+        std::vector<int16_t> block(WRITE_FRAMES * 2, 1);
+        size_t written = 0;
+        while (written < TOTAL_FRAMES) {
+            size_t remaining = WRITE_FRAMES;
+            while (remaining) {
+                size_t frames = remaining;
+                auto dest = rb.acquireWrite(frames);
+                if (frames == 0) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                memcpy(dest, block.data(), frames * FRAME_BYTES);
+                rb.commitWrite(dest, frames);
+                remaining -= frames;
+            }
+            written += WRITE_FRAMES;
+        }
+    });
+
+    std::vector<int16_t> chunk(READ_FRAMES * 2);
+    size_t read = 0;
+    while (read < TOTAL_FRAMES) {
+        auto frames = rb.fullRead(chunk.data(), READ_FRAMES);
+        if (frames == 0) {
+            std::this_thread::yield();
+        }
+        read += frames;
+    }
+    producer.join();
+
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void report(char const *name, double secs) {
+    printf("%-24s %8.3f s  %10.1f Mframes/s\n", name, secs, TOTAL_FRAMES / secs / 1e6);
+}
+
+}
+
+int main() {
+    constexpr size_t bytes = BUFFER_FRAMES * FRAME_BYTES;
+
+    MaRingbuffer ma(bytes);
+    report("ma_rb", run(ma));
+
+    MirroredRingbuffer mirrored(bytes);
+    report(mirrored.isMirrored() ? "Ringbuffer (mirrored)" : "Ringbuffer", run(mirrored));
+
+    return 0;
+}
@@ -0,0 +1,181 @@
+
+//
+// Unit tests for Ringbuffer. Both storage modes are tested: mirrored (the
+// default on Linux, falls back to the heap elsewhere) and caller provided
+// storage, which is never mirrored and splits transfers at the wrap point.
+//
+
+#include "core/audio/Ringbuffer.hpp"
+
+#include "catch.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+using TestRingbuffer = Ringbuffer<int16_t, 2>;
+
+// not a multiple of the page size, so mirrored storage is larger than the
+// capacity
+constexpr size_t BUFFER_FRAMES = 1000;
+
+//
+// Writes and reads blocks that do not divide the buffer size, so that both
+// cross the wrap point many times, and checks that everything read is what
+// was written.
+//
+void checkStreaming(TestRingbuffer &rb, size_t writeFrames, size_t readFrames) {
+    auto reader = rb.reader();
+    auto writer = rb.writer();
+
+    std::vector<int16_t> block(std::max(writeFrames, readFrames) * 2);
+    int16_t writeValue = 0;
+    int16_t readValue = 0;
+    size_t totalRead = 0;
+
+    while (totalRead < rb.size() * 8) {
+        if (writer.availableWrite() >= writeFrames) {
+            for (size_t i = 0; i != writeFrames * 2; ++i) {
+                block[i] = writeValue++;
+            }
+            REQUIRE(writer.fullWrite(block.data(), writeFrames) == writeFrames);
+        }
+
+        if (reader.availableRead() >= readFrames) {
+            REQUIRE(reader.fullRead(block.data(), readFrames) == readFrames);
+            for (size_t i = 0; i != readFrames * 2; ++i) {
+                REQUIRE(block[i] == readValue++);
+            }
+            totalRead += readFrames;
+        }
+    }
+
+    REQUIRE(reader.availableRead() + writer.availableWrite() == rb.size());
+}
+
+void checkEmpty(TestRingbuffer &rb) {
+    CHECK(rb.writer().availableWrite() == rb.size());
+    CHECK(rb.reader().availableRead() == 0);
+}
+
+void checkFill(TestRingbuffer &rb) {
+    auto reader = rb.reader();
+    auto writer = rb.writer();
+
+    std::vector<int16_t> data(rb.size() * 2);
+    for (size_t i = 0; i != data.size(); ++i) {
+        data[i] = (int16_t)i;
+    }
+
+    // offset the positions so the fill wraps
+    writer.seekWrite(rb.size() / 3);
+    reader.seekRead(rb.size() / 3);
+
+    REQUIRE(writer.fullWrite(data.data(), rb.size()) == rb.size());
+    CHECK(writer.availableWrite() == 0);
+    CHECK(writer.fullWrite(data.data(), 1) == 0);
+
+    std::vector<int16_t> readback(data.size());
+    REQUIRE(reader.fullRead(readback.data(), rb.size()) == rb.size());
+    CHECK(readback == data);
+    checkEmpty(rb);
+}
+
+}
+
+
+TEST_CASE("mirrored ringbuffer", "[Ringbuffer]") {
+    TestRingbuffer rb;
+    rb.init(BUFFER_FRAMES);
+    REQUIRE(rb.size() == BUFFER_FRAMES);
+
+    SECTION("is empty after init") {
+        checkEmpty(rb);
+    }
+
+    SECTION("can be filled to capacity") {
+        checkFill(rb);
+    }
+
+    SECTION("streams across the wrap point") {
+        checkStreaming(rb, 37, 29);
+    }
+
+    if (rb.isMirrored()) {
+        SECTION("acquires are contiguous across the wrap point") {
+            auto writer = rb.writer();
+            auto reader = rb.reader();
+            writer.seekWrite(BUFFER_FRAMES - 10);
+            reader.seekRead(BUFFER_FRAMES - 10);
+
+            size_t count = 100;
+            auto dest = writer.acquireWrite(count);
+            REQUIRE(count == 100);
+            for (size_t i = 0; i != count * 2; ++i) {
+                dest[i] = (int16_t)i;
+            }
+            writer.commitWrite(dest, count);
+
+            count = 100;
+            auto src = reader.acquireRead(count);
+            REQUIRE(count == 100);
+            for (size_t i = 0; i != count * 2; ++i) {
+                REQUIRE(src[i] == (int16_t)i);
+            }
+            reader.commitRead(src, count);
+            checkEmpty(rb);
+        }
+    }
+}
+
+TEST_CASE("ringbuffer with caller storage", "[Ringbuffer]") {
+    std::vector<int16_t> storage(BUFFER_FRAMES * 2);
+    TestRingbuffer rb;
+    rb.init(BUFFER_FRAMES, storage.data());
+    REQUIRE(rb.size() == BUFFER_FRAMES);
+    REQUIRE_FALSE(rb.isMirrored());
+
+    SECTION("is empty after init") {
+        checkEmpty(rb);
+    }
+
+    SECTION("can be filled to capacity") {
+        checkFill(rb);
+    }
+
+    SECTION("streams across the wrap point") {
+        checkStreaming(rb, 37, 29);
+    }
+
+    SECTION("acquires stop at the wrap point") {
+        auto writer = rb.writer();
+        writer.seekWrite(BUFFER_FRAMES - 10);
+        rb.reader().seekRead(BUFFER_FRAMES - 10);
+
+        size_t count = 100;
+        writer.acquireWrite(count);
+        CHECK(count == 10);
+    }
+
+    SECTION("full transfers are split at the wrap point") {
+        auto writer = rb.writer();
+        auto reader = rb.reader();
+        writer.seekWrite(BUFFER_FRAMES - 10);
+        reader.seekRead(BUFFER_FRAMES - 10);
+
+        std::vector<int16_t> data(200);
+        for (size_t i = 0; i != data.size(); ++i) {
+            data[i] = (int16_t)(i + 1);
+        }
+        REQUIRE(writer.fullWrite(data.data(), 100) == 100);
+        // the first 10 frames are at the end of the storage, the rest at
+        // the start
+        CHECK(storage[(BUFFER_FRAMES - 10) * 2] == 1);
+        CHECK(storage[0] == 21);
+
+        std::vector<int16_t> readback(200);
+        REQUIRE(reader.fullRead(readback.data(), 100) == 100);
+        CHECK(readback == data);
+    }
+}